@@ -0,0 +1,44 @@
+#include "stdafx.h"
+#include "AssetStreamerClass.h"
+
+using Microsoft::WRL::ComPtr;
+
+AssetStreamerClass::AssetStreamerClass(ComPtr<ID3D12Device> device, std::unique_ptr<CopyQueue> copyQueue) :
+	m_batch{ device },
+	m_copyQueue{ std::move(copyQueue) } {}
+
+UINT64 AssetStreamerClass::Submit(std::function<void()> onResident) {
+	const UINT64 fenceValue = m_copyQueue->Submit(m_batch);
+	m_pending.push_back({ fenceValue, std::move(onResident) });
+	return fenceValue;
+}
+
+void AssetStreamerClass::Update() {
+	if (m_pending.empty()) return;
+
+	const UINT64 completedValue = m_copyQueue->GetCompletedValue();
+
+	while (!m_pending.empty() && m_pending.front().fenceValue <= completedValue) {
+		// Popped first, the callback may submit again
+		auto onResident = std::move(m_pending.front().onResident);
+		m_pending.pop_front();
+
+		if (onResident) onResident();
+	}
+}
+
+void AssetStreamerClass::Flush() {
+	while (!m_pending.empty()) {
+		m_copyQueue->WaitForValue(m_pending.back().fenceValue);
+		Update();
+	}
+}
+
+std::unique_ptr<CopyQueue> AssetStreamerClass::SetCopyQueue(std::unique_ptr<CopyQueue> copyQueue) {
+	Flush();
+
+	// Fence values restart with the new queue, every chunk of the old one is free by now
+	m_batch.RecycleChunks(m_copyQueue->GetLastSubmittedValue());
+	std::swap(m_copyQueue, copyQueue);
+	return copyQueue;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+
+#include "CopyQueue.h"
+#include "UploadBatchClass.h"
+
+// Streams uploads through a CopyQueue while frames keep rendering. Assets are staged in the
+// open batch, Submit sends them off together with a callback that runs from Update once the
+// copies have completed, which is where the assets are made drawable.
+class AssetStreamerClass
+{
+public:
+	AssetStreamerClass(Microsoft::WRL::ComPtr<ID3D12Device> device, std::unique_ptr<CopyQueue> copyQueue);
+
+	// Batch collecting the uploads of the next submission
+	UploadBatchClass& GetBatch() { return m_batch; }
+
+	// Submits the open batch, onResident runs once its copies have completed. Returns the fence value.
+	UINT64 Submit(std::function<void()> onResident);
+
+	// Runs the callbacks of every completed submission in submission order, call once per frame
+	void Update();
+
+	// Blocks until every submission has completed and runs their callbacks
+	void Flush();
+
+	size_t GetPendingCount() const { return m_pending.size(); }
+
+	// Swap the queue submissions go to, returns the previous queue. Pending submissions are flushed first.
+	std::unique_ptr<CopyQueue> SetCopyQueue(std::unique_ptr<CopyQueue> copyQueue);
+
+	// Delete functions
+	AssetStreamerClass(AssetStreamerClass const& rhs) = delete;
+	AssetStreamerClass& operator=(AssetStreamerClass const& rhs) = delete;
+
+	AssetStreamerClass(AssetStreamerClass&& rhs) = delete;
+	AssetStreamerClass& operator=(AssetStreamerClass&& rhs) = delete;
+
+private:
+	struct PendingSubmission {
+		UINT64 fenceValue;
+		std::function<void()> onResident;
+	};
+
+	// The batch keeps the staging chunks of in flight submissions, it is declared first so the
+	// queue, which waits for its submissions when destroyed, goes before it
+	UploadBatchClass m_batch;
+	std::unique_ptr<CopyQueue> m_copyQueue;
+	std::deque<PendingSubmission> m_pending;	// Ascending fence values
+};
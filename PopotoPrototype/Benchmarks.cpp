@@ -0,0 +1,733 @@
+#include "stdafx.h"
+#include "Benchmarks.h"
+#include "D3DClass.h"
+#include "CullingClass.h"
+#include "AssetStreamerClass.h"
+#include "SceneImporter.h"
+#include "ThreadPoolClass.h"
+#include "VertexPacking.h"
+#include "MeshProcessing.h"
+#include "RecordingRenderBackend.h"
+#include "ProceduralMeshCacheClass.h"
+#include "Math/Random.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <thread>
+#include <unordered_set>
+
+namespace {
+	using Clock = std::chrono::high_resolution_clock;
+
+	double MillisecondsSince(const Clock::time_point& start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	const wchar_t* const ViewNames[RenderView::NUM_VIEWS]{
+		L"Camera", L"Directional light",
+		L"Point light -X", L"Point light +X", L"Point light +Y", L"Point light -Y", L"Point light +Z", L"Point light -Z"
+	};
+
+	// The subdivision GeometryClass used before edges shared their midpoints, every triangle got six vertices of its own
+	void SubdivideUnshared(GeometryClass::Mesh& mesh) {
+		const auto copy = mesh;
+		const UINT32 triangleCount = static_cast<UINT32>(copy.m_indices.size() / 3);
+
+		mesh.m_vertices.clear();
+		mesh.m_indices.clear();
+
+		const auto midPoint = [](const GeometryClass::Vertex& v0, const GeometryClass::Vertex& v1) {
+			return GeometryClass::Vertex{
+				0.5f * (v0.m_position + v1.m_position),
+				Math::Normalize(0.5f * (v0.m_normal + v1.m_normal)),
+				Math::Normalize(0.5f * (v0.m_tangent + v1.m_tangent)),
+				{ 0.5f * (v0.m_uv.x + v1.m_uv.x), 0.5f * (v0.m_uv.y + v1.m_uv.y) } };
+		};
+
+		for (UINT32 i = 0; i < triangleCount; ++i) {
+			const auto& v0 = copy.m_vertices[copy.m_indices[i * 3 + 0]];
+			const auto& v1 = copy.m_vertices[copy.m_indices[i * 3 + 1]];
+			const auto& v2 = copy.m_vertices[copy.m_indices[i * 3 + 2]];
+
+			mesh.m_vertices.push_back(v0);
+			mesh.m_vertices.push_back(v1);
+			mesh.m_vertices.push_back(v2);
+			mesh.m_vertices.push_back(midPoint(v0, v1));
+			mesh.m_vertices.push_back(midPoint(v1, v2));
+			mesh.m_vertices.push_back(midPoint(v0, v2));
+
+			const UINT32 i6 = i * 6;
+			for (const UINT32 corner : { 0U, 3U, 5U, 3U, 4U, 5U, 5U, 4U, 2U, 3U, 1U, 4U }) {
+				mesh.m_indices.push_back(i6 + corner);
+			}
+		}
+	}
+
+	size_t MeshBytes(const GeometryClass::Mesh& mesh) {
+		return mesh.m_vertices.size() * sizeof(GeometryClass::Vertex) + mesh.m_indices.size() * sizeof(UINT32);
+	}
+
+	// Meshlets of a sphere with a triangle facing the view that cluster culling rejected anyway, over a few
+	// orientations of the sphere in a perspective and an orthographic view. Anything but zero is a bug.
+	UINT CountFacingMeshletsCulled() {
+		using namespace Math;
+
+		auto sphere = GeometryClass::CreateSphere(1.0f, 4);
+		MeshProcessing::BuildMeshlets(sphere);
+
+		// Both views look down -Z at the sphere from outside of it
+		const Vector3 eye(0.0f, 0.0f, 4.0f);
+		const Vector3 forward(0.0f, 0.0f, -1.0f);
+		const auto cameraToWorld = OrthogonalTransform::MakeTranslation(eye);
+		const ClusterCullingClass::View views[]{
+			{ cameraToWorld * Frustum(Matrix4(DirectX::XMMatrixPerspectiveFovRH(DirectX::XM_PIDIV2, 1.0f, 0.1f, 10.0f))), eye, forward, false },
+			{ cameraToWorld * Frustum(Matrix4(DirectX::XMMatrixOrthographicRH(4.0f, 4.0f, 0.1f, 10.0f))), eye, forward, true }
+		};
+
+		const auto& meshlets = sphere.m_meshlets;
+		ClusterCullingClass culling;
+		std::vector<ClusterBounds> bounds;
+		UINT facingCulled = 0;
+
+		for (UINT rotation = 0; rotation < 8; ++rotation) {
+			const Matrix4 worldMat(DirectX::XMMatrixRotationRollPitchYaw(0.7f * rotation, 1.3f * rotation, 0.4f * rotation));
+			ClusterCullingClass::TransformBounds(meshlets.data(), static_cast<UINT>(meshlets.size()), worldMat, 1.0f, bounds);
+
+			for (const auto& view : views) {
+				culling.Clear();
+
+				for (size_t m = 0; m < meshlets.size(); ++m) {
+					const auto& meshlet = meshlets[m];
+					const UINT span = culling.Cull(view, &meshlet, &bounds[m], 1);
+					if (culling.GetSpan(span).indexCount) continue;
+
+					// Clockwise around the outward normal
+					for (UINT32 i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3) {
+						const Vector3 p0(worldMat * sphere.m_vertices[sphere.m_indices[i + 0]].m_position);
+						const Vector3 p1(worldMat * sphere.m_vertices[sphere.m_indices[i + 1]].m_position);
+						const Vector3 p2(worldMat * sphere.m_vertices[sphere.m_indices[i + 2]].m_position);
+						const Vector3 toView = view.orthographic ? -forward : eye - p0;
+
+						if (static_cast<float>(Dot(Cross(p2 - p0, p1 - p0), toView)) > 0.0f) {
+							++facingCulled;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		return facingCulled;
+	}
+
+	// Records frames of the scene without a device. A builder of its own draws into a RecordingRenderBackend
+	// and a CpuFrameMemory, with made up handles in place of the D3D12 objects.
+	class HeadlessFrames {
+	public:
+		explicit HeadlessFrames(D3DClass& d3d) : m_d3d{ d3d } {
+			// Distinct pipelines, so binds are skipped as they are in a real frame
+			for (UINT pipeline = 0; pipeline < DrawPipeline::NUM_PIPELINES; ++pipeline) {
+				for (UINT instanced = 0; instanced < 2; ++instanced) {
+					m_targets.pipelines[pipeline][instanced] = static_cast<PipelineHandle>(1 + pipeline * 2 + instanced);
+				}
+			}
+			m_targets.descriptorSize = 32;
+			m_targets.viewport = { 0.0f, 0.0f, 1920.0f, 1080.0f, 0.0f, 1.0f };
+			m_targets.scissorRect = { 0, 0, 1920, 1080 };
+			m_targets.pointShadow.viewCount = 6;
+
+			m_builder.ResolveRenderFlags(d3d.m_models);
+		}
+
+		// Without a swap chain to advance, every frame writes the first copy of the constant slots
+		void Record() {
+			m_d3d.UpdateViews();
+			m_memory.BeginFrame();
+			m_builder.RecordFrame(m_recorder, m_memory, m_d3d.GetFrameScene(), m_targets, 0);
+		}
+
+		FrameBuilderClass& GetBuilder() { return m_builder; }
+		const RecordingRenderBackend& GetRecorder() const { return m_recorder; }
+
+		// Delete functions
+		HeadlessFrames(HeadlessFrames const& rhs) = delete;
+		HeadlessFrames& operator=(HeadlessFrames const& rhs) = delete;
+
+		HeadlessFrames(HeadlessFrames&& rhs) = delete;
+		HeadlessFrames& operator=(HeadlessFrames&& rhs) = delete;
+
+	private:
+		D3DClass& m_d3d;
+		FrameBuilderClass m_builder;
+		CpuFrameMemory m_memory;
+		RecordingRenderBackend m_recorder;
+		FrameTargets m_targets{};
+	};
+
+	struct ToggleResult {
+		FrameStats stats;
+		size_t draws;
+		double msPerFrame;
+	};
+
+	// Records numFrames headless frames with a feature off, then on. setEnabled switches the feature on the builder.
+	template<typename SetEnabledT>
+	std::array<ToggleResult, 2> RecordOffAndOn(D3DClass& d3d, UINT numFrames, SetEnabledT setEnabled) {
+		HeadlessFrames frames{ d3d };
+
+		std::array<ToggleResult, 2> results;
+		for (UINT enabled = 0; enabled < 2; ++enabled) {
+			setEnabled(frames.GetBuilder(), enabled != 0);
+
+			frames.Record();
+			results[enabled].stats = frames.GetBuilder().GetFrameStats();
+			results[enabled].draws = frames.GetRecorder().GetCommandCount(RenderCommandType::DrawIndexedInstanced);
+
+			const auto start = Clock::now();
+			for (UINT i = 0; i < numFrames; ++i) {
+				frames.Record();
+			}
+			results[enabled].msPerFrame = MillisecondsSince(start) / numFrames;
+		}
+
+		return results;
+	}
+}
+
+void Benchmarks::RunHeadlessFrames(D3DClass& d3d, UINT numFrames) {
+	HeadlessFrames frames{ d3d };
+	const auto& recorder = frames.GetRecorder();
+
+	// Warm up so the command stream has reached its final capacity
+	frames.Record();
+	const auto digest = recorder.ComputeDigest();
+
+	const auto start = Clock::now();
+	for (UINT i = 0; i < numFrames; ++i) {
+		frames.Record();
+	}
+	const auto elapsedMs = MillisecondsSince(start);
+
+	std::wstringstream t_SStream;
+	t_SStream << "Headless frames: " << numFrames 
+		<< ", " << (elapsedMs / numFrames) << "ms/frame"
+		<< ", " << (numFrames * 1000.0 / elapsedMs) << " fps" << std::endl;
+	t_SStream << "  Commands: " << recorder.GetCommands().size()
+		<< ", draws: " << recorder.GetCommandCount(RenderCommandType::DrawIndexedInstanced)
+		<< ", PSO changes: " << recorder.GetCommandCount(RenderCommandType::SetPipelineState)
+		<< ", root CBVs: " << recorder.GetCommandCount(RenderCommandType::SetRootConstantBufferView)
+		<< ", descriptor copies: " << recorder.GetCommandCount(RenderCommandType::CopyDescriptor)
+		<< ", barriers: " << recorder.GetCommandCount(RenderCommandType::ResourceBarrier) << std::endl;
+	t_SStream << "  Stream digest: " << std::hex << digest << std::dec
+		<< (digest == recorder.ComputeDigest() ? L"" : L" (unstable between frames)") << std::endl;
+	OutputDebugString(t_SStream.str().c_str());
+	frames.GetBuilder().PrintFrameStats();
+}
+
+void Benchmarks::RunCulling(D3DClass& d3d) {
+	const Frustum& frustum = d3d.m_camera->GetWorldSpaceFrustum();
+
+	struct Box {
+		Vector3 minBound;
+		Vector3 maxBound;
+	};
+
+	for (const UINT count : { 1000U, 10000U, 100000U }) {
+		// Boxes scattered through roughly the volume of the normalized scene
+		Math::RandomNumberGenerator rng;
+		rng.SetSeed(count);
+
+		std::vector<Box> boxes(count);
+		CullingClass culling;
+		culling.Resize(count);
+
+		for (UINT i = 0; i < count; ++i) {
+			const Vector3 center{ rng.NextFloat(-1.5f, 1.5f), rng.NextFloat(-1.0f, 1.0f), rng.NextFloat(-1.5f, 1.5f) };
+			const Vector3 extent{ rng.NextFloat(0.005f, 0.05f), rng.NextFloat(0.005f, 0.05f), rng.NextFloat(0.005f, 0.05f) };
+
+			boxes[i] = { center - extent, center + extent };
+			culling.SetBounds(i, boxes[i].minBound, boxes[i].maxBound);
+		}
+
+		const UINT iterations = std::max(1U, 2000000U / count);
+		std::vector<UINT> visible;
+		visible.reserve(count);
+
+		const auto timePerBox = [&](auto&& cull) {
+			cull(); // Warm up
+			const auto start = Clock::now();
+			for (UINT i = 0; i < iterations; ++i) {
+				cull();
+			}
+			return MillisecondsSince(start) * 1000000.0 / (static_cast<double>(iterations) * count);
+		};
+
+		const double boxNs = timePerBox([&] {
+			visible.clear();
+			for (UINT i = 0; i < count; ++i) {
+				if (frustum.IntersectBoundingBox(boxes[i].minBound, boxes[i].maxBound)) {
+					visible.push_back(i);
+				}
+			}
+		});
+		const size_t expectedVisible = visible.size();
+
+		const double scalarNs = timePerBox([&] { culling.CullScalar(frustum, visible); });
+		const bool scalarMatches = visible.size() == expectedVisible;
+
+		const double sseNs = timePerBox([&] { culling.CullSSE(frustum, visible); });
+		const bool sseMatches = visible.size() == expectedVisible;
+
+		std::wstringstream t_SStream;
+		t_SStream << "Culling " << count << " boxes, " << expectedVisible << " visible" << std::endl;
+		t_SStream << "  IntersectBoundingBox: " << boxNs << "ns/box" << std::endl;
+		t_SStream << "  SoA scalar: " << scalarNs << "ns/box" << (scalarMatches ? L"" : L" (visible count differs)") << std::endl;
+		t_SStream << "  SoA SSE: " << sseNs << "ns/box" << (sseMatches ? L"" : L" (visible count differs)") << std::endl;
+
+		if (CullingClass::IsAVX2Supported()) {
+			const double avxNs = timePerBox([&] { culling.CullAVX2(frustum, visible); });
+			const bool avxMatches = visible.size() == expectedVisible;
+			t_SStream << "  SoA AVX2: " << avxNs << "ns/box" << (avxMatches ? L"" : L" (visible count differs)") << std::endl;
+		}
+		else {
+			t_SStream << "  SoA AVX2: not supported on this CPU" << std::endl;
+		}
+
+		// All views of a frame, culled one at a time and in a single pass
+		const auto& viewFrusta = d3d.GetViewFrusta();
+		std::vector<UINT8> viewMasks;
+		std::array<std::vector<UINT>, RenderView::NUM_VIEWS> viewLists;
+
+		const double separateNs = timePerBox([&] {
+			for (const auto& viewFrustum : viewFrusta) {
+				culling.Cull(viewFrustum, visible);
+			}
+		});
+		const double combinedNs = timePerBox([&] {
+			culling.CullViews(viewFrusta.data(), RenderView::NUM_VIEWS, viewMasks, viewLists.data());
+		});
+
+		bool viewsMatch = true;
+		for (UINT v = 0; v < RenderView::NUM_VIEWS; ++v) {
+			culling.Cull(viewFrusta[v], visible);
+			viewsMatch &= visible == viewLists[v];
+		}
+
+		t_SStream << "  " << RenderView::NUM_VIEWS << " views separately: " << separateNs << "ns/box" << std::endl;
+		t_SStream << "  " << RenderView::NUM_VIEWS << " views in one pass: " << combinedNs << "ns/box" << (viewsMatch ? L"" : L" (visible lists differ)") << std::endl;
+
+		OutputDebugString(t_SStream.str().c_str());
+	}
+}
+
+void Benchmarks::RunStreaming(D3DClass& d3d, const std::string& assetPath, UINT numSubmissions) {
+	using namespace std::chrono;
+
+	const auto frameTime = microseconds(16667);
+	const UINT latencyFrames = 3;
+
+	// The copies still execute on a copy queue of their own, the streamed models are really drawn
+	auto& streamer = d3d.GetStreamer();
+	auto previousQueue = streamer.SetCopyQueue(std::make_unique<SimulatedCopyQueue>(
+		frameTime * latencyFrames,
+		std::make_unique<D3D12CopyQueue>(d3d.GetDevice())));
+
+	auto previousBackend = d3d.SetRenderBackend(std::make_unique<RecordingRenderBackend>());
+
+	struct Submission {
+		size_t firstModel;
+		size_t lastModel;
+		UINT submitFrame;
+		UINT residentFrame;
+		bool resident;
+	};
+
+	const auto isStreaming = [&d3d](const Submission& submission) {
+		for (size_t i = submission.firstModel; i < submission.lastModel; ++i) {
+			if (d3d.m_models[i].GetRenderFlags() & RenderFlags::Streaming) return true;
+		}
+		return false;
+	};
+
+	const size_t sceneModels = d3d.m_models.size();
+
+	std::vector<Submission> submissions;
+	submissions.reserve(numSubmissions);
+	UINT frame = 0;
+	UINT nextResident = 0;
+	bool inOrder = true;
+
+	auto frameStart = Clock::now();
+	while (frame < numSubmissions || streamer.GetPendingCount() > 0) {
+		// Completed uploads are published and their models lose the streaming flag at the start of the frame
+		d3d.RecordFrame();
+
+		for (UINT i = 0; i < static_cast<UINT>(submissions.size()); ++i) {
+			auto& submission = submissions[i];
+			if (!submission.resident && !isStreaming(submission)) {
+				submission.resident = true;
+				submission.residentFrame = frame;
+				inOrder &= i == nextResident++;
+			}
+		}
+
+		if (frame < numSubmissions) {
+			const size_t firstModel = d3d.m_models.size();
+			d3d.StreamScene(assetPath);
+			submissions.push_back({ firstModel, d3d.m_models.size(), frame, 0, false });
+		}
+
+		++frame;
+		frameStart += frameTime;
+		std::this_thread::sleep_until(frameStart);
+	}
+
+	UINT minFrames = UINT_MAX, maxFrames = 0, totalFrames = 0;
+	UINT streamingModels = 0;
+	for (const auto& submission : submissions) {
+		if (submission.resident) {
+			const UINT frames = submission.residentFrame - submission.submitFrame;
+			minFrames = std::min(minFrames, frames);
+			maxFrames = std::max(maxFrames, frames);
+			totalFrames += frames;
+		}
+
+		for (size_t i = submission.firstModel; i < submission.lastModel; ++i) {
+			streamingModels += (d3d.m_models[i].GetRenderFlags() & RenderFlags::Streaming) ? 1 : 0;
+		}
+	}
+
+	// Every streamed model has to be drawable and every arena upload published
+	const size_t unpublished = d3d.m_geometryArena.GetUnpublishedCount();
+	const bool passed = streamingModels == 0 && unpublished == 0;
+
+	const size_t streamedModels = submissions.empty() ? 0 : submissions.back().lastModel - submissions.front().firstModel;
+
+	std::wstringstream t_SStream;
+	t_SStream << "Streaming " << std::wstring(assetPath.begin(), assetPath.end()) << " " << numSubmissions << " times, "
+		<< latencyFrames << " frames of simulated copy latency" << std::endl;
+	t_SStream << "  Frames until resident: " << (static_cast<double>(totalFrames) / std::max(1U, numSubmissions))
+		<< " average, " << minFrames << " min, " << maxFrames << " max"
+		<< (inOrder ? L"" : L" (completed out of order)") << std::endl;
+	t_SStream << "  Models streamed: " << streamedModels << ", still streaming: " << streamingModels
+		<< ", unpublished arena uploads: " << unpublished << std::endl;
+	t_SStream << "  " << (passed ? L"PASS" : L"FAIL") << ": every streamed model resident and every upload published" << std::endl;
+	OutputDebugString(t_SStream.str().c_str());
+
+	// Only added for the measurement, removing them frees their geometry and ids for the next run
+	d3d.RemoveModels(sceneModels);
+
+	d3d.SetRenderBackend(std::move(previousBackend));
+	streamer.SetCopyQueue(std::move(previousQueue));
+}
+
+void Benchmarks::RunSceneImport(D3DClass& d3d, const std::string& assetPath) {
+	const UINT maxThreads = std::max(1U, std::thread::hardware_concurrency());
+
+	std::vector<UINT> threadCounts;
+	for (UINT count = 1; count < maxThreads; count *= 2) {
+		threadCounts.push_back(count);
+	}
+	threadCounts.push_back(maxThreads);
+
+	// Writes the cache if it is missing or out of date, so every cached import below reads it
+	{
+		ThreadPoolClass threadPool;
+		SceneImporter::Import(d3d.GetDevice(), threadPool, assetPath, false, {});
+	}
+
+	std::wstringstream t_SStream;
+	t_SStream << "Scene import of " << std::wstring(assetPath.begin(), assetPath.end()) << ", cold (cache skipped) and cached:" << std::endl;
+
+	std::array<double, 2> serialMs{};
+	for (const UINT threadCount : threadCounts) {
+		ThreadPoolClass threadPool(threadCount);
+
+		std::array<double, 2> elapsedMs{};
+		size_t meshCount = 0, vertexCount = 0, textureCount = 0;
+
+		for (UINT useCache = 0; useCache < 2; ++useCache) {
+			const auto start = Clock::now();
+			const auto scene = SceneImporter::Import(d3d.GetDevice(), threadPool, assetPath, false, {}, useCache != 0);
+			elapsedMs[useCache] = MillisecondsSince(start);
+
+			meshCount = scene.meshes.size();
+			textureCount = scene.textures.size();
+			vertexCount = 0;
+			for (const auto& mesh : scene.meshes) {
+				vertexCount += mesh.data.m_vertexCount;
+			}
+		}
+
+		if (threadCount == 1) {
+			serialMs = elapsedMs;
+		}
+
+		t_SStream << "  " << threadCount << " threads: cold " << elapsedMs[0] << "ms, " << (serialMs[0] / elapsedMs[0]) << "x"
+			<< ", cached " << elapsedMs[1] << "ms, " << (serialMs[1] / elapsedMs[1]) << "x"
+			<< " (" << meshCount << " meshes, " << vertexCount << " vertices, " << textureCount << " textures)" << std::endl;
+	}
+
+	OutputDebugString(t_SStream.str().c_str());
+}
+
+void Benchmarks::RunVertexPacking(D3DClass& d3d, const std::string& assetPath) {
+	ThreadPoolClass threadPool;
+	const auto scene = SceneImporter::Import(d3d.GetDevice(), threadPool, assetPath, false, {});
+
+	UINT64 vertexCount = 0;
+	for (const auto& mesh : scene.meshes) {
+		vertexCount += mesh.data.m_vertexCount;
+	}
+
+	std::wstringstream t_SStream;
+	t_SStream << "Vertex packing of " << std::wstring(assetPath.begin(), assetPath.end()) << ", " << vertexCount << " vertices" << std::endl;
+
+	const UINT64 fullBytes = vertexCount * VertexPacking::GetStride(VertexFormat::Full);
+	std::vector<UINT8> packed;
+
+	for (const auto format : { VertexFormat::Full, VertexFormat::Packed, VertexFormat::PackedHalfPosition }) {
+		const UINT stride = VertexPacking::GetStride(format);
+		packed.resize(static_cast<size_t>(vertexCount * stride));
+
+		const auto start = Clock::now();
+		UINT64 offset = 0;
+		for (const auto& mesh : scene.meshes) {
+			VertexPacking::Pack(format, mesh.data.m_vertices, mesh.data.m_vertexCount, packed.data() + offset);
+			offset += static_cast<UINT64>(mesh.data.m_vertexCount) * stride;
+		}
+		const auto elapsedMs = MillisecondsSince(start);
+
+		// Worst case over all meshes, the mean weighted by vertex count
+		VertexPacking::PackingError error;
+		double positionErrorSum = 0.0;
+		for (const auto& mesh : scene.meshes) {
+			const auto meshError = VertexPacking::MeasureError(format, mesh.data.m_vertices, mesh.data.m_vertexCount);
+			error.maxPosition = std::max(error.maxPosition, meshError.maxPosition);
+			error.maxNormalDegrees = std::max(error.maxNormalDegrees, meshError.maxNormalDegrees);
+			error.maxTangentDegrees = std::max(error.maxTangentDegrees, meshError.maxTangentDegrees);
+			error.maxUV = std::max(error.maxUV, meshError.maxUV);
+			positionErrorSum += static_cast<double>(meshError.meanPosition) * mesh.data.m_vertexCount;
+		}
+
+		t_SStream << "  " << VertexPacking::GetName(format) << ": " << stride << " bytes per vertex, "
+			<< (packed.size() / 1024) << "KB (" << (100.0 * packed.size() / std::max(fullBytes, 1ULL)) << "%), packed in " << elapsedMs << "ms" << std::endl;
+		t_SStream << "    position error " << error.maxPosition << " max, " << (vertexCount ? positionErrorSum / vertexCount : 0.0) << " mean"
+			<< ", normal " << error.maxNormalDegrees << " deg, tangent " << error.maxTangentDegrees << " deg, uv " << error.maxUV << " max" << std::endl;
+	}
+
+	// The importer welds exact duplicates, near ones are only merged by a positive epsilon
+	UINT64 triangleCount = 0;
+	for (const auto& mesh : scene.meshes) {
+		triangleCount += (mesh.data.m_lodCount ? mesh.data.m_lods[0].indexCount : mesh.data.m_indexCount) / 3;
+	}
+
+	t_SStream << "  Welding, " << vertexCount << " vertices and " << triangleCount << " triangles imported" << std::endl;
+	for (const float epsilon : { 1e-4f, 1e-3f, 1e-2f }) {
+		UINT64 removedVertices = 0, weldedTriangles = 0;
+		double elapsedMs = 0.0;
+
+		for (const auto& mesh : scene.meshes) {
+			// Only the full detail level, the others index the same vertices
+			const UINT firstIndex = mesh.data.m_lodCount ? mesh.data.m_lods[0].firstIndex : 0;
+			const UINT indexCount = mesh.data.m_lodCount ? mesh.data.m_lods[0].indexCount : mesh.data.m_indexCount;
+			GeometryClass::Mesh welded;
+			welded.m_vertices.assign(mesh.data.m_vertices, mesh.data.m_vertices + mesh.data.m_vertexCount);
+			welded.m_indices.assign(mesh.data.m_indices + firstIndex, mesh.data.m_indices + firstIndex + indexCount);
+
+			const auto start = Clock::now();
+			removedVertices += MeshProcessing::WeldVertices(welded, epsilon);
+			elapsedMs += MillisecondsSince(start);
+
+			weldedTriangles += welded.m_indices.size() / 3;
+		}
+
+		t_SStream << "    epsilon " << epsilon << ": " << (vertexCount - removedVertices) << " vertices ("
+			<< (vertexCount ? 100.0 * (vertexCount - removedVertices) / vertexCount : 100.0) << "%), "
+			<< weldedTriangles << " triangles, welded in " << elapsedMs << "ms" << std::endl;
+	}
+
+	OutputDebugString(t_SStream.str().c_str());
+}
+
+void Benchmarks::RunClusterCulling(D3DClass& d3d, UINT numFrames) {
+	const auto results = RecordOffAndOn(d3d, numFrames, [](FrameBuilderClass& builder, bool enabled) { builder.SetClusterCulling(enabled); });
+
+	const UINT facingCulled = CountFacingMeshletsCulled();
+	assert(facingCulled == 0);
+
+	std::wstringstream t_SStream;
+	t_SStream << "Cluster culling, triangles submitted off -> on:" << std::endl;
+
+	UINT64 totalOff = 0, totalOn = 0;
+	for (UINT v = 0; v < RenderView::NUM_VIEWS; ++v) {
+		const UINT64 off = results[0].stats.views[v].triangles;
+		const UINT64 on = results[1].stats.views[v].triangles;
+		totalOff += off;
+		totalOn += on;
+
+		t_SStream << "  " << ViewNames[v] << ": " << off << " -> " << on
+			<< " (" << (off ? 100.0 * on / off : 100.0) << "%), "
+			<< results[1].stats.views[v].clusterCulled << " models culled by clusters" << std::endl;
+	}
+
+	t_SStream << "  All views: " << totalOff << " -> " << totalOn << " (" << (totalOff ? 100.0 * totalOn / totalOff : 100.0) << "%)" << std::endl;
+	t_SStream << "  Draws: " << results[0].draws << " -> " << results[1].draws
+		<< ", CPU: " << results[0].msPerFrame << "ms -> " << results[1].msPerFrame << "ms per frame" << std::endl;
+	t_SStream << "  Sphere meshlets facing the view but culled: " << facingCulled << std::endl;
+	OutputDebugString(t_SStream.str().c_str());
+}
+
+void Benchmarks::RunLodSelection(D3DClass& d3d, UINT numFrames) {
+	const auto results = RecordOffAndOn(d3d, numFrames, [](FrameBuilderClass& builder, bool enabled) { builder.SetLodSelection(enabled); });
+
+	std::wstringstream t_SStream;
+	t_SStream << "Level of detail selection, triangles submitted off -> on:" << std::endl;
+
+	UINT64 totalOff = 0, totalOn = 0;
+	for (UINT v = 0; v < RenderView::NUM_VIEWS; ++v) {
+		const UINT64 off = results[0].stats.views[v].triangles;
+		const UINT64 on = results[1].stats.views[v].triangles;
+		totalOff += off;
+		totalOn += on;
+
+		t_SStream << "  " << ViewNames[v] << ": " << off << " -> " << on
+			<< " (" << (off ? 100.0 * on / off : 100.0) << "%), "
+			<< results[1].stats.views[v].reducedLod << " of " << results[1].stats.views[v].visible << " models reduced" << std::endl;
+	}
+
+	t_SStream << "  All views: " << totalOff << " -> " << totalOn << " (" << (totalOff ? 100.0 * totalOn / totalOff : 100.0) << "%)" << std::endl;
+	t_SStream << "  Draws: " << results[0].draws << " -> " << results[1].draws
+		<< ", CPU: " << results[0].msPerFrame << "ms -> " << results[1].msPerFrame << "ms per frame" << std::endl;
+	OutputDebugString(t_SStream.str().c_str());
+}
+
+void Benchmarks::RunInstancing(D3DClass& d3d, UINT numFrames) {
+	const auto results = RecordOffAndOn(d3d, numFrames, [](FrameBuilderClass& builder, bool enabled) { builder.SetInstancing(enabled); });
+
+	std::wstringstream t_SStream;
+	t_SStream << "Instancing, off -> on:" << std::endl;
+	t_SStream << "  Draws: " << results[0].draws << " -> " << results[1].draws
+		<< ", " << results[1].stats.instancedDraws << " instanced covering " << results[1].stats.instancesBatched << " models" << std::endl;
+	t_SStream << "  Upload bytes: " << results[0].stats.uploadBytes << " -> " << results[1].stats.uploadBytes << std::endl;
+	t_SStream << "  CPU: " << results[0].msPerFrame << "ms -> " << results[1].msPerFrame << "ms per frame" << std::endl;
+	OutputDebugString(t_SStream.str().c_str());
+}
+
+void Benchmarks::RunSubdivision(UINT maxLevel) {
+	// Levels the unshared subdivision used to be capped at
+	constexpr UINT MaxUnsharedLevel = 6;
+	constexpr double BytesPerMB = 1024.0 * 1024.0;
+
+	ThreadPoolClass threadPool;
+	const auto base = GeometryClass::CreateSphere(1.0f, 0);
+
+	std::wstringstream t_SStream;
+	t_SStream << "Subdivision of an icosahedron, " << threadPool.GetThreadCount() << " threads:" << std::endl;
+
+	for (UINT level = 1; level <= maxLevel; ++level) {
+		auto serial = base;
+		auto start = Clock::now();
+		GeometryClass::Subdivide(serial, level);
+		const double serialMs = MillisecondsSince(start);
+
+		auto parallel = base;
+		start = Clock::now();
+		GeometryClass::Subdivide(parallel, level, &threadPool);
+		const double parallelMs = MillisecondsSince(start);
+
+		t_SStream << "  Level " << level << ": " << (serial.m_indices.size() / 3) << " triangles, "
+			<< serial.m_vertices.size() << " vertices, " << (MeshBytes(serial) / BytesPerMB) << "MB, "
+			<< serialMs << "ms serial, " << parallelMs << "ms parallel";
+
+		if (parallel.m_indices != serial.m_indices || parallel.m_vertices.size() != serial.m_vertices.size()) {
+			t_SStream << ", MISMATCH between serial and parallel";
+		}
+
+		if (level <= MaxUnsharedLevel) {
+			auto unshared = base;
+			start = Clock::now();
+			for (UINT i = 0; i < level; ++i) {
+				SubdivideUnshared(unshared);
+			}
+			const double unsharedMs = MillisecondsSince(start);
+
+			t_SStream << ", unshared: " << unshared.m_vertices.size() << " vertices, "
+				<< (MeshBytes(unshared) / BytesPerMB) << "MB, " << unsharedMs << "ms";
+		}
+		t_SStream << std::endl;
+	}
+
+	OutputDebugString(t_SStream.str().c_str());
+}
+
+void Benchmarks::RunProceduralMeshes(UINT numPrimitives) {
+	// A handful of shapes, requested over and over like a procedurally populated scene does
+	const ProceduralMeshKey shapes[]{
+		ProceduralMeshKey::Box(0.1f, 0.1f, 0.1f, 2),
+		ProceduralMeshKey::Sphere(0.05f, 3),
+		ProceduralMeshKey::Cylinder(0.05f, 0.2f, 2),
+		ProceduralMeshKey::Grid(1.0f, 1.0f, 4),
+		ProceduralMeshKey::Torus(0.1f, 0.025f, 2),
+		ProceduralMeshKey::Capsule(0.05f, 0.1f, 2)
+	};
+	constexpr UINT NumShapes = static_cast<UINT>(std::extent_v<decltype(shapes)>);
+
+	Math::RandomNumberGenerator rng;
+	rng.SetSeed(1);
+	std::vector<UINT> requests(numPrimitives);
+	for (auto& request : requests) {
+		request = static_cast<UINT>(rng.NextInt(NumShapes - 1));
+	}
+
+	ThreadPoolClass threadPool;
+	size_t generatedBytes = 0;
+
+	auto start = Clock::now();
+	for (const auto request : requests) {
+		const auto mesh = ProceduralMeshCacheClass::Generate(shapes[request], &threadPool);
+		generatedBytes += MeshBytes(mesh);
+	}
+	const double uncachedMs = MillisecondsSince(start);
+
+	ProceduralMeshCacheClass cache(&threadPool);
+	std::vector<GeometryClass::MeshView> views(numPrimitives);
+
+	start = Clock::now();
+	for (UINT i = 0; i < numPrimitives; ++i) {
+		views[i] = cache.GetMesh(shapes[requests[i]]);
+	}
+	const double cachedMs = MillisecondsSince(start);
+
+	// Equal shapes share their owner
+	std::unordered_set<const void*> owners;
+	size_t cachedBytes = 0;
+	for (const auto& view : views) {
+		if (owners.insert(view.m_owner.get()).second) {
+			cachedBytes += view.m_vertexCount * sizeof(GeometryClass::Vertex) + view.m_indexCount * sizeof(UINT32);
+		}
+	}
+
+	constexpr double BytesPerMB = 1024.0 * 1024.0;
+
+	std::wstringstream t_SStream;
+	t_SStream << "Procedural meshes, " << numPrimitives << " primitives of " << NumShapes << " shapes:" << std::endl;
+	t_SStream << "  Generated every time: " << uncachedMs << "ms, " << (generatedBytes / BytesPerMB) << "MB generated" << std::endl;
+	t_SStream << "  Cached: " << cachedMs << "ms, " << cache.GetMissCount() << " generated, " << cache.GetHitCount() << " shared, "
+		<< (cachedBytes / BytesPerMB) << "MB held" << std::endl;
+	OutputDebugString(t_SStream.str().c_str());
+}
+
+void Benchmarks::RunAll(D3DClass& d3d) {
+	RunHeadlessFrames(d3d);
+	RunCulling(d3d);
+	RunSceneImport(d3d);
+	RunVertexPacking(d3d);
+	RunClusterCulling(d3d);
+	RunLodSelection(d3d);
+	RunInstancing(d3d);
+	RunSubdivision();
+	RunProceduralMeshes();
+	RunStreaming(d3d);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+class D3DClass;
+
+// CPU side benchmarks, results are written to the debug output
+namespace Benchmarks {
+	// Records numFrames frames into a RecordingRenderBackend, without a device, and reports the CPU cost per frame
+	void RunHeadlessFrames(D3DClass& d3d, UINT numFrames = 1000);
+
+	// Compares the per box Frustum::IntersectBoundingBox path with the SoA culling kernels
+	// at 1k, 10k and 100k random boxes, tested against the camera frustum, and culling
+	// all views of the last frame separately against the single pass multi view kernel
+	void RunCulling(D3DClass& d3d);
+
+	// Streams the scene numSubmissions times through D3DClass::StreamScene, one per recorded 60Hz frame,
+	// on a SimulatedCopyQueue that adds latency to a real copy queue. Reports after how many frames each
+	// became resident and whether every streamed model was published. The models are removed afterwards.
+	void RunStreaming(D3DClass& d3d, const std::string& assetPath = "assets/sphere.obj", UINT numSubmissions = 8);
+
+	// Imports the scene with thread pools of 1, 2, 4, ... up to the hardware thread count and reports
+	// the load time of each, once skipping the scene cache and once reading it. Textures are decoded
+	// every time, nothing is added to the scene.
+	void RunSceneImport(D3DClass& d3d, const std::string& assetPath = "assets/sponza.obj");
+
+	// Packs the vertices of the scene in every VertexFormat and reports the size, the packing time and
+	// the error against the full precision vertices. Also welds the imported meshes, which are already
+	// free of exact duplicates, with a few epsilons and reports the vertices and triangles left.
+	void RunVertexPacking(D3DClass& d3d, const std::string& assetPath = "assets/sponza.obj");
+
+	// Records numFrames headless frames with cluster culling off and on, and reports the triangles
+	// submitted per view, the draws and the CPU cost per frame of both
+	void RunClusterCulling(D3DClass& d3d, UINT numFrames = 100);
+
+	// Same with level of detail selection, also reporting how many models got a coarser level per view
+	void RunLodSelection(D3DClass& d3d, UINT numFrames = 100);
+
+	// Same with instancing, reporting the draws per frame, how many of them were instanced and the CPU cost
+	void RunInstancing(D3DClass& d3d, UINT numFrames = 100);
+
+	// Subdivides an icosahedron up to maxLevel times, serially and on a thread pool, and reports the size and
+	// time per level next to the unshared subdivision that gave every triangle its own vertices
+	void RunSubdivision(UINT maxLevel = 9);
+
+	// Requests numPrimitives random primitives out of a few shapes, generating every one and through a
+	// ProceduralMeshCacheClass, and reports the time and memory of both
+	void RunProceduralMeshes(UINT numPrimitives = 10000);
+
+	void RunAll(D3DClass& d3d);
+};
@@ -15,6 +15,7 @@ CameraClass::CameraClass(float vFovRad, float aspectRatio, float nearClip, float
 void CameraClass::Update() {
 	m_viewMat = Matrix4(~m_CameraToWorld);
 	m_viewProjMat = m_projMat * m_viewMat;
+	m_frustumWS = m_CameraToWorld * m_frustumVS;
 }
 
 void CameraClass::SetPositionAndTarget(Vector3 pos, Vector3 target, Vector3 up) {
@@ -56,4 +57,5 @@ void CameraClass::SetTransform(const AffineTransform& xform) {
 
 void CameraClass::UpdateProjectionMatrix() {
 	m_projMat = Matrix4{ XMMatrixPerspectiveFovRH(m_vFov, m_aspectRatio, m_nearClip, m_farClip) };
+	m_frustumVS = Frustum(m_projMat);
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Math/Frustum.h"
+
 using namespace Math;
 
 class CameraClass
@@ -19,6 +21,9 @@ public:
 	const Matrix4& GetViewMatrix() const { return m_viewMat; }
 	const Matrix4& GetProjMatrix() const { return m_projMat; }
 	const Matrix4& GetViewProjMatrix() const { return m_viewProjMat; }
+	const OrthogonalTransform& GetCameraToWorld() const { return m_CameraToWorld; }
+	const Frustum& GetViewSpaceFrustum() const { return m_frustumVS; }
+	const Frustum& GetWorldSpaceFrustum() const { return m_frustumWS; }
 
 	const Vector3 GetPosition() const { return m_CameraToWorld.GetTranslation(); }
 	const Vector3 GetRight() const { return m_Basis.GetX(); }
@@ -40,6 +45,8 @@ private:
 	Matrix4 m_viewMat;
 	Matrix4 m_projMat;
 	Matrix4 m_viewProjMat;
+	Frustum m_frustumVS;
+	Frustum m_frustumWS;
 
 	float m_vFov;
 	float m_aspectRatio;
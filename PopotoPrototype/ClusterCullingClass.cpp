@@ -0,0 +1,78 @@
+#include "stdafx.h"
+#include "ClusterCullingClass.h"
+
+using namespace Math;
+
+namespace {
+	// True when every triangle of the cluster faces away from the view
+	bool IsBackFacing(const ClusterCullingClass::View& view, const ClusterBounds& bounds) {
+		if (bounds.coneCutoff >= 1.0f) return false;
+
+		if (view.orthographic) {
+			return static_cast<float>(Dot(view.forward, bounds.coneAxis)) > bounds.coneCutoff;
+		}
+
+		// The sphere radius covers every apex the cone could have within the cluster
+		const Vector3 toCenter = bounds.sphere.GetCenter() - view.position;
+		const float distance = Length(toCenter);
+		return static_cast<float>(Dot(toCenter, bounds.coneAxis)) > bounds.coneCutoff * distance + static_cast<float>(bounds.sphere.GetRadius());
+	}
+}
+
+void ClusterCullingClass::TransformBounds(
+	const GeometryClass::Meshlet* meshlets,
+	UINT count,
+	const Matrix4& worldMat,
+	float scale,
+	std::vector<ClusterBounds>& worldBounds) {
+
+	worldBounds.resize(count);
+
+	const Vector3 axisX(worldMat.GetX());
+	const Vector3 axisY(worldMat.GetY());
+	const Vector3 axisZ(worldMat.GetZ());
+
+	for (UINT i = 0; i < count; ++i) {
+		const auto& meshlet = meshlets[i];
+		auto& bounds = worldBounds[i];
+
+		bounds.sphere = BoundingSphere(Vector3(worldMat * Vector3(meshlet.center)), meshlet.radius * scale);
+
+		// Scaling does not change the angles, so the cutoff stays as it is
+		const Vector3 axis = axisX * meshlet.coneAxis.x + axisY * meshlet.coneAxis.y + axisZ * meshlet.coneAxis.z;
+		const float axisLength = Length(axis);
+		bounds.coneAxis = axisLength > 0.0f ? axis / axisLength : axis;
+		bounds.coneCutoff = meshlet.coneCutoff;
+	}
+}
+
+void ClusterCullingClass::Clear() {
+	m_ranges.clear();
+	m_spans.clear();
+}
+
+UINT ClusterCullingClass::Cull(const View& view, const GeometryClass::Meshlet* meshlets, const ClusterBounds* bounds, UINT count) {
+	Span span{ static_cast<UINT>(m_ranges.size()), 0, 0 };
+
+	for (UINT i = 0; i < count; ++i) {
+		if (!view.frustum.IntersectSphere(bounds[i].sphere) || IsBackFacing(view, bounds[i])) continue;
+
+		const auto& meshlet = meshlets[i];
+		span.indexCount += meshlet.indexCount;
+
+		// Meshlets follow each other in the index buffer, neighbours that both survive share a range
+		if (span.rangeCount) {
+			auto& last = m_ranges.back();
+			if (last.firstIndex + last.indexCount == meshlet.firstIndex) {
+				last.indexCount += meshlet.indexCount;
+				continue;
+			}
+		}
+
+		m_ranges.push_back({ meshlet.firstIndex, meshlet.indexCount });
+		++span.rangeCount;
+	}
+
+	m_spans.push_back(span);
+	return static_cast<UINT>(m_spans.size() - 1);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "GeometryClass.h"
+#include "Math/Frustum.h"
+#include "Math/BoundingSphere.h"
+
+// World space bounds of a GeometryClass::Meshlet
+struct ClusterBounds {
+	Math::BoundingSphere sphere;
+	Math::Vector3 coneAxis;
+	float coneCutoff;
+};
+
+// Culls the meshlets of the models that passed the per model frustum test. A meshlet is dropped when
+// its bounding sphere lies outside the view frustum or its normal cone faces away from the view, the
+// remaining ones are merged into as few index ranges as possible. Every pipeline culls back faces,
+// so the cone test holds for the shadow views as well. The ranges are rebuilt every frame.
+class ClusterCullingClass
+{
+public:
+	// Orthographic views test the cones against their forward direction instead of the direction from position
+	struct View {
+		Math::Frustum frustum;
+		Math::Vector3 position;
+		Math::Vector3 forward;
+		bool orthographic;
+	};
+
+	// Indices relative to the first index of the mesh
+	struct IndexRange {
+		UINT firstIndex;
+		UINT indexCount;
+	};
+
+	// The ranges written by one call to Cull
+	struct Span {
+		UINT firstRange;
+		UINT rangeCount;
+		UINT indexCount;	// Sum over the ranges
+	};
+
+	// Meshes with fewer meshlets are only culled as a whole
+	static constexpr UINT MinMeshlets = 4;
+
+	ClusterCullingClass() = default;
+
+	// worldMat may only rotate, translate and scale uniformly by scale
+	static void TransformBounds(
+		const GeometryClass::Meshlet* meshlets,
+		UINT count,
+		const Math::Matrix4& worldMat,
+		float scale,
+		std::vector<ClusterBounds>& worldBounds);
+
+	// Forgets the spans of the previous frame
+	void Clear();
+
+	// Culls count meshlets with their world space bounds against the view, returns the id of their span
+	UINT Cull(const View& view, const GeometryClass::Meshlet* meshlets, const ClusterBounds* bounds, UINT count);
+
+	const Span& GetSpan(UINT span) const { return m_spans[span]; }
+	const IndexRange* GetRanges(const Span& span) const { return m_ranges.data() + span.firstRange; }
+
+	// Delete functions
+	ClusterCullingClass(ClusterCullingClass const& rhs) = delete;
+	ClusterCullingClass& operator=(ClusterCullingClass const& rhs) = delete;
+
+	ClusterCullingClass(ClusterCullingClass&& rhs) = delete;
+	ClusterCullingClass& operator=(ClusterCullingClass&& rhs) = delete;
+
+private:
+	std::vector<IndexRange> m_ranges;
+	std::vector<Span> m_spans;
+};
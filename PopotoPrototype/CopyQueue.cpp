@@ -0,0 +1,142 @@
+#include "stdafx.h"
+#include "CopyQueue.h"
+#include "UploadBatchClass.h"
+
+#include <thread>
+
+using Microsoft::WRL::ComPtr;
+using namespace Utility;
+
+// ----------------------------
+// ----D3D12CopyQueue----
+// ----------------------------
+
+D3D12CopyQueue::D3D12CopyQueue(ComPtr<ID3D12Device> device) :
+	m_device{ device } {
+
+	D3D12_COMMAND_QUEUE_DESC queueDesc{};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
+	NAME_D3D12_RES(m_commandQueue);
+
+	ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+
+	m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (m_fenceEvent == nullptr) {
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+}
+
+D3D12CopyQueue::~D3D12CopyQueue() {
+	try {
+		WaitForValue(m_lastSubmittedValue);
+		CloseHandle(m_fenceEvent);
+	}
+	catch (const std::exception&) {
+		std::terminate();
+	}
+}
+
+UINT64 D3D12CopyQueue::Submit(UploadBatchClass& batch) {
+	const UINT64 completedValue = GetCompletedValue();
+
+	ComPtr<ID3D12CommandAllocator> allocator;
+	if (!m_allocators.empty() && m_allocators.front().fenceValue <= completedValue) {
+		allocator = std::move(m_allocators.front().allocator);
+		m_allocators.pop_front();
+		ThrowIfFailed(allocator->Reset());
+	}
+	else {
+		ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&allocator)));
+	}
+
+	if (!m_commandList) {
+		ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, allocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+		NAME_D3D12_RES(m_commandList);
+	}
+	else {
+		ThrowIfFailed(m_commandList->Reset(allocator.Get(), nullptr));
+	}
+
+	// The staging chunks of completed submissions take the uploads of this one
+	const UINT64 fenceValue = m_lastSubmittedValue + 1;
+	batch.RecycleChunks(completedValue);
+	batch.Flush(m_commandList.Get(), fenceValue, m_releaseQueue, false);
+	ThrowIfFailed(m_commandList->Close());
+
+	ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+	m_commandQueue->ExecuteCommandLists(std::extent_v<decltype(ppCommandLists)>, ppCommandLists);
+
+	m_lastSubmittedValue = fenceValue;
+	ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), fenceValue));
+
+	m_releaseQueue.Submit(fenceValue);
+	m_allocators.push_back({ fenceValue, std::move(allocator) });
+
+	return fenceValue;
+}
+
+UINT64 D3D12CopyQueue::GetCompletedValue() {
+	const UINT64 completedValue = m_fence->GetCompletedValue();
+	m_releaseQueue.Release(completedValue);
+	return completedValue;
+}
+
+void D3D12CopyQueue::WaitForValue(UINT64 fenceValue) {
+	if (m_fence->GetCompletedValue() < fenceValue) {
+		ThrowIfFailed(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent));
+		WaitForSingleObject(m_fenceEvent, INFINITE);
+	}
+
+	m_releaseQueue.Release(fenceValue);
+}
+
+// ----------------------------
+// ----SimulatedCopyQueue----
+// ----------------------------
+
+SimulatedCopyQueue::SimulatedCopyQueue(Clock::duration latency, std::unique_ptr<CopyQueue> executor) :
+	m_latency{ latency },
+	m_executor{ std::move(executor) } {}
+
+UINT64 SimulatedCopyQueue::Submit(UploadBatchClass& batch) {
+	UINT64 executorFenceValue = 0;
+	if (m_executor) {
+		executorFenceValue = m_executor->Submit(batch);
+	}
+	else {
+		batch.Discard();
+	}
+
+	const UINT64 fenceValue = ++m_lastSubmittedValue;
+	m_pending.push_back({ fenceValue, executorFenceValue, Clock::now() + m_latency });
+
+	return fenceValue;
+}
+
+UINT64 SimulatedCopyQueue::GetCompletedValue() {
+	const auto now = Clock::now();
+	const UINT64 executorCompletedValue = m_executor ? m_executor->GetCompletedValue() : 0;
+
+	while (!m_pending.empty() && m_pending.front().completionTime <= now &&
+		m_pending.front().executorFenceValue <= executorCompletedValue) {
+		m_completedValue = m_pending.front().fenceValue;
+		m_pending.pop_front();
+	}
+
+	return m_completedValue;
+}
+
+void SimulatedCopyQueue::WaitForValue(UINT64 fenceValue) {
+	assert(fenceValue <= m_lastSubmittedValue);
+
+	while (GetCompletedValue() < fenceValue) {
+		const auto& pending = m_pending.front();
+		std::this_thread::sleep_until(pending.completionTime);
+
+		if (m_executor) {
+			m_executor->WaitForValue(pending.executorFenceValue);
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+
+#include "DeferredReleaseQueue.h"
+
+class UploadBatchClass;
+
+// ----------------------------
+// ----Class Definitions----
+// ----------------------------
+
+// Executes upload batches next to the direct queue. Every submission is identified by the fence
+// value it completes with, values increase by one per submission and complete in order.
+// D3DClass streams assets through this, the SimulatedCopyQueue lets that path run without a GPU.
+class CopyQueue {
+public:
+	virtual ~CopyQueue() = default;
+
+	// Records and executes the staged copies of the batch, leaving it empty. Returns the fence value.
+	virtual UINT64 Submit(UploadBatchClass& batch) = 0;
+
+	// Highest fence value whose copies have completed
+	virtual UINT64 GetCompletedValue() = 0;
+
+	// Blocks until the copies of fenceValue have completed
+	virtual void WaitForValue(UINT64 fenceValue) = 0;
+
+	UINT64 GetLastSubmittedValue() const { return m_lastSubmittedValue; }
+
+protected:
+	UINT64 m_lastSubmittedValue{ 0 };
+};
+
+// Submits to a D3D12_COMMAND_LIST_TYPE_COPY queue with its own fence.
+// Copy lists record no barriers: buffers and every resource accessed on a copy queue decay to the
+// common state once the copies have executed, from where the direct queue promotes them on first use.
+class D3D12CopyQueue final : public CopyQueue {
+public:
+	explicit D3D12CopyQueue(Microsoft::WRL::ComPtr<ID3D12Device> device);
+	~D3D12CopyQueue() override;
+
+	UINT64 Submit(UploadBatchClass& batch) override;
+	UINT64 GetCompletedValue() override;
+	void WaitForValue(UINT64 fenceValue) override;
+
+	// Delete functions
+	D3D12CopyQueue(D3D12CopyQueue const& rhs) = delete;
+	D3D12CopyQueue& operator=(D3D12CopyQueue const& rhs) = delete;
+
+	D3D12CopyQueue(D3D12CopyQueue&& rhs) = delete;
+	D3D12CopyQueue& operator=(D3D12CopyQueue&& rhs) = delete;
+
+private:
+	struct InFlightAllocator {
+		UINT64 fenceValue;
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+	};
+
+	const Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_commandQueue;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_commandList;
+	Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
+	HANDLE m_fenceEvent{ nullptr };
+
+	std::deque<InFlightAllocator> m_allocators;	// Ascending fence values, reused once completed
+	DeferredReleaseQueue m_releaseQueue;		// Staging chunks of the submitted batches
+};
+
+// Software stand-in for a copy queue. A batch reports completion once latency has passed since it
+// was submitted. Without an executor the staged data is dropped on submission, with one the batch
+// is executed there and also has to complete on it, so the uploads really arrive.
+class SimulatedCopyQueue final : public CopyQueue {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	explicit SimulatedCopyQueue(Clock::duration latency, std::unique_ptr<CopyQueue> executor = nullptr);
+
+	UINT64 Submit(UploadBatchClass& batch) override;
+	UINT64 GetCompletedValue() override;
+	void WaitForValue(UINT64 fenceValue) override;
+
+	// Delete functions
+	SimulatedCopyQueue(SimulatedCopyQueue const& rhs) = delete;
+	SimulatedCopyQueue& operator=(SimulatedCopyQueue const& rhs) = delete;
+
+	SimulatedCopyQueue(SimulatedCopyQueue&& rhs) = delete;
+	SimulatedCopyQueue& operator=(SimulatedCopyQueue&& rhs) = delete;
+
+private:
+	struct PendingSubmission {
+		UINT64 fenceValue;
+		UINT64 executorFenceValue;
+		Clock::time_point completionTime;
+	};
+
+	const Clock::duration m_latency;
+	const std::unique_ptr<CopyQueue> m_executor;
+	std::deque<PendingSubmission> m_pending;
+	UINT64 m_completedValue{ 0 };
+};
@@ -0,0 +1,383 @@
+#include "stdafx.h"
+#include "CullingClass.h"
+
+#include <intrin.h>
+#include <immintrin.h>
+
+namespace {
+	// A frustum plane with the box corner furthest along its normal already picked per axis
+	struct CullPlane {
+		const float* x;
+		const float* y;
+		const float* z;
+		float nx, ny, nz, d;
+	};
+
+	using CullPlanes = std::array<CullPlane, 6>;
+
+	CullPlanes BuildCullPlanes(
+		const Math::Frustum& frustum,
+		const std::vector<float>& minX, const std::vector<float>& minY, const std::vector<float>& minZ,
+		const std::vector<float>& maxX, const std::vector<float>& maxY, const std::vector<float>& maxZ) {
+
+		CullPlanes planes{};
+
+		for (UINT i = 0; i < 6; ++i) {
+			const Math::Vector4 plane = frustum.GetFrustumPlane(static_cast<Math::Frustum::PlaneID>(i));
+
+			auto& p = planes[i];
+			p.nx = plane.GetX();
+			p.ny = plane.GetY();
+			p.nz = plane.GetZ();
+			p.d = plane.GetW();
+
+			// Matches the corner selection of Frustum::IntersectBoundingBox
+			p.x = p.nx > 0.0f ? maxX.data() : minX.data();
+			p.y = p.ny > 0.0f ? maxY.data() : minY.data();
+			p.z = p.nz > 0.0f ? maxZ.data() : minZ.data();
+		}
+
+		return planes;
+	}
+
+	// Appends the set bits of a lane mask as box indices
+	inline UINT WriteVisibleLanes(UINT mask, UINT firstIndex, UINT* out) {
+		UINT written = 0;
+		while (mask) {
+			unsigned long lane;
+			_BitScanForward(&lane, mask);
+			out[written++] = firstIndex + lane;
+			mask &= mask - 1;
+		}
+		return written;
+	}
+
+	// Plane in the form used by the multi view kernels: distance of the box corner furthest along the
+	// normal is dot(n, center) + dot(|n|, extent) + d, so no per plane corner selection is needed
+	struct ViewPlane {
+		float nx, ny, nz, d;
+		float ax, ay, az;
+	};
+
+	using ViewPlanes = std::array<ViewPlane, 6>;
+
+	ViewPlanes BuildViewPlanes(const Math::Frustum& frustum) {
+		ViewPlanes planes{};
+
+		for (UINT i = 0; i < 6; ++i) {
+			const Math::Vector4 plane = frustum.GetFrustumPlane(static_cast<Math::Frustum::PlaneID>(i));
+
+			auto& p = planes[i];
+			p.nx = plane.GetX();
+			p.ny = plane.GetY();
+			p.nz = plane.GetZ();
+			p.d = plane.GetW();
+			p.ax = Math::Abs(p.nx);
+			p.ay = Math::Abs(p.ny);
+			p.az = Math::Abs(p.nz);
+		}
+
+		return planes;
+	}
+
+	inline UINT TailMask(UINT remaining, UINT batchSize) {
+		return remaining >= batchSize ? (1U << batchSize) - 1U : (1U << remaining) - 1U;
+	}
+}
+
+void CullingClass::Resize(UINT count) {
+	m_count = count;
+
+	const size_t paddedCount = Math::AlignUp(static_cast<size_t>(count), static_cast<size_t>(BatchPadding));
+	for (auto* arr : { &m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY, &m_maxZ }) {
+		arr->resize(paddedCount, 0.0f);
+	}
+}
+
+void CullingClass::SetBounds(UINT index, const Math::Vector3& minBound, const Math::Vector3& maxBound) {
+	assert(index < m_count);
+
+	m_minX[index] = minBound.GetX();
+	m_minY[index] = minBound.GetY();
+	m_minZ[index] = minBound.GetZ();
+	m_maxX[index] = maxBound.GetX();
+	m_maxY[index] = maxBound.GetY();
+	m_maxZ[index] = maxBound.GetZ();
+}
+
+bool CullingClass::IsAVX2Supported() {
+	static const bool supported = [] {
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+
+		// FMA, AVX and OS support for saving the YMM registers
+		__cpuid(info, 1);
+		const bool fma = (info[2] & (1 << 12)) != 0;
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if (!fma || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}();
+
+	return supported;
+}
+
+void CullingClass::Cull(const Math::Frustum& frustum, std::vector<UINT>& visibleIndices) const {
+	if (IsAVX2Supported()) {
+		CullAVX2(frustum, visibleIndices);
+	}
+	else {
+		CullSSE(frustum, visibleIndices);
+	}
+}
+
+void CullingClass::CullScalar(const Math::Frustum& frustum, std::vector<UINT>& visibleIndices) const {
+	const auto planes = BuildCullPlanes(frustum, m_minX, m_minY, m_minZ, m_maxX, m_maxY, m_maxZ);
+
+	visibleIndices.resize(m_count);
+	UINT numVisible = 0;
+
+	for (UINT i = 0; i < m_count; ++i) {
+		bool inside = true;
+		for (const auto& p : planes) {
+			if (p.x[i] * p.nx + p.y[i] * p.ny + p.z[i] * p.nz + p.d < 0.0f) {
+				inside = false;
+				break;
+			}
+		}
+
+		if (inside) {
+			visibleIndices[numVisible++] = i;
+		}
+	}
+
+	visibleIndices.resize(numVisible);
+}
+
+void CullingClass::CullSSE(const Math::Frustum& frustum, std::vector<UINT>& visibleIndices) const {
+	constexpr UINT BatchSize = 4;
+	const auto planes = BuildCullPlanes(frustum, m_minX, m_minY, m_minZ, m_maxX, m_maxY, m_maxZ);
+
+	__m128 nx[6], ny[6], nz[6], d[6];
+	for (UINT p = 0; p < 6; ++p) {
+		nx[p] = _mm_set1_ps(planes[p].nx);
+		ny[p] = _mm_set1_ps(planes[p].ny);
+		nz[p] = _mm_set1_ps(planes[p].nz);
+		d[p] = _mm_set1_ps(planes[p].d);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+
+	visibleIndices.resize(m_count);
+	UINT* out = visibleIndices.data();
+	UINT numVisible = 0;
+
+	for (UINT i = 0; i < m_count; i += BatchSize) {
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for (UINT p = 0; p < 6; ++p) {
+			__m128 dist = _mm_mul_ps(_mm_loadu_ps(planes[p].x + i), nx[p]);
+			dist = _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(planes[p].y + i), ny[p]));
+			dist = _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(planes[p].z + i), nz[p]));
+			dist = _mm_add_ps(dist, d[p]);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, zero));
+		}
+
+		const UINT mask = static_cast<UINT>(_mm_movemask_ps(inside)) & TailMask(m_count - i, BatchSize);
+		numVisible += WriteVisibleLanes(mask, i, out + numVisible);
+	}
+
+	visibleIndices.resize(numVisible);
+}
+
+void CullingClass::CullAVX2(const Math::Frustum& frustum, std::vector<UINT>& visibleIndices) const {
+	constexpr UINT BatchSize = 8;
+	const auto planes = BuildCullPlanes(frustum, m_minX, m_minY, m_minZ, m_maxX, m_maxY, m_maxZ);
+
+	__m256 nx[6], ny[6], nz[6], d[6];
+	for (UINT p = 0; p < 6; ++p) {
+		nx[p] = _mm256_set1_ps(planes[p].nx);
+		ny[p] = _mm256_set1_ps(planes[p].ny);
+		nz[p] = _mm256_set1_ps(planes[p].nz);
+		d[p] = _mm256_set1_ps(planes[p].d);
+	}
+
+	const __m256 zero = _mm256_setzero_ps();
+
+	visibleIndices.resize(m_count);
+	UINT* out = visibleIndices.data();
+	UINT numVisible = 0;
+
+	for (UINT i = 0; i < m_count; i += BatchSize) {
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for (UINT p = 0; p < 6; ++p) {
+			__m256 dist = _mm256_fmadd_ps(_mm256_loadu_ps(planes[p].x + i), nx[p], d[p]);
+			dist = _mm256_fmadd_ps(_mm256_loadu_ps(planes[p].y + i), ny[p], dist);
+			dist = _mm256_fmadd_ps(_mm256_loadu_ps(planes[p].z + i), nz[p], dist);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, zero, _CMP_GE_OQ));
+		}
+
+		const UINT mask = static_cast<UINT>(_mm256_movemask_ps(inside)) & TailMask(m_count - i, BatchSize);
+		numVisible += WriteVisibleLanes(mask, i, out + numVisible);
+	}
+
+	// Avoid the AVX to SSE transition penalty in the code that follows
+	_mm256_zeroupper();
+
+	visibleIndices.resize(numVisible);
+}
+
+void CullingClass::CullViews(
+	const Math::Frustum* frusta,
+	UINT numViews,
+	std::vector<UINT8>& viewMasks,
+	std::vector<UINT>* visibleIndices) const {
+
+	assert(numViews <= MaxViews);
+
+	if (IsAVX2Supported()) {
+		CullViewsAVX2(frusta, numViews, viewMasks);
+	}
+	else {
+		CullViewsSSE(frusta, numViews, viewMasks);
+	}
+
+	if (visibleIndices) {
+		BuildViewLists(viewMasks, numViews, visibleIndices);
+	}
+}
+
+void CullingClass::CullViewsSSE(const Math::Frustum* frusta, UINT numViews, std::vector<UINT8>& viewMasks) const {
+	constexpr UINT BatchSize = 4;
+	assert(numViews <= MaxViews);
+
+	std::array<ViewPlanes, MaxViews> views;
+	for (UINT v = 0; v < numViews; ++v) {
+		views[v] = BuildViewPlanes(frusta[v]);
+	}
+
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	viewMasks.resize(Math::AlignUp(static_cast<size_t>(m_count), static_cast<size_t>(BatchPadding)));
+
+	for (UINT i = 0; i < m_count; i += BatchSize) {
+		// Load each box once, every view reuses the center and extent
+		const __m128 minX = _mm_loadu_ps(m_minX.data() + i), maxX = _mm_loadu_ps(m_maxX.data() + i);
+		const __m128 minY = _mm_loadu_ps(m_minY.data() + i), maxY = _mm_loadu_ps(m_maxY.data() + i);
+		const __m128 minZ = _mm_loadu_ps(m_minZ.data() + i), maxZ = _mm_loadu_ps(m_maxZ.data() + i);
+
+		const __m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half), ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+		const __m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half), ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+		const __m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half), ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+
+		__m128i masks = _mm_setzero_si128();
+
+		for (UINT v = 0; v < numViews; ++v) {
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+			for (const auto& p : views[v]) {
+				__m128 dist = _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(p.nx)), _mm_set1_ps(p.d));
+				dist = _mm_add_ps(dist, _mm_mul_ps(cy, _mm_set1_ps(p.ny)));
+				dist = _mm_add_ps(dist, _mm_mul_ps(cz, _mm_set1_ps(p.nz)));
+				dist = _mm_add_ps(dist, _mm_mul_ps(ex, _mm_set1_ps(p.ax)));
+				dist = _mm_add_ps(dist, _mm_mul_ps(ey, _mm_set1_ps(p.ay)));
+				dist = _mm_add_ps(dist, _mm_mul_ps(ez, _mm_set1_ps(p.az)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, zero));
+			}
+
+			masks = _mm_or_si128(masks, _mm_and_si128(_mm_castps_si128(inside), _mm_set1_epi32(1 << v)));
+		}
+
+		alignas(16) UINT32 laneMasks[BatchSize];
+		_mm_store_si128(reinterpret_cast<__m128i*>(laneMasks), masks);
+		for (UINT lane = 0; lane < BatchSize; ++lane) {
+			viewMasks[i + lane] = static_cast<UINT8>(laneMasks[lane]);
+		}
+	}
+
+	viewMasks.resize(m_count);
+}
+
+void CullingClass::CullViewsAVX2(const Math::Frustum* frusta, UINT numViews, std::vector<UINT8>& viewMasks) const {
+	constexpr UINT BatchSize = 8;
+	assert(numViews <= MaxViews);
+
+	std::array<ViewPlanes, MaxViews> views;
+	for (UINT v = 0; v < numViews; ++v) {
+		views[v] = BuildViewPlanes(frusta[v]);
+	}
+
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	viewMasks.resize(Math::AlignUp(static_cast<size_t>(m_count), static_cast<size_t>(BatchPadding)));
+
+	for (UINT i = 0; i < m_count; i += BatchSize) {
+		// Load each box once, every view reuses the center and extent
+		const __m256 minX = _mm256_loadu_ps(m_minX.data() + i), maxX = _mm256_loadu_ps(m_maxX.data() + i);
+		const __m256 minY = _mm256_loadu_ps(m_minY.data() + i), maxY = _mm256_loadu_ps(m_maxY.data() + i);
+		const __m256 minZ = _mm256_loadu_ps(m_minZ.data() + i), maxZ = _mm256_loadu_ps(m_maxZ.data() + i);
+
+		const __m256 cx = _mm256_mul_ps(_mm256_add_ps(minX, maxX), half), ex = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half);
+		const __m256 cy = _mm256_mul_ps(_mm256_add_ps(minY, maxY), half), ey = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half);
+		const __m256 cz = _mm256_mul_ps(_mm256_add_ps(minZ, maxZ), half), ez = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half);
+
+		__m256i masks = _mm256_setzero_si256();
+
+		for (UINT v = 0; v < numViews; ++v) {
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+			for (const auto& p : views[v]) {
+				__m256 dist = _mm256_fmadd_ps(cx, _mm256_set1_ps(p.nx), _mm256_set1_ps(p.d));
+				dist = _mm256_fmadd_ps(cy, _mm256_set1_ps(p.ny), dist);
+				dist = _mm256_fmadd_ps(cz, _mm256_set1_ps(p.nz), dist);
+				dist = _mm256_fmadd_ps(ex, _mm256_set1_ps(p.ax), dist);
+				dist = _mm256_fmadd_ps(ey, _mm256_set1_ps(p.ay), dist);
+				dist = _mm256_fmadd_ps(ez, _mm256_set1_ps(p.az), dist);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, zero, _CMP_GE_OQ));
+			}
+
+			masks = _mm256_or_si256(masks, _mm256_and_si256(_mm256_castps_si256(inside), _mm256_set1_epi32(1 << v)));
+		}
+
+		alignas(32) UINT32 laneMasks[BatchSize];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(laneMasks), masks);
+		for (UINT lane = 0; lane < BatchSize; ++lane) {
+			viewMasks[i + lane] = static_cast<UINT8>(laneMasks[lane]);
+		}
+	}
+
+	_mm256_zeroupper();
+
+	viewMasks.resize(m_count);
+}
+
+void CullingClass::BuildViewLists(const std::vector<UINT8>& viewMasks, UINT numViews, std::vector<UINT>* visibleIndices) {
+	const UINT count = static_cast<UINT>(viewMasks.size());
+
+	std::array<UINT*, MaxViews> out{};
+	std::array<UINT, MaxViews> numVisible{};
+	for (UINT v = 0; v < numViews; ++v) {
+		visibleIndices[v].resize(count);
+		out[v] = visibleIndices[v].data();
+	}
+
+	for (UINT i = 0; i < count; ++i) {
+		UINT mask = viewMasks[i];
+		while (mask) {
+			unsigned long view;
+			_BitScanForward(&view, mask);
+			out[view][numVisible[view]++] = i;
+			mask &= mask - 1;
+		}
+	}
+
+	for (UINT v = 0; v < numViews; ++v) {
+		visibleIndices[v].resize(numVisible[v]);
+	}
+}
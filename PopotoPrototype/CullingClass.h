@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Math/Frustum.h"
+
+// Axis aligned bounding boxes kept as structure of arrays (minX[], minY[], ..., maxZ[]) so that
+// a frustum plane can be tested against 4 (SSE) or 8 (AVX2) boxes with a single instruction.
+class CullingClass
+{
+public:
+	CullingClass() = default;
+
+	// Boxes are addressed by index, new boxes are empty at the origin
+	void Resize(UINT count);
+	UINT GetCount() const { return m_count; }
+
+	void SetBounds(UINT index, const Math::Vector3& minBound, const Math::Vector3& maxBound);
+
+	// Fills visibleIndices with the indices of every box intersecting the frustum, in ascending order.
+	// Picks the widest instruction set the CPU supports.
+	void Cull(const Math::Frustum& frustum, std::vector<UINT>& visibleIndices) const;
+
+	// Fixed instruction set variants, Cull dispatches to one of these
+	void CullScalar(const Math::Frustum& frustum, std::vector<UINT>& visibleIndices) const;
+	void CullSSE(const Math::Frustum& frustum, std::vector<UINT>& visibleIndices) const;
+	void CullAVX2(const Math::Frustum& frustum, std::vector<UINT>& visibleIndices) const;
+
+	// Tests every box once against up to MaxViews frusta. Bit v of viewMasks[i] is set when box i
+	// intersects frusta[v], and visibleIndices[v] receives the indices visible in view v.
+	static constexpr UINT MaxViews = 8;
+	void CullViews(
+		const Math::Frustum* frusta,
+		UINT numViews,
+		std::vector<UINT8>& viewMasks,
+		std::vector<UINT>* visibleIndices) const;
+
+	void CullViewsSSE(const Math::Frustum* frusta, UINT numViews, std::vector<UINT8>& viewMasks) const;
+	void CullViewsAVX2(const Math::Frustum* frusta, UINT numViews, std::vector<UINT8>& viewMasks) const;
+
+	// Splits per box view masks into per view index lists
+	static void BuildViewLists(const std::vector<UINT8>& viewMasks, UINT numViews, std::vector<UINT>* visibleIndices);
+
+	static bool IsAVX2Supported();
+
+	// Delete functions
+	CullingClass(CullingClass const& rhs) = delete;
+	CullingClass& operator=(CullingClass const& rhs) = delete;
+
+	CullingClass(CullingClass&& rhs) = delete;
+	CullingClass& operator=(CullingClass&& rhs) = delete;
+
+private:
+	// The arrays are padded to a multiple of the widest batch so the last batch can be loaded whole
+	static constexpr UINT BatchPadding = 8;
+
+	UINT m_count{ 0 };
+	std::vector<float> m_minX, m_minY, m_minZ;
+	std::vector<float> m_maxX, m_maxY, m_maxZ;
+};
@@ -0,0 +1,163 @@
+#include "stdafx.h"
+#include "D3D12RenderBackend.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+	D3D12_RESOURCE_STATES ToResourceState(ResourceState state) {
+		switch (state) {
+		case ResourceState::Present: return D3D12_RESOURCE_STATE_PRESENT;
+		case ResourceState::RenderTarget: return D3D12_RESOURCE_STATE_RENDER_TARGET;
+		case ResourceState::DepthWrite: return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+		case ResourceState::PixelShaderResource: return D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		default: {
+			assert(false);
+			return D3D12_RESOURCE_STATE_COMMON;
+		}}
+	}
+
+	D3D12_CPU_DESCRIPTOR_HANDLE ToD3D12(CpuDescriptorHandle handle) {
+		return { static_cast<SIZE_T>(handle.ptr) };
+	}
+
+	template<typename T, typename Handle>
+	T* ToObject(Handle handle) {
+		return reinterpret_cast<T*>(static_cast<UINT64>(handle));
+	}
+}
+
+// ----------------------------
+// ----D3D12RenderBackend----
+// ----------------------------
+
+D3D12RenderBackend::D3D12RenderBackend(ComPtr<ID3D12Device> device, ComPtr<ID3D12GraphicsCommandList> cmdList) :
+	m_device{ device },
+	m_commandList{ cmdList } {}
+
+void D3D12RenderBackend::Reset(CommandAllocatorHandle allocator, PipelineHandle initialState) {
+	auto* commandAllocator = ToObject<ID3D12CommandAllocator>(allocator);
+	Utility::ThrowIfFailed(commandAllocator->Reset());
+	Utility::ThrowIfFailed(m_commandList->Reset(commandAllocator, ToObject<ID3D12PipelineState>(initialState)));
+}
+
+void D3D12RenderBackend::Close() {
+	Utility::ThrowIfFailed(m_commandList->Close());
+}
+
+void D3D12RenderBackend::SetDescriptorHeap(DescriptorHeapHandle heap) {
+	ID3D12DescriptorHeap* ppHeaps[] = { ToObject<ID3D12DescriptorHeap>(heap) };
+	m_commandList->SetDescriptorHeaps(std::extent_v<decltype(ppHeaps)>, ppHeaps);
+}
+
+void D3D12RenderBackend::SetGraphicsRootSignature(RootSignatureHandle rootSignature) {
+	m_commandList->SetGraphicsRootSignature(ToObject<ID3D12RootSignature>(rootSignature));
+}
+
+void D3D12RenderBackend::SetPipelineState(PipelineHandle pipelineState) {
+	m_commandList->SetPipelineState(ToObject<ID3D12PipelineState>(pipelineState));
+}
+
+void D3D12RenderBackend::IASetPrimitiveTopology(PrimitiveTopology topology) {
+	assert(topology == PrimitiveTopology::TriangleList);
+	m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void D3D12RenderBackend::IASetVertexBuffer(const VertexBufferBinding& binding) {
+	const D3D12_VERTEX_BUFFER_VIEW view{ binding.address, binding.sizeInBytes, binding.strideInBytes };
+	m_commandList->IASetVertexBuffers(0, 1, &view);
+}
+
+void D3D12RenderBackend::IASetIndexBuffer(const IndexBufferBinding& binding) {
+	const D3D12_INDEX_BUFFER_VIEW view{
+		binding.address,
+		binding.sizeInBytes,
+		binding.format == IndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT
+	};
+	m_commandList->IASetIndexBuffer(&view);
+}
+
+void D3D12RenderBackend::RSSetViewport(const Viewport& viewport) {
+	const D3D12_VIEWPORT d3dViewport{ viewport.x, viewport.y, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth };
+	m_commandList->RSSetViewports(1, &d3dViewport);
+}
+
+void D3D12RenderBackend::RSSetScissorRect(const ScissorRect& rect) {
+	const D3D12_RECT d3dRect{ rect.left, rect.top, rect.right, rect.bottom };
+	m_commandList->RSSetScissorRects(1, &d3dRect);
+}
+
+void D3D12RenderBackend::OMSetRenderTargets(const CpuDescriptorHandle* rtv, const CpuDescriptorHandle* dsv) {
+	const auto d3dRtv = rtv ? ToD3D12(*rtv) : D3D12_CPU_DESCRIPTOR_HANDLE{};
+	const auto d3dDsv = dsv ? ToD3D12(*dsv) : D3D12_CPU_DESCRIPTOR_HANDLE{};
+	m_commandList->OMSetRenderTargets(rtv ? 1U : 0U, rtv ? &d3dRtv : nullptr, FALSE, dsv ? &d3dDsv : nullptr);
+}
+
+void D3D12RenderBackend::ClearDepthStencilView(CpuDescriptorHandle dsv, float depth, UINT8 stencil) {
+	m_commandList->ClearDepthStencilView(ToD3D12(dsv), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, depth, stencil, 0U, nullptr);
+}
+
+void D3D12RenderBackend::ClearRenderTargetView(CpuDescriptorHandle rtv, const FLOAT colour[4]) {
+	m_commandList->ClearRenderTargetView(ToD3D12(rtv), colour, 0, nullptr);
+}
+
+void D3D12RenderBackend::ResourceBarrier(UINT numBarriers, const ResourceTransition* barriers) {
+	std::array<D3D12_RESOURCE_BARRIER, MaxBatchSize> d3dBarriers{};
+
+	for (UINT first = 0; first < numBarriers; first += MaxBatchSize) {
+		const UINT count = std::min(MaxBatchSize, numBarriers - first);
+		for (UINT i = 0; i < count; ++i) {
+			const auto& barrier = barriers[first + i];
+			d3dBarriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(
+				ToObject<ID3D12Resource>(barrier.resource),
+				ToResourceState(barrier.before),
+				ToResourceState(barrier.after)
+			);
+		}
+		m_commandList->ResourceBarrier(count, d3dBarriers.data());
+	}
+}
+
+void D3D12RenderBackend::SetGraphicsRootConstantBufferView(UINT rootIndex, GpuAddress address) {
+	m_commandList->SetGraphicsRootConstantBufferView(rootIndex, address);
+}
+
+void D3D12RenderBackend::SetGraphicsRootDescriptorTable(UINT rootIndex, GpuDescriptorHandle handle) {
+	m_commandList->SetGraphicsRootDescriptorTable(rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE{ handle.ptr });
+}
+
+void D3D12RenderBackend::SetGraphicsRootShaderResourceView(UINT rootIndex, GpuAddress address) {
+	m_commandList->SetGraphicsRootShaderResourceView(rootIndex, address);
+}
+
+void D3D12RenderBackend::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) {
+	m_commandList->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void D3D12RenderBackend::CopyDescriptors(UINT numDescriptors, const CpuDescriptorHandle* dst, const CpuDescriptorHandle* src) {
+	if (numDescriptors == 1) {
+		m_device->CopyDescriptorsSimple(1U, ToD3D12(*dst), ToD3D12(*src), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		return;
+	}
+
+	std::array<D3D12_CPU_DESCRIPTOR_HANDLE, MaxBatchSize> d3dDst{};
+	std::array<D3D12_CPU_DESCRIPTOR_HANDLE, MaxBatchSize> d3dSrc{};
+
+	for (UINT first = 0; first < numDescriptors; first += MaxBatchSize) {
+		const UINT count = std::min(MaxBatchSize, numDescriptors - first);
+		for (UINT i = 0; i < count; ++i) {
+			d3dDst[i] = ToD3D12(dst[first + i]);
+			d3dSrc[i] = ToD3D12(src[first + i]);
+		}
+
+		// Null range sizes mean every range holds a single descriptor
+		m_device->CopyDescriptors(
+			count,
+			d3dDst.data(),
+			nullptr,
+			count,
+			d3dSrc.data(),
+			nullptr,
+			D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
+		);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "RenderBackend.h"
+
+// ----------------------------
+// ----Handle Conversions----
+// ----------------------------
+
+// The D3D12 objects behind the handles of RenderBackend. Handles hold the object pointer and
+// descriptor handles their address, D3D12RenderBackend turns them back.
+namespace D3D12Handles {
+	inline CommandAllocatorHandle ToHandle(ID3D12CommandAllocator* allocator) { return static_cast<CommandAllocatorHandle>(reinterpret_cast<UINT64>(allocator)); }
+	inline PipelineHandle ToHandle(ID3D12PipelineState* pipelineState) { return static_cast<PipelineHandle>(reinterpret_cast<UINT64>(pipelineState)); }
+	inline RootSignatureHandle ToHandle(ID3D12RootSignature* rootSignature) { return static_cast<RootSignatureHandle>(reinterpret_cast<UINT64>(rootSignature)); }
+	inline DescriptorHeapHandle ToHandle(ID3D12DescriptorHeap* heap) { return static_cast<DescriptorHeapHandle>(reinterpret_cast<UINT64>(heap)); }
+	inline ResourceHandle ToHandle(ID3D12Resource* resource) { return static_cast<ResourceHandle>(reinterpret_cast<UINT64>(resource)); }
+
+	inline CpuDescriptorHandle ToHandle(D3D12_CPU_DESCRIPTOR_HANDLE handle) { return { static_cast<UINT64>(handle.ptr) }; }
+	inline GpuDescriptorHandle ToHandle(D3D12_GPU_DESCRIPTOR_HANDLE handle) { return { handle.ptr }; }
+
+	inline IndexFormat ToIndexFormat(DXGI_FORMAT format) { return format == DXGI_FORMAT_R16_UINT ? IndexFormat::UInt16 : IndexFormat::UInt32; }
+}
+
+// ----------------------------
+// ----Class Definitions----
+// ----------------------------
+
+// Forwards every call to a D3D12 command list
+class D3D12RenderBackend final : public RenderBackend {
+public:
+	D3D12RenderBackend(
+		Microsoft::WRL::ComPtr<ID3D12Device> device,
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> cmdList);
+
+	void Reset(CommandAllocatorHandle allocator, PipelineHandle initialState) override;
+	void Close() override;
+
+	void SetDescriptorHeap(DescriptorHeapHandle heap) override;
+	void SetGraphicsRootSignature(RootSignatureHandle rootSignature) override;
+	void SetPipelineState(PipelineHandle pipelineState) override;
+
+	void IASetPrimitiveTopology(PrimitiveTopology topology) override;
+	void IASetVertexBuffer(const VertexBufferBinding& binding) override;
+	void IASetIndexBuffer(const IndexBufferBinding& binding) override;
+
+	void RSSetViewport(const Viewport& viewport) override;
+	void RSSetScissorRect(const ScissorRect& rect) override;
+
+	void OMSetRenderTargets(const CpuDescriptorHandle* rtv, const CpuDescriptorHandle* dsv) override;
+	void ClearDepthStencilView(CpuDescriptorHandle dsv, float depth, UINT8 stencil) override;
+	void ClearRenderTargetView(CpuDescriptorHandle rtv, const FLOAT colour[4]) override;
+
+	void ResourceBarrier(UINT numBarriers, const ResourceTransition* barriers) override;
+
+	void SetGraphicsRootConstantBufferView(UINT rootIndex, GpuAddress address) override;
+	void SetGraphicsRootDescriptorTable(UINT rootIndex, GpuDescriptorHandle handle) override;
+	void SetGraphicsRootShaderResourceView(UINT rootIndex, GpuAddress address) override;
+
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) override;
+
+	void CopyDescriptors(UINT numDescriptors, const CpuDescriptorHandle* dst, const CpuDescriptorHandle* src) override;
+
+	// Delete functions
+	D3D12RenderBackend(D3D12RenderBackend const& rhs) = delete;
+	D3D12RenderBackend& operator=(D3D12RenderBackend const& rhs) = delete;
+
+	D3D12RenderBackend(D3D12RenderBackend&& rhs) = delete;
+	D3D12RenderBackend& operator=(D3D12RenderBackend&& rhs) = delete;
+
+private:
+	// Batches larger than this are split into several D3D12 calls
+	static constexpr UINT MaxBatchSize = 16;
+
+	const Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	const Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_commandList;
+};
@@ -1,9 +1,12 @@
 #include "stdafx.h"
 #include "D3DClass.h"
 #include "InputClass.h"
+#include "Profiler.h"
+#include "SceneImporter.h"
 
 using Vertex = GeometryClass::Vertex;
 using Microsoft::WRL::ComPtr;
+using D3D12Handles::ToHandle;
 using namespace Utility;
 
 // Function to find and select the graphics adapter with the largest amount of video memory which can be assumed to be the 'best' choice
@@ -43,8 +46,8 @@ D3DClass::D3DClass(int sWidth, int sHeight, float fFar, float fNear, bool vSync,
 	m_aspectRatio(static_cast<float>(sWidth) / static_cast<float>(sHeight)),
 	m_farClip(fFar),
 	m_nearClip(fNear),
-	m_viewport(0.0f, 0.0f, static_cast<float>(sWidth), static_cast<float>(sHeight)),
-	m_scissorRect(0, 0, static_cast<LONG>(sWidth), static_cast<LONG>(sHeight)) {
+	m_viewport{ 0.0f, 0.0f, static_cast<float>(sWidth), static_cast<float>(sHeight), 0.0f, 1.0f },
+	m_scissorRect{ 0, 0, static_cast<INT32>(sWidth), static_cast<INT32>(sHeight) } {
 
 	UINT dxgiFactoryFlags = 0;
 
@@ -68,6 +71,7 @@ D3DClass::D3DClass(int sWidth, int sHeight, float fFar, float fNear, bool vSync,
 	// Poll for the best available hw adapter and create the device
 	ComPtr<IDXGIAdapter1> hardwareAdapter;
 	GetHardwareAdapter(factory.Get(), &hardwareAdapter);
+	ThrowIfFailed(hardwareAdapter.As(&m_adapter));
 	ThrowIfFailed(D3D12CreateDevice(
 		hardwareAdapter.Get(),
 		D3D_FEATURE_LEVEL_11_0,
@@ -127,6 +131,7 @@ D3DClass::D3DClass(int sWidth, int sHeight, float fFar, float fNear, bool vSync,
 		ThrowIfFailed(m_device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsvHeap)));
 
 		m_rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+		m_cbvSrvUavDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 	}
 
 	// Create frame resources
@@ -180,11 +185,11 @@ D3DClass::~D3DClass() {
 }
 
 void D3DClass::Render() {
-	m_camera->Update();
+	PROFILE_SCOPE("D3DClass::Render");
 
 	if (GetAsyncKeyState(VK_F7)) {
 		const auto curPos = m_camera->GetPosition();
-		m_models[0].m_Transform.SetTranslation(curPos);
+		m_models[0].SetTranslation(curPos);
 		for (UINT i = 0; i < 6; ++i) {
 			m_pointLight.transform[i]->SetPosition(curPos);
 			m_pointLight.transform[i]->Update();
@@ -200,7 +205,7 @@ void D3DClass::Render() {
 
 		static float t = 0;
 		const auto curPos = Vector3(DirectX::XMVectorLerp(vecStart, vecEnd, t));
-		m_models[0].m_Transform.SetTranslation(curPos);
+		m_models[0].SetTranslation(curPos);
 
 		static bool dir = true;
 		if (dir) {
@@ -222,227 +227,200 @@ void D3DClass::Render() {
 		}
 	}
 
-	PopulateCommandList();
-
-	ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-	m_commandQueue->ExecuteCommandLists(std::extent_v<decltype(ppCommandLists)>, ppCommandLists);
-
-	if (m_vsync_enabled) {
-		ThrowIfFailed(m_swapChain->Present(1, 0));
-	}
-	else {
-		ThrowIfFailed(m_swapChain->Present(0, 0));
-	}
-
-	MoveToNextFrame();
-}
-
-void D3DClass::UpdateModel(ModelClass& aModel) {
-	aModel.m_modelConstantBuffer.worldMat = Matrix4(aModel.m_Transform) * Matrix4::MakeScale(aModel.m_UniformScale);
-	m_modelConstantBufferData[m_frameIndex][aModel.m_id] = aModel.m_modelConstantBuffer;
+	RecordFrame();
 
-	auto& material = aModel.m_material;
-	m_materialConstantBufferData[m_frameIndex][material.m_id] = material.m_materialConstantBuffer;
-}
-
-const std::array<const char*, 11> g_bannedModelNames{
-	"PlanarReflection_1",
-	"PlanarReflection2",
-	"Cube2",
-	"Cube3",
-	"Cube4",
-	"Cube5_3",
-	"Cube_2",
-	"Cube6_2",
-	"Cube7",
-	"sponza_04",
-	"BP_Sky_Sphere_256"
-};
-
-void D3DClass::PopulateCommandList() {
-
-	// Reset command allocator and lists
-	ThrowIfFailed(m_commandAllocators[m_frameIndex]->Reset());
-	ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_defaultPipelineState.Get()));
-
-	// Set required state
-	ID3D12DescriptorHeap* ppHeaps[] = { m_srvHeapDynamic[m_frameIndex].Get() };
-	m_commandList->SetDescriptorHeaps(std::extent_v<decltype(ppHeaps)>, ppHeaps);
-
-	m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
-
-	UpdateMainPass();
+	{
+		PROFILE_SCOPE("D3DClass::Submit");
 
-	m_commandList->SetGraphicsRootConstantBufferView(
-		RootParameterIndices::MainPass, 
-		m_mainPassConstantBufferResource[m_frameIndex]->GetGPUVirtualAddress());
+		ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+		m_commandQueue->ExecuteCommandLists(std::extent_v<decltype(ppCommandLists)>, ppCommandLists);
 
-	for (auto& model : m_models) {
-		UpdateModel(model);
+		if (m_vsync_enabled) {
+			ThrowIfFailed(m_swapChain->Present(1, 0));
+		}
+		else {
+			ThrowIfFailed(m_swapChain->Present(0, 0));
+		}
 	}
 
-	m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-	RenderSceneToShadowMap(m_directionalLight);
-	RenderSceneToShadowMap(m_pointLight);
-
-	m_commandList->RSSetViewports(1, &m_viewport);
-	m_commandList->RSSetScissorRects(1, &m_scissorRect);
+	m_frameMemory->EndFrame(m_fenceValues[m_frameIndex]);
+	m_releaseQueue.Submit(m_fenceValues[m_frameIndex]);
 
-	// Signal the commandlist that the back buffer will be used as the render target
 	{
-		const auto transitionBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-			m_renderTargets[m_frameIndex].Get(),
-			D3D12_RESOURCE_STATE_PRESENT,
-			D3D12_RESOURCE_STATE_RENDER_TARGET
-		);
-
-		m_commandList->ResourceBarrier(1, &transitionBarrier);
+		PROFILE_SCOPE("D3DClass::MoveToNextFrame");
+		MoveToNextFrame();
 	}
+}
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(
-		m_rtvHeap->GetCPUDescriptorHandleForHeapStart(),
-		m_frameIndex, 
-		m_rtvDescriptorSize
-	);
-
-	CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(
-		m_dsvHeap->GetCPUDescriptorHandleForHeapStart()
-	);
-
-	m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
-	//m_commandList->SetPipelineState(m_defaultPipelineState.Get());
+void D3DClass::RecordFrame() {
+	PROFILE_SCOPE("D3DClass::RecordFrame");
 
-	// Issue commands to the commandlist
+	// Reclaim the upload memory of frames the GPU has finished
 	{
-		// Start clearing the rendertarget
-		constexpr std::array<FLOAT, 4> clearColour = { 0.3f, 0.5f, 0.8f, 1.0f };
-		m_commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0UI8, 0U, nullptr);
-		m_commandList->ClearRenderTargetView(rtvHandle, clearColour.data(), 0, nullptr);
-
-		std::vector<UINT> shadowMapIDs{ m_directionalLight.shadowMap->GetTextureID(), m_pointLight.shadowMap->GetTextureID() };
-		RenderAllModels(&shadowMapIDs);
+		const auto completedFenceValue = m_fence->GetCompletedValue();
+		m_frameMemory->BeginFrame(completedFenceValue);
+		m_releaseQueue.Release(completedFenceValue);
 	}
 
-	// Signal the commandlist that the back buffer is to be presented
-	{
-		const auto transitionBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-			m_renderTargets[m_frameIndex].Get(),
-			D3D12_RESOURCE_STATE_RENDER_TARGET,
-			D3D12_RESOURCE_STATE_PRESENT
-		);
+	// Models whose streamed uploads have completed become drawable this frame
+	m_streamer->Update();
 
-		m_commandList->ResourceBarrier(1, &transitionBarrier);
-	}
+	// The light is moved before anything reads it, so the uploaded pass constants, the shadow passes
+	// and the culling frusta all see the same light
+	UpdateViews();
 
-	ThrowIfFailed(m_commandList->Close());
+	m_frameBuilder.RecordFrame(*m_backend, *m_frameMemory, GetFrameScene(), GetFrameTargets(), m_frameIndex);
 }
 
-void D3DClass::RenderSceneToShadowMap(const ShadowCaster& sc) {
-
-	{
-		if (GetAsyncKeyState(VK_F2)) {
-			m_directionalLight.transform[0]->SetDirection(Matrix3::MakeYRotation(0.0005f) * m_directionalLight.transform[0]->GetForward(), Vector3(kYUnitVector));
-			m_directionalLight.transform[0]->SetPosition(-1.0f * 1.25f * m_directionalLight.transform[0]->GetForward());
-		}
-		if (GetAsyncKeyState(VK_F3)) {
-			m_directionalLight.transform[0]->SetDirection(Matrix3::MakeYRotation(0.01f) * m_directionalLight.transform[0]->GetForward(), Vector3(kYUnitVector));
-			m_directionalLight.transform[0]->SetPosition(-1.0f * 1.25f * m_directionalLight.transform[0]->GetForward());
-		}
+void D3DClass::UpdateViews() {
+	m_camera->Update();
+	UpdateLights();
+	UpdateMainPass();
 
-		m_directionalLight.transform[0]->Update();
+	// The light's projection can differ from the one its transform was created with, so build the frusta from projMatrix
+	m_views[RenderView::Camera].frustum = m_camera->GetWorldSpaceFrustum();
+	m_views[RenderView::Camera].position = m_camera->GetPosition();
+	m_views[RenderView::Camera].forward = m_camera->GetForward();
+
+	const auto& directionalTransform = *m_directionalLight.transform[0];
+	auto& directionalView = m_views[RenderView::DirectionalLight];
+	directionalView.frustum = directionalTransform.GetCameraToWorld() * m_directionalLight.projFrustum;
+	directionalView.position = directionalTransform.GetPosition();
+	directionalView.forward = directionalTransform.GetForward();
+	directionalView.viewProjMat = m_directionalLight.projMatrix * directionalTransform.GetViewMatrix();
+
+	for (UINT i = 0; i < 6; ++i) {
+		const auto& faceTransform = *m_pointLight.transform[i];
+		auto& faceView = m_views[RenderView::PointLightFace0 + i];
+		faceView.frustum = faceTransform.GetCameraToWorld() * m_pointLight.projFrustum;
+		faceView.position = faceTransform.GetPosition();
+		faceView.forward = faceTransform.GetForward();
+		faceView.viewProjMat = m_pointLight.projMatrix * faceTransform.GetViewMatrix();
 	}
 
-	const auto& shadowMap = sc.shadowMap;
-
-	m_commandList->RSSetViewports(1, &shadowMap->m_viewport);
-	m_commandList->RSSetScissorRects(1, &shadowMap->m_scissorRect);
-
-	{
-		const auto transitionBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-			shadowMap->Resource().Get(),
-			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-			D3D12_RESOURCE_STATE_DEPTH_WRITE
-		);
-
-		m_commandList->ResourceBarrier(1, &transitionBarrier);
+	// Only the directional light uses an orthographic projection
+	for (UINT v = 0; v < RenderView::NUM_VIEWS; ++v) {
+		m_views[v].orthographic = v == RenderView::DirectionalLight;
 	}
 
-	const UINT numDSVs = sc.shadowMap->m_cubemap ? 6U : 1U;
-
-	for (UINT i = 0U; i < numDSVs; ++i) {
-		m_lightPassConstantBufferData[m_frameIndex][shadowMap->m_id + i] = { sc.projMatrix * sc.transform[i]->GetViewMatrix() };
+	// The second row of a projection scales view space y to the [-1, 1] clip range that spans the target's height
+	const auto lodScale = [](const Matrix4& proj, float targetHeight) {
+		return static_cast<float>(proj.GetY().GetY()) * 0.5f * targetHeight;
+	};
+	m_views[RenderView::Camera].lodScale = lodScale(m_camera->GetProjMatrix(), m_viewport.height);
+	m_views[RenderView::DirectionalLight].lodScale = ShadowLodScale *
+		lodScale(m_directionalLight.projMatrix, static_cast<float>(m_directionalLight.shadowMap->GetHeight()));
+	for (UINT i = 0; i < 6; ++i) {
+		m_views[RenderView::PointLightFace0 + i].lodScale = ShadowLodScale *
+			lodScale(m_pointLight.projMatrix, static_cast<float>(m_pointLight.shadowMap->GetHeight()));
+	}
+}
 
-		const auto lightPassOffset =
-			m_lightPassConstantBufferData[m_frameIndex]->GetAlignedOffset(shadowMap->m_id + i);
+std::unique_ptr<RenderBackend> D3DClass::SetRenderBackend(std::unique_ptr<RenderBackend> backend) {
+	assert(backend);
+	std::swap(m_backend, backend);
+	return backend;
+}
 
-		const D3D12_GPU_VIRTUAL_ADDRESS mainPassBaseOffset =
-			m_mainPassConstantBufferResource[m_frameIndex]->GetGPUVirtualAddress() +
-			m_mainPassConstantBufferData[m_frameIndex]->GetAlignedOffset(1);
+FrameTargets D3DClass::GetFrameTargets() const {
+	FrameTargets targets{};
+	targets.allocator = ToHandle(m_commandAllocators[m_frameIndex].Get());
+	targets.rootSignature = ToHandle(m_rootSignature.Get());
+	targets.pipelines[DrawPipeline::Default] = { ToHandle(m_defaultPipelineState.Get()), ToHandle(m_defaultInstancedPipelineState.Get()) };
+	targets.pipelines[DrawPipeline::ReceiveNoShadow] = { ToHandle(m_ReceiveNoShadowPipelineState.Get()), ToHandle(m_ReceiveNoShadowInstancedPipelineState.Get()) };
+	targets.pipelines[DrawPipeline::ShadowMap] = { ToHandle(m_shadowMapPipelineState.Get()), ToHandle(m_shadowMapInstancedPipelineState.Get()) };
+
+	const auto& srvHeapDynamic = m_srvHeapDynamic[m_frameIndex];
+	targets.descriptorHeap = ToHandle(srvHeapDynamic.Get());
+	targets.globalDescriptors = ToHandle(m_srvHeapGlobal->GetCPUDescriptorHandleForHeapStart());
+	targets.frameDescriptors = ToHandle(srvHeapDynamic->GetCPUDescriptorHandleForHeapStart());
+	targets.frameDescriptorsGpu = ToHandle(srvHeapDynamic->GetGPUDescriptorHandleForHeapStart());
+	targets.descriptorSize = m_cbvSrvUavDescriptorSize;
+
+	targets.backBuffer = ToHandle(m_renderTargets[m_frameIndex].Get());
+	targets.rtv = ToHandle(CD3DX12_CPU_DESCRIPTOR_HANDLE(
+		m_rtvHeap->GetCPUDescriptorHandleForHeapStart(),
+		m_frameIndex,
+		m_rtvDescriptorSize
+	));
+	targets.dsv = ToHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
+	targets.viewport = m_viewport;
+	targets.scissorRect = m_scissorRect;
+
+	const auto shadowPass = [](const ShadowCaster& sc) {
+		ShadowPassTargets pass{};
+		pass.shadowMap = ToHandle(sc.shadowMap->Resource().Get());
+		pass.viewCount = sc.shadowMap->m_cubemap ? 6U : 1U;
+		for (UINT i = 0; i < pass.viewCount; ++i) {
+			pass.dsvs[i] = ToHandle(sc.shadowMap->GetDSV(i));
+		}
+		pass.textureId = sc.shadowMap->GetTextureID();
+		pass.viewport = sc.shadowMap->m_viewport;
+		pass.scissorRect = sc.shadowMap->m_scissorRect;
+		return pass;
+	};
+	targets.directionalShadow = shadowPass(m_directionalLight);
+	targets.pointShadow = shadowPass(m_pointLight);
+
+	return targets;
+}
 
-		m_commandList->SetGraphicsRootConstantBufferView(
-			RootParameterIndices::Light,
-			mainPassBaseOffset + lightPassOffset);
+void D3DClass::PrintMemoryReport(const wchar_t* label) const {
+	DXGI_QUERY_VIDEO_MEMORY_INFO localInfo{}, nonLocalInfo{};
+	ThrowIfFailed(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &localInfo));
+	ThrowIfFailed(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &nonLocalInfo));
 
-		const auto dsvCPUDescriptorHandle = shadowMap->GetDSV(i);
+	constexpr double BytesPerMB = 1024.0 * 1024.0;
 
-		m_commandList->ClearDepthStencilView(dsvCPUDescriptorHandle,
-			D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL,
-			1.0f, 0UI8, 0U, nullptr);
+	std::wstringstream t_SStream;
+	t_SStream << label << ": "
+		<< (localInfo.CurrentUsage / BytesPerMB) << "MB local, "
+		<< (nonLocalInfo.CurrentUsage / BytesPerMB) << "MB non-local, "
+		<< (m_releaseQueue.GetPendingBytes() / BytesPerMB) << "MB staging in "
+		<< m_releaseQueue.GetPendingCount() << " resources" << std::endl;
+	OutputDebugString(t_SStream.str().c_str());
+}
 
-		m_commandList->OMSetRenderTargets(0U, NULL, FALSE, &dsvCPUDescriptorHandle);
-		//m_commandList->SetPipelineState(m_shadowMapPipelineState.Get());
+void D3DClass::ResizeSceneData() {
+	// The frame builder sizes its own data when it records the next frame
+	ResolveRenderFlags();
 
-		RenderAllModels();
-	}
+	// Replaced constant buffers can still be read by the frames in flight
+	m_frameMemory->Reserve(ModelClass::TOTALMODELCOUNT, MaterialClass::TOTALMATERIALCOUNT, m_fenceValues[m_frameIndex]);
 
+	// Every material needs its own range in the shader visible heaps
 	{
-		const auto transitionBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-			shadowMap->Resource().Get(),
-			D3D12_RESOURCE_STATE_DEPTH_WRITE,
-			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
-		);
+		const UINT requiredDescriptors = MaterialClass::TOTALMATERIALCOUNT * MaterialClass::NUM_SRVS_PER_MATERIAL;
+		D3D12_DESCRIPTOR_HEAP_DESC srvHeapDescDynamic = m_srvHeapDynamic[0]->GetDesc();
 
-		m_commandList->ResourceBarrier(1, &transitionBarrier);
-	}
-}
-
-void D3DClass::RenderAllModels(const std::vector<UINT>* shadowMapTextureIDs) {
-	const bool renderToShadowMap = !static_cast<bool>(shadowMapTextureIDs);
+		if (requiredDescriptors > srvHeapDescDynamic.NumDescriptors) {
+			srvHeapDescDynamic.NumDescriptors = requiredDescriptors;
 
-	for (auto& model : m_models) {
-		bool skip = false;
-		for (const auto& name : g_bannedModelNames) {
-			if (model.m_name == name) {
-				skip = true;
-				break;
-			};
-
-			if (renderToShadowMap && !model.m_castShadows) {
-				skip = true;
-				break;
+			// The heaps are bound by the frames in flight, only the load runs before the fence exists
+			if (m_fence) {
+				WaitForGpu();
 			}
-		}
 
-		if (skip) continue;
-
-		const auto pipeLineState = [&] {
-			if (renderToShadowMap)
-				return m_shadowMapPipelineState.Get();
-			else {
-				return model.m_receiveShadows ? m_defaultPipelineState.Get() : m_ReceiveNoShadowPipelineState.Get();
+			for (UINT n = 0; n < FrameCount; n++) {
+				ThrowIfFailed(m_device->CreateDescriptorHeap(&srvHeapDescDynamic, IID_PPV_ARGS(&m_srvHeapDynamic[n])));
 			}
-		};
+		}
+	}
+}
 
-		m_commandList->SetPipelineState(pipeLineState());
+void D3DClass::UpdateLights() {
+	PROFILE_SCOPE("D3DClass::UpdateLights");
 
-		model.DrawModel(m_commandList,
-			m_modelConstantBufferResource[m_frameIndex],
-			m_materialConstantBufferResource[m_frameIndex],
-			m_srvHeapGlobal,
-			m_srvHeapDynamic[m_frameIndex],
-			shadowMapTextureIDs);
+	if (GetAsyncKeyState(VK_F2)) {
+		m_directionalLight.transform[0]->SetDirection(Matrix3::MakeYRotation(0.001f) * m_directionalLight.transform[0]->GetForward(), Vector3(kYUnitVector));
+		m_directionalLight.transform[0]->SetPosition(-1.0f * 1.25f * m_directionalLight.transform[0]->GetForward());
+	}
+	if (GetAsyncKeyState(VK_F3)) {
+		m_directionalLight.transform[0]->SetDirection(Matrix3::MakeYRotation(0.02f) * m_directionalLight.transform[0]->GetForward(), Vector3(kYUnitVector));
+		m_directionalLight.transform[0]->SetPosition(-1.0f * 1.25f * m_directionalLight.transform[0]->GetForward());
 	}
+
+	m_directionalLight.transform[0]->Update();
 }
 
 void D3DClass::WaitForGpu() {
@@ -476,7 +454,8 @@ void D3DClass::MoveToNextFrame() {
 }
 
 void D3DClass::UpdateMainPass() {
-	
+	PROFILE_SCOPE("D3DClass::UpdateMainPass");
+
 	// General information
 	m_mainPassConstantBuffer.vpMat = m_camera->GetViewProjMatrix();
 	m_mainPassConstantBuffer.eyePosition = m_camera->GetPosition();
@@ -517,9 +496,6 @@ void D3DClass::UpdateMainPass() {
 	m_mainPassConstantBuffer.lights[3].FalloffStart = 0.2f;
 	m_mainPassConstantBuffer.lights[3].FalloffEnd = 1.7f;
 	m_mainPassConstantBuffer.lights[3].SpotPower = 5.0f;
-
-	m_mainPassConstantBufferData[m_frameIndex][0] = m_mainPassConstantBuffer;
-
 }
 
 void D3DClass::LoadAssets() {
@@ -539,6 +515,7 @@ void D3DClass::LoadAssets() {
 		rootParameters[RootParameterIndices::Material].InitAsConstantBufferView(CBShaderRegister::Material); // Per material CB
 		rootParameters[RootParameterIndices::Light].InitAsConstantBufferView(CBShaderRegister::Light); // Per light CB
 		rootParameters[RootParameterIndices::MainPass].InitAsConstantBufferView(CBShaderRegister::MainPass); // Per pass CB
+		rootParameters[RootParameterIndices::Instances].InitAsShaderResourceView(0U, SRVShaderSpace::Instances, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX); // Per instance data
 
 		std::array<CD3DX12_STATIC_SAMPLER_DESC, 2> samplers{
 			CD3DX12_STATIC_SAMPLER_DESC(
@@ -593,12 +570,9 @@ void D3DClass::LoadAssets() {
 	}
 
 	{
-		D3D12_INPUT_ELEMENT_DESC inputElementDescs[] = {
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 16,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,	  0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-		};
+		// The layout of the arena's vertex format, the vertex shaders unpack it when PACKED_VERTICES is set
+		const auto inputLayout = VertexPacking::GetInputLayout(m_geometryArena.GetVertexFormat());
+		const char* packedVertices = m_geometryArena.GetVertexFormat() == VertexFormat::Full ? "0" : "1";
 
 //#if defined(_DEBUG)
 //		UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
@@ -608,9 +582,11 @@ void D3DClass::LoadAssets() {
 
 		ComPtr<ID3DBlob>
 			vertexShader,
+			vertexShaderInstanced,
 			pixelShader,
 			pixelShaderNoShadow,
 			shadowMapVertexShader,
+			shadowMapVertexShaderInstanced,
 			shadowMapPixelShader,
 			shaderError;
 
@@ -618,9 +594,29 @@ void D3DClass::LoadAssets() {
 			"RECEIVE_SHADOWS", "0", 
 			NULL, NULL}; // Trailing NULL NULL as a 'closing' of the struct
 
+		const D3D_SHADER_MACRO Macro_Vertex[2]{
+			"PACKED_VERTICES", packedVertices,
+			NULL, NULL};
+
+		const D3D_SHADER_MACRO Macro_Instanced[3]{
+			"INSTANCED", "1",
+			"PACKED_VERTICES", packedVertices,
+			NULL, NULL};
+
 		if (FAILED(D3DCompileFromFile(
 			L"Shaders/PopotoVertexShader.hlsl",
-			nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "vs_5_0", compileFlags, 0U, &vertexShader, &shaderError))) {
+			Macro_Vertex, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "vs_5_0", compileFlags, 0U, &vertexShader, &shaderError))) {
+
+			if (shaderError.Get())
+			{
+				OutputDebugStringA((char*)shaderError.Get()->GetBufferPointer());
+				shaderError.Get()->Release();
+			}
+		}
+
+		if (FAILED(D3DCompileFromFile(
+			L"Shaders/PopotoVertexShader.hlsl",
+			Macro_Instanced, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "vs_5_0", compileFlags, 0U, &vertexShaderInstanced, &shaderError))) {
 
 			if (shaderError.Get())
 			{
@@ -653,7 +649,18 @@ void D3DClass::LoadAssets() {
 
 		if (FAILED(D3DCompileFromFile(
 			L"Shaders/ShadowMapVertexShader.hlsl",
-			nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "vs_5_0", compileFlags, 0U, &shadowMapVertexShader, &shaderError))) {
+			Macro_Vertex, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "vs_5_0", compileFlags, 0U, &shadowMapVertexShader, &shaderError))) {
+
+			if (shaderError.Get())
+			{
+				OutputDebugStringA((char*)shaderError.Get()->GetBufferPointer());
+				shaderError.Get()->Release();
+			}
+		}
+
+		if (FAILED(D3DCompileFromFile(
+			L"Shaders/ShadowMapVertexShader.hlsl",
+			Macro_Instanced, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "vs_5_0", compileFlags, 0U, &shadowMapVertexShaderInstanced, &shaderError))) {
 
 			if (shaderError.Get())
 			{
@@ -674,13 +681,15 @@ void D3DClass::LoadAssets() {
 		}
 
 		const CD3DX12_SHADER_BYTECODE VertexShader			{ vertexShader.Get()->GetBufferPointer(),			vertexShader.Get()->GetBufferSize() };
+		const CD3DX12_SHADER_BYTECODE VertexShaderInstanced	{ vertexShaderInstanced.Get()->GetBufferPointer(),	vertexShaderInstanced.Get()->GetBufferSize() };
 		const CD3DX12_SHADER_BYTECODE PixelShader			{ pixelShader.Get()->GetBufferPointer(),			pixelShader.Get()->GetBufferSize() };
 		const CD3DX12_SHADER_BYTECODE PixelShaderNoShadow	{ pixelShaderNoShadow.Get()->GetBufferPointer(),	pixelShaderNoShadow.Get()->GetBufferSize() };
 		const CD3DX12_SHADER_BYTECODE ShadowMapVertexShader	{ shadowMapVertexShader.Get()->GetBufferPointer(),	shadowMapVertexShader.Get()->GetBufferSize() };
+		const CD3DX12_SHADER_BYTECODE ShadowMapVertexShaderInstanced{ shadowMapVertexShaderInstanced.Get()->GetBufferPointer(), shadowMapVertexShaderInstanced.Get()->GetBufferSize() };
 		const CD3DX12_SHADER_BYTECODE ShadowMapPixelShader	{ shadowMapPixelShader.Get()->GetBufferPointer(),	shadowMapPixelShader.Get()->GetBufferSize() };
 
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc{};
-		psoDesc.InputLayout = { inputElementDescs, std::extent_v<decltype(inputElementDescs)> };
+		psoDesc.InputLayout = inputLayout;
 		psoDesc.pRootSignature = m_rootSignature.Get();
 		psoDesc.VS = VertexShader;
 		psoDesc.PS = PixelShader;
@@ -714,6 +723,19 @@ void D3DClass::LoadAssets() {
 		shadowMapPsoDesc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
 		shadowMapPsoDesc.NumRenderTargets = 0;
 		ThrowIfFailed(m_device->CreateGraphicsPipelineState(&shadowMapPsoDesc, IID_PPV_ARGS(&m_shadowMapPipelineState)));
+
+		// Instanced variants only swap the vertex shader
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC instancedPsoDesc{ psoDesc };
+		instancedPsoDesc.VS = VertexShaderInstanced;
+		ThrowIfFailed(m_device->CreateGraphicsPipelineState(&instancedPsoDesc, IID_PPV_ARGS(&m_defaultInstancedPipelineState)));
+
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC noShadowInstancedPsoDesc{ noShadowPsoDesc };
+		noShadowInstancedPsoDesc.VS = VertexShaderInstanced;
+		ThrowIfFailed(m_device->CreateGraphicsPipelineState(&noShadowInstancedPsoDesc, IID_PPV_ARGS(&m_ReceiveNoShadowInstancedPipelineState)));
+
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC shadowMapInstancedPsoDesc{ shadowMapPsoDesc };
+		shadowMapInstancedPsoDesc.VS = ShadowMapVertexShaderInstanced;
+		ThrowIfFailed(m_device->CreateGraphicsPipelineState(&shadowMapInstancedPsoDesc, IID_PPV_ARGS(&m_shadowMapInstancedPipelineState)));
 	}
 
 	ThrowIfFailed(
@@ -727,16 +749,16 @@ void D3DClass::LoadAssets() {
 	);
 
 	m_commandList->SetName(L"DefaultCommandlist");
+	m_backend = std::make_unique<D3D12RenderBackend>(m_device, m_commandList);
 	
 	const auto defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-	const auto uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
 
 	// Create Depth/Stencil
 	{
 		auto viewport2DTex = CD3DX12_RESOURCE_DESC::Tex2D(
 			DXGI_FORMAT_D32_FLOAT,
-			static_cast<UINT64>(m_viewport.Width),
-			static_cast<UINT64>(m_viewport.Height),
+			static_cast<UINT64>(m_viewport.width),
+			static_cast<UINT64>(m_viewport.height),
 			1UI16,
 			1UI16,
 			1U,
@@ -802,6 +824,7 @@ void D3DClass::LoadAssets() {
 		m_directionalLight.transform[0]->Update();
 
 		m_directionalLight.projMatrix = Matrix4{ XMMatrixOrthographicRH(sizeDirLight, sizeDirLight, nearDirLight, farDirLight) };
+		m_directionalLight.projFrustum = Frustum(m_directionalLight.projMatrix);
 	}
 
 	// Create ShadowMap for pointlight
@@ -844,90 +867,59 @@ void D3DClass::LoadAssets() {
 		}
 
 		m_pointLight.projMatrix = { m_pointLight.transform[0]->GetProjMatrix() };
+		m_pointLight.projFrustum = Frustum(m_pointLight.projMatrix);
 	}
 
+	// Create the CBVs, they are sized by ResizeSceneData and filled in by the frame builder during the first frames
+	m_frameMemory = std::make_unique<D3D12FrameMemory>(m_device, 64U * 1024U);
+
+	m_threadPool = std::make_unique<ThreadPoolClass>();
+	m_meshCache = std::make_unique<ProceduralMeshCacheClass>(m_threadPool.get());
+	m_streamer = std::make_unique<AssetStreamerClass>(m_device, std::make_unique<D3D12CopyQueue>(m_device));
+	UploadBatchClass uploadBatch{ m_device };
+
 	{
-		LoadScene("assets/sphere.obj");
-		m_models[0].m_Transform.SetTranslation(m_pointLight.transform[0]->GetPosition());
-		m_models[0].m_UniformScale = 0.01f;
+		LoadScene("assets/sphere.obj", uploadBatch);
+		m_models[0].SetTranslation(m_pointLight.transform[0]->GetPosition());
+		m_models[0].SetUniformScale(0.01f);
 		m_models[0].m_castShadows = false;
 		m_models[0].m_receiveShadows = false;
 	}
+
+	// Fields of equal props on the floor, drawn instanced in every view. Both box fields share one mesh.
+	{
+		const auto box = ProceduralMeshKey::Box(0.02f, 0.04f, 0.02f, 1);
+		const auto sphere = ProceduralMeshKey::Sphere(0.015f, 2);
+
+		CreatePropField(box, m_models[0].m_material, 8, 16, { -0.3f, -0.3f, 0.0f }, 0.05f);
+		CreatePropField(sphere, m_models[0].m_material, 8, 8, { 0.0f, -0.3f, 0.0f }, 0.05f);
+		CreatePropField(box, m_models[0].m_material, 8, 16, { 0.3f, -0.3f, 0.0f }, 0.05f);
+
+		std::wstringstream t_SStream;
+		t_SStream << "Prop meshes: " << m_meshCache->GetMissCount() << " generated, "
+			<< m_proceduralMeshes.size() << " uploaded for 3 fields" << std::endl;
+		OutputDebugString(t_SStream.str().c_str());
+	}
 	//std::string assetPath("assets\\churchscene\\churchscene.obj");
 	//std::string assetPath("assets/sponza.obj");
 	//std::string assetPath("assets/rungholt/house.obj");
 	//std::string assetPath("assets/chicken.obj");
-	LoadScene("assets/sponza.obj");
-	//LoadScene("assets/elemental/Elemental.obj");
-	//LoadScene("assets/mchouse/house.obj");
+	//LoadScene("assets/elemental/Elemental.obj", uploadBatch);
+	//LoadScene("assets/mchouse/house.obj", uploadBatch);
+
+	// The geometry loaded so far is copied on the direct queue together with the rest of the load
+	m_geometryArena.Publish(m_geometryArena.Upload(m_device, uploadBatch), m_releaseQueue);
+	ResizeSceneData();
 
-	// Initialize the matrices and create the CBVs
+	// Record every staged copy of the load, the chunks retire with the submission below
 	{
-		const auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
-		const auto bufferRange = CD3DX12_RANGE{ 0,0 };
+		uploadBatch.Flush(m_commandList.Get(), m_releaseQueue);
 
-		for (UINT n = 0; n < FrameCount; n++) {
-			{ // Model CBs
-				ThrowIfFailed(
-					m_device->CreateCommittedResource(
-						&uploadHeapProperties,
-						D3D12_HEAP_FLAG_NONE,
-						&bufferDesc,
-						D3D12_RESOURCE_STATE_GENERIC_READ,
-						nullptr,
-						IID_PPV_ARGS(&m_modelConstantBufferResource[n])
-					)
-				);
-				NAME_D3D12_RES_INDEXED(m_modelConstantBufferResource, n);
-
-				ThrowIfFailed(m_modelConstantBufferResource[n]->Map(0, &bufferRange, reinterpret_cast<void**>(&m_modelConstantBufferData[n])));
-				
-				for (auto& model : m_models) {
-					if (m_modelConstantBufferData[n]->GetAlignedOffset(model.m_id) >= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) {
-						throw std::exception("Too many models to fit in constant buffer");
-					}
-					
-					m_modelConstantBufferData[n][model.m_id] = model.m_modelConstantBuffer;
-				}
-			}
-			{// Main Pass/Light Pass CBs
-				ThrowIfFailed(
-					m_device->CreateCommittedResource(
-						&uploadHeapProperties,
-						D3D12_HEAP_FLAG_NONE,
-						&bufferDesc,
-						D3D12_RESOURCE_STATE_GENERIC_READ,
-						nullptr,
-						IID_PPV_ARGS(&m_mainPassConstantBufferResource[n])
-					)
-				);
-				NAME_D3D12_RES_INDEXED(m_mainPassConstantBufferResource, n);
-
-				ThrowIfFailed(m_mainPassConstantBufferResource[n]->Map(0, &bufferRange, reinterpret_cast<void**>(&m_mainPassConstantBufferData[n])));
-
-				m_mainPassConstantBufferData[n][0] = m_mainPassConstantBuffer;
-				m_lightPassConstantBufferData[n] = reinterpret_cast<Utility::PaddedBlock<LightPassConstantBuffer>*>(&m_mainPassConstantBufferData[n][1]);
-			}
-			{// Material CBs
-				ThrowIfFailed(
-					m_device->CreateCommittedResource(
-						&uploadHeapProperties,
-						D3D12_HEAP_FLAG_NONE,
-						&bufferDesc,
-						D3D12_RESOURCE_STATE_GENERIC_READ,
-						nullptr,
-						IID_PPV_ARGS(&m_materialConstantBufferResource[n])
-					)
-				);
-				NAME_D3D12_RES_INDEXED(m_materialConstantBufferResource, n);
-
-				ThrowIfFailed(m_materialConstantBufferResource[n]->Map(0, &bufferRange, reinterpret_cast<void**>(&m_materialConstantBufferData[n])));
-
-				for (auto& model : m_models) {
-					m_materialConstantBufferData[n][model.m_material.m_id] = model.m_material.m_materialConstantBuffer;
-				}
-			}
-		}
+		std::wstringstream t_SStream;
+		t_SStream << "Upload batch: " << uploadBatch.GetCopyCount() << " copies, "
+			<< (uploadBatch.GetStagedBytes() / (1024 * 1024)) << "MB staged in "
+			<< uploadBatch.GetChunkCount() << " chunks" << std::endl;
+		OutputDebugString(t_SStream.str().c_str());
 	}
 
 	// Close command list
@@ -952,139 +944,175 @@ void D3DClass::LoadAssets() {
 			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
 		}
 
+		// The staging buffers of the load retire with this submission
+		m_releaseQueue.Submit(m_fenceValues[m_frameIndex]);
+
 		// Wait for the command list to execute.
 		WaitForGpu();
 	}
+
+	PrintMemoryReport(L"After load");
+	m_releaseQueue.Release(m_fence->GetCompletedValue());
+	PrintMemoryReport(L"After releasing staging buffers");
+
+	// The main scene streams in on the copy queue and shows up once it is resident. It grows the arena
+	// pools by copying the ones written above, so it is only submitted once those copies have completed.
+	StreamScene("assets/sponza.obj");
 }
 
+void D3DClass::StreamScene(std::string assetPath, bool invertTexY) {
+	PROFILE_SCOPE("D3DClass::StreamScene");
 
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
+	auto& uploadBatch = m_streamer->GetBatch();
 
-void D3DClass::LoadScene(std::string assetPath, bool invertTexY) {
-	// Obtain directory of the file
-	const auto found = assetPath.find_last_of("/\\");
-	const auto workingDirectory = assetPath.substr(0, found).append("\\");
+	const size_t firstModel = m_models.size();
+	LoadScene(assetPath, uploadBatch, invertTexY);
+	const size_t lastModel = m_models.size();
+
+	for (size_t i = firstModel; i < lastModel; ++i) {
+		m_models[i].m_streaming = true;
+	}
 
-	using namespace Assimp;
-	Importer assetLoader;
-	assetLoader.SetPropertyBool(AI_CONFIG_PP_PTV_NORMALIZE, true);
-	UINT assimpImportFlags = aiProcess_Triangulate | aiProcess_PreTransformVertices | aiProcess_CalcTangentSpace;
-	assert(assetLoader.ValidateFlags(assimpImportFlags)); // Throw this shit if the flags don't work
+	const UINT64 uploadId = m_geometryArena.Upload(m_device, uploadBatch);
+	ResizeSceneData();
 
-	const aiScene* pScene = assetLoader.ReadFile(assetPath, assimpImportFlags);
-	if (pScene == nullptr) {
-		OutputDebugString(L"UNABLE TO LOAD ASSET\n");
+	{
+		std::wstringstream t_SStream;
+		t_SStream << "Streaming " << (lastModel - firstModel) << " models, "
+			<< (uploadBatch.GetStagedBytes() / (1024 * 1024)) << "MB staged, geometry arena: "
+			<< m_geometryArena.GetVertexCount() << " vertices, "
+			<< m_geometryArena.GetIndexCount() << " indices ("
+			<< (m_geometryArena.GetIndexBytes() / 1024) << "KB)" << std::endl;
+		OutputDebugString(t_SStream.str().c_str());
 	}
-	assetPath.append(" has been loaded. \n");
-	OutputDebugString(std::wstring(assetPath.begin(), assetPath.end()).c_str());
 
-	const auto& aMeshes = pScene->mMeshes;
-	const auto nMeshes = pScene->mNumMeshes;
-	
-	const auto modelOffset = m_models.size();
-	m_models.resize(modelOffset + static_cast<size_t>(nMeshes));
+	// Runs at the start of the first frame recorded after the copies completed
+	m_streamer->Submit([this, firstModel, lastModel, uploadId] {
+		m_geometryArena.Publish(uploadId, m_releaseQueue);
 
-	for (UINT i = 0; i < nMeshes; ++i) {
+		for (size_t i = firstModel; i < lastModel; ++i) {
+			m_models[i].m_streaming = false;
+		}
+		ResolveRenderFlags();
+	});
+}
 
-		auto& model = m_models[modelOffset + i];
-		const auto& mesh = *aMeshes[i];
+void D3DClass::RemoveModels(size_t first) {
+	if (first >= m_models.size()) return;
+
+	// Frames in flight may still draw them
+	WaitForGpu();
+
+	// Models cannot be assigned, their ids are const, so only the tail is removed
+	m_models.resize(first);
+	ResolveRenderFlags();
+}
 
-		model.m_name = { mesh.mName.C_Str() };
 
-		model.m_mesh.m_indices.reserve(static_cast<size_t>(mesh.mNumFaces * 3));
-		model.m_mesh.m_vertices.reserve(static_cast<size_t>(mesh.mNumVertices));
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
 
-		for (UINT j = 0; j < mesh.mNumFaces; ++j) {
-			const auto& face = mesh.mFaces[j];
-			assert(!(face.mNumIndices % 3));
+void D3DClass::LoadScene(std::string assetPath, UploadBatchClass& uploadBatch, bool invertTexY) {
+	PROFILE_SCOPE("D3DClass::LoadScene");
 
-			model.m_mesh.m_indices.emplace_back(face.mIndices[1]);
-			model.m_mesh.m_indices.emplace_back(face.mIndices[0]);
-			model.m_mesh.m_indices.emplace_back(face.mIndices[2]);
+	// Mesh names listed in <scene>.exclude next to the scene file are loaded but never drawn
+	std::unordered_set<std::string> excludedNames;
+	{
+		const auto extension = assetPath.find_last_of('.');
+		std::ifstream excludeFile(assetPath.substr(0, extension).append(".exclude"));
+
+		std::string line;
+		while (std::getline(excludeFile, line)) {
+			line.erase(line.find_last_not_of(" \t\r") + 1);
+			if (line.empty() || line[0] == '#') continue;
+			excludedNames.insert(line);
 		}
+	}
+
+	// Textures already in the scene are shared instead of loaded again
+	std::unordered_map<std::wstring, std::shared_ptr<MaterialClass::Texture>> textures;
+	std::unordered_set<std::wstring> loadedTextures;
+	for (const auto& model : m_models) {
+		if (!model.m_material) continue;
 
-		for (UINT j = 0; j < mesh.mNumVertices; ++j) {
-			if (!mesh.HasTangentsAndBitangents()) { 
-				OutputDebugString(L"No Tangents and Bitangents found, skipping mesh.\n"); 
-				continue;
+		for (const auto& texture : model.m_material->m_textures) {
+			if (texture && textures.emplace(texture->m_fileName, texture).second) {
+				loadedTextures.insert(texture->m_fileName);
 			}
-			const auto& vertex = mesh.mVertices[j];
-			const auto& tangent = mesh.mTangents[j];
-			const auto& normal = mesh.mNormals[j];
-			const auto& texcoord = mesh.mTextureCoords[0][j];
-
-			model.m_mesh.m_vertices.emplace_back(
-				Vertex{
-				{ vertex.x, vertex.y, vertex.z },
-				{ normal.x, normal.y, normal.z },
-				{ tangent.x, tangent.y, tangent.z },
-				{ texcoord.x, invertTexY ? (1.0f - texcoord.y) : texcoord.y } });
 		}
+	}
 
-		model.ConstructBuffers(m_device, m_commandList);
-		//model.m_UniformScale = 0.0005f;
+	auto scene = SceneImporter::Import(m_device, *m_threadPool, assetPath, invertTexY, loadedTextures);
 
-		const auto& assimpMaterial = pScene->mMaterials[mesh.mMaterialIndex];
+	// Everything below creates or stages GPU resources and stays on this thread
+	for (auto& decoded : scene.textures) {
+		auto texture = std::make_shared<MaterialClass::Texture>();
+		texture->Upload(m_device, m_srvHeapGlobal, uploadBatch, decoded);
+		textures.emplace(texture->m_fileName, std::move(texture));
+	}
 
-		const aiTextureType usedTextureTypes[]{
-			aiTextureType_DIFFUSE,
-			aiTextureType_HEIGHT,
-			aiTextureType_SPECULAR
-		};
+	const auto modelOffset = m_models.size();
+	m_models.resize(modelOffset + scene.meshes.size());
 
-		static_assert(std::extent_v<decltype(usedTextureTypes)> == MaterialClass::NUM_TEXTURES_PER_MATERIAL,
-			"The amount of to load texture types does not equal the amount of textures per material.");
+	// Meshes using the same assimp material share a MaterialClass, so they can be batched
+	std::vector<std::shared_ptr<MaterialClass>> sceneMaterials(scene.materials.size());
 
-		for(auto j = 0; j < MaterialClass::NUM_TEXTURES_PER_MATERIAL; ++j){
+	for (size_t i = 0; i < scene.meshes.size(); ++i) {
+		auto& model = m_models[modelOffset + i];
+		auto& mesh = scene.meshes[i];
 
-			std::wstring wTexPath = L"assets\\default_normal.dds";
+		model.m_name = std::move(mesh.name);
+		model.m_excluded = excludedNames.count(model.m_name) != 0;
 
-			if (assimpMaterial->GetTextureCount(usedTextureTypes[j])) {
-				aiString aiTexturePath;
-				assimpMaterial->GetTexture(usedTextureTypes[j], 0, &aiTexturePath);
+		model.m_mesh = std::make_shared<MeshClass>(std::move(mesh.data));
+		model.m_mesh->ConstructBuffers(m_geometryArena, mesh.boundsMin, mesh.boundsMax);
 
-				std::string texPath(aiTexturePath.C_Str());
-				texPath.insert(0, workingDirectory);
-				wTexPath = { texPath.begin(), texPath.end() };
-			}
-			else {
-				switch (usedTextureTypes[j]) {
-				case aiTextureType_DIFFUSE: {
-					wTexPath = L"assets\\default_diffuse.dds";
-					break;
-				}
-				case aiTextureType_HEIGHT: {
-					wTexPath = L"assets\\default_normal.dds";
-					break;
-				}
-				case aiTextureType_SPECULAR: {
-					wTexPath = L"assets\\default_specular.dds";
-					break;
-				}
-				default: {
-					OutputDebugString(L"No Texture found, loading default.\n");
-					break;
-				}}
+		auto& sceneMaterial = sceneMaterials[mesh.material];
+		if (!sceneMaterial) {
+			sceneMaterial = std::make_shared<MaterialClass>();
+
+			const auto& texturePaths = scene.materials[mesh.material].texturePaths;
+			for (auto j = 0; j < MaterialClass::NUM_TEXTURES_PER_MATERIAL; ++j) {
+				sceneMaterial->m_textures[j] = textures.at(texturePaths[j]);
 			}
+		}
 
-			bool skipBecauseItAlreadyExists = false;
+		model.m_material = sceneMaterial;
+	}
+}
 
-			for (auto& otherModel : m_models) {
-				if (otherModel.m_id >= model.m_id) break;
+void D3DClass::CreatePropField(
+	const ProceduralMeshKey& meshKey,
+	const std::shared_ptr<MaterialClass>& material,
+	UINT countX, UINT countZ,
+	const Vector3& origin,
+	float spacing) {
+
+	PROFILE_SCOPE("D3DClass::CreatePropField");
+
+	// Uploaded once, every prop of every field with the same key references the same buffers.
+	// The cache only generates the shape again after all its props were removed.
+	auto& cachedMesh = m_proceduralMeshes[meshKey];
+	auto sharedMesh = cachedMesh.lock();
+	if (!sharedMesh) {
+		sharedMesh = std::make_shared<MeshClass>(m_meshCache->GetMesh(meshKey));
+		sharedMesh->ConstructBuffers(m_geometryArena);
+		cachedMesh = sharedMesh;
+	}
 
-				if (otherModel.m_material.m_textures[j]->m_fileName == wTexPath) {
-					model.m_material.m_textures[j] = otherModel.m_material.m_textures[j];
-					skipBecauseItAlreadyExists = true;
-					break;
-				}
-			}
+	const Vector3 corner = origin - Vector3((countX - 1) * spacing, 0.0f, (countZ - 1) * spacing) * 0.5f;
 
-			if (!skipBecauseItAlreadyExists) {
-				model.m_material.m_textures[j] = std::make_shared<MaterialClass::Texture>();
-				model.m_material.m_textures[j]->Load(m_commandList, m_device, m_srvHeapGlobal, wTexPath.data());
-			}
+	const auto modelOffset = m_models.size();
+	m_models.resize(modelOffset + static_cast<size_t>(countX) * countZ);
+
+	for (UINT z = 0; z < countZ; ++z) {
+		for (UINT x = 0; x < countX; ++x) {
+			auto& model = m_models[modelOffset + static_cast<size_t>(z) * countX + x];
+			model.m_name = "Prop";
+			model.m_mesh = sharedMesh;
+			model.m_material = material;
+			model.SetTranslation(corner + Vector3(x * spacing, 0.0f, z * spacing));
 		}
 	}
-}
\ No newline at end of file
+}
@@ -3,45 +3,18 @@
 #include "CameraClass.h"
 #include "ModelClass.h"
 #include "ShadowMapClass.h"
-
-struct Light
-{
-	DirectX::XMFLOAT3 Strength = { 0.5f, 0.5f, 0.5f };
-	float FalloffStart = 1.0f;                          // point/spot light only
-	DirectX::XMFLOAT3 Direction = { 0.0f, -1.0f, 0.0f };// directional/spot light only
-	float FalloffEnd = 10.0f;                           // point/spot light only
-	DirectX::XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };  // point/spot light only
-	float SpotPower = 64.0f;                            // spot light only
-};
-
-#define MaxLights 16
-
-/*
-	Directional:
-		[0, 1]
-	Point:
-		[2]
-	Spot:
-		-
-*/
-
-struct MainPassConstantBuffer {
-	Math::Vector3 eyePosition{ 0.0f, 0.0f, 0.0f };
-	Math::Vector4 ambientLight{ 0.0f, 0.0f, 0.0f, 0.0f };
-	Math::Matrix4 vpMat{ Math::kIdentity };
-	Math::Matrix4 directionalLightVpMat{ Math::kIdentity };
-	std::array<Math::Matrix4, 6> pointLightVpMats{ Math::Matrix4{ Math::kIdentity } };
-	Light lights[MaxLights];
-};
-
-struct LightPassConstantBuffer {
-	Math::Matrix4 lightVpMat{ Math::kIdentity };
-};
+#include "D3D12RenderBackend.h"
+#include "FrameBuilderClass.h"
+#include "DeferredReleaseQueue.h"
+#include "AssetStreamerClass.h"
+#include "ThreadPoolClass.h"
+#include "ProceduralMeshCacheClass.h"
 
 struct ShadowCaster {
 	std::unique_ptr<CameraClass> transform[6];
 	std::unique_ptr<ShadowMapClass> shadowMap;
 	Math::Matrix4 projMatrix{ Math::kIdentity };
+	Math::Frustum projFrustum;	// View space frustum of projMatrix
 };
 
 class InputClass;
@@ -53,7 +26,53 @@ public:
 	~D3DClass();
 
 	void Render();
-	void UpdateModel(ModelClass& aModel);
+
+	// Packs the shadow and visibility flags of every model for the draw loops.
+	// Has to be called again after changing any of these flags on a model.
+	void ResolveRenderFlags() { m_frameBuilder.ResolveRenderFlags(m_models); }
+
+	// Records the CPU side of a frame into the active backend without submitting it
+	void RecordFrame();
+
+	// Moves the lights and fills in the views and pass constants of the next frame from the camera and lights
+	void UpdateViews();
+
+	// The scene as the frame builder draws it, valid until models are added or removed.
+	// Other builders can record it as well, see Benchmarks.
+	FrameScene GetFrameScene() { return { m_models, m_geometryArena, m_views, m_mainPassConstantBuffer }; }
+
+	// Swap the backend the frame is recorded into, returns the previous backend.
+	// Render() requires the D3D12 backend to be active.
+	std::unique_ptr<RenderBackend> SetRenderBackend(std::unique_ptr<RenderBackend> backend);
+	RenderBackend& GetRenderBackend() { return *m_backend; }
+
+	// Culling results of the last recorded frame
+	const FrameStats& GetFrameStats() const { return m_frameBuilder.GetFrameStats(); }
+	const std::array<Math::Frustum, RenderView::NUM_VIEWS>& GetViewFrusta() const { return m_frameBuilder.GetViewFrusta(); }
+	void PrintFrameStats() const { m_frameBuilder.PrintFrameStats(); }
+
+	// See FrameBuilderClass, all are on by default
+	void SetClusterCulling(bool enabled) { m_frameBuilder.SetClusterCulling(enabled); }
+	bool IsClusterCullingEnabled() const { return m_frameBuilder.IsClusterCullingEnabled(); }
+	void SetLodSelection(bool enabled) { m_frameBuilder.SetLodSelection(enabled); }
+	bool IsLodSelectionEnabled() const { return m_frameBuilder.IsLodSelectionEnabled(); }
+	void SetInstancing(bool enabled) { m_frameBuilder.SetInstancing(enabled); }
+	bool IsInstancingEnabled() const { return m_frameBuilder.IsInstancingEnabled(); }
+
+	// Video memory used by the process next to the staging bytes still waiting for release
+	void PrintMemoryReport(const wchar_t* label) const;
+
+	// Loads the scene on the CPU and uploads it on the copy queue. Its models are drawn from the
+	// first frame after the copies have completed.
+	void StreamScene(std::string assetPath, bool invertTexY = false);
+	AssetStreamerClass& GetStreamer() { return *m_streamer; }
+
+	// Removes the models from index first to the end once the GPU is idle. Their meshes, materials and
+	// textures are freed along with them unless other models share them. None of the removed models may
+	// still be streaming.
+	void RemoveModels(size_t first);
+
+	Microsoft::WRL::ComPtr<ID3D12Device> GetDevice() const { return m_device; }
 
 	// Delete functions
 	D3DClass(D3DClass const& rhs) = delete;
@@ -63,25 +82,42 @@ public:
 	D3DClass& operator=(D3DClass&& rhs) = delete;
 
 private:
-	void PopulateCommandList();
-	void RenderSceneToShadowMap(const ShadowCaster& sc);
+	// The D3D12 objects of the current frame as backend handles
+	FrameTargets GetFrameTargets() const;
+	void UpdateLights();
 	void WaitForGpu();
 	void MoveToNextFrame();
 	void LoadAssets();
-	void LoadScene(std::string assetPath, bool invertTexY = false);
 
+	// Appends the models of the scene, their textures and geometry are staged in uploadBatch.
+	// The geometry arena still has to be uploaded.
+	void LoadScene(std::string assetPath, UploadBatchClass& uploadBatch, bool invertTexY = false);
+
+	// Sizes the constant buffers and shader visible heaps after models or materials were added
+	void ResizeSceneData();
+
+	// Adds a countX by countZ grid of models sharing one procedural mesh and material, centered on origin.
+	// A new mesh is allocated in the geometry arena, which still has to be uploaded.
+	void CreatePropField(
+		const ProceduralMeshKey& meshKey,
+		const std::shared_ptr<MaterialClass>& material,
+		UINT countX, UINT countZ,
+		const Math::Vector3& origin,
+		float spacing);
 
-	void RenderAllModels(const std::vector<UINT>* shadowMapTextureIDs = nullptr);
 	void UpdateMainPass();
 
 public:
-	static const UINT FrameCount = 3;
+	static const UINT FrameCount = FrameMemory::FrameCount;
 	static const UINT TexturePixelSize = 4;	// The number of bytes used to represent a pixel in the texture.
+	static constexpr VertexFormat SceneVertexFormat = VertexFormat::Packed;	// Layout of the vertices in the geometry arena
+	static constexpr float ShadowLodScale = 0.5f;	// Shadow views count their pixels at half size, their errors are blurred by filtering
 	const float m_aspectRatio;
 	const float m_nearClip;
 	const float m_farClip;
 	const bool m_vsync_enabled;
 	std::unique_ptr<CameraClass> m_camera;
+	GeometryArenaClass m_geometryArena{ SceneVertexFormat };	// Declared before m_models, meshes return their ranges on destruction
 	std::vector<ModelClass> m_models;
 
 	ShadowCaster m_directionalLight;
@@ -89,8 +125,9 @@ public:
 
 private:
 	// Pipeline objects
-	CD3DX12_VIEWPORT m_viewport;
-	CD3DX12_RECT m_scissorRect;
+	Viewport m_viewport;
+	ScissorRect m_scissorRect;
+	Microsoft::WRL::ComPtr<IDXGIAdapter3> m_adapter;
 	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_commandQueue;
 	Microsoft::WRL::ComPtr<IDXGISwapChain3> m_swapChain;
@@ -98,6 +135,7 @@ private:
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_renderTargets[FrameCount];
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_commandAllocators[FrameCount];
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_commandList;
+	std::unique_ptr<RenderBackend> m_backend;
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_srvHeapGlobal;
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_srvHeapDynamic[FrameCount];
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_dsvBuffer;
@@ -105,8 +143,14 @@ private:
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_defaultPipelineState;
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_ReceiveNoShadowPipelineState;
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_shadowMapPipelineState;
+
+	// Same as above, but the world matrix comes from the instance buffer
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_defaultInstancedPipelineState;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_ReceiveNoShadowInstancedPipelineState;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_shadowMapInstancedPipelineState;
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
 	UINT m_rtvDescriptorSize = 0;
+	UINT m_cbvSrvUavDescriptorSize = 0;
 
 	// Synchronization objects
 	UINT m_frameIndex;
@@ -114,18 +158,28 @@ private:
 	HANDLE m_fenceEvent;
 	UINT64 m_fenceValues[FrameCount];
 	
-	// CBVs
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_modelConstantBufferResource[FrameCount];
-	Utility::PaddedBlock<ModelConstantBuffer>* m_modelConstantBufferData[FrameCount];
+	// Model and material slots and the pass constants pushed every frame, in upload heaps
+	std::unique_ptr<D3D12FrameMemory> m_frameMemory;
 
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_mainPassConstantBufferResource[FrameCount];
-	Utility::PaddedBlock<MainPassConstantBuffer>* m_mainPassConstantBufferData[FrameCount];
-	Utility::PaddedBlock<LightPassConstantBuffer>* m_lightPassConstantBufferData[FrameCount];
-	MainPassConstantBuffer m_mainPassConstantBuffer{};
+	// Staging resources of recorded uploads, released once the GPU has executed the copies
+	DeferredReleaseQueue m_releaseQueue;
+
+	// Uploads of streamed scenes, executed on the copy queue while frames keep rendering
+	std::unique_ptr<AssetStreamerClass> m_streamer;
 
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_materialConstantBufferResource[FrameCount];
-	Utility::PaddedBlock<MaterialClass::MaterialConstantBuffer>* m_materialConstantBufferData[FrameCount];
+	// Worker threads of the CPU side of scene loading
+	std::unique_ptr<ThreadPoolClass> m_threadPool;
+
+	// Generated prop shapes, and the meshes in the geometry arena made from them while props still use them
+	std::unique_ptr<ProceduralMeshCacheClass> m_meshCache;
+	std::unordered_map<ProceduralMeshKey, std::weak_ptr<MeshClass>, ProceduralMeshKeyHash> m_proceduralMeshes;
+
+	// Filled in by UpdateViews
+	MainPassConstantBuffer m_mainPassConstantBuffer{};
+	std::array<FrameView, RenderView::NUM_VIEWS> m_views{};
 
+	// Culls, sorts and records the frames
+	FrameBuilderClass m_frameBuilder;
 
 	// Debug Variables
 #if defined(_DEBUG)
@@ -0,0 +1,29 @@
+#include "stdafx.h"
+#include "DeferredReleaseQueue.h"
+
+void DeferredReleaseQueue::Enqueue(Microsoft::WRL::ComPtr<ID3D12Resource> resource) {
+	if (!resource) return;
+
+	const auto desc = resource->GetDesc();
+	const UINT64 size = desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? desc.Width : 0;
+
+	m_pendingBytes += size;
+	m_unsubmitted.push_back({ 0, size, std::move(resource) });
+}
+
+void DeferredReleaseQueue::Submit(UINT64 fenceValue) {
+	assert(m_submitted.empty() || m_submitted.back().fenceValue <= fenceValue);
+
+	for (auto& entry : m_unsubmitted) {
+		entry.fenceValue = fenceValue;
+		m_submitted.push_back(std::move(entry));
+	}
+	m_unsubmitted.clear();
+}
+
+void DeferredReleaseQueue::Release(UINT64 completedFenceValue) {
+	while (!m_submitted.empty() && m_submitted.front().fenceValue <= completedFenceValue) {
+		m_pendingBytes -= m_submitted.front().size;
+		m_submitted.pop_front();
+	}
+}
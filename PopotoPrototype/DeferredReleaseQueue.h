@@ -0,0 +1,43 @@
+#pragma once
+
+#include <deque>
+
+// Keeps resources alive until the GPU has passed the fence value of the submission that uses them.
+// Staging buffers are enqueued while their copies are being recorded, before that fence value is
+// known, and get stamped by the next Submit.
+class DeferredReleaseQueue
+{
+public:
+	DeferredReleaseQueue() = default;
+
+	// Released after the next submission completes
+	void Enqueue(Microsoft::WRL::ComPtr<ID3D12Resource> resource);
+
+	// Stamps everything enqueued since the last call with the fence value signaled after the submission
+	void Submit(UINT64 fenceValue);
+
+	// Drops every resource whose submission the GPU has finished
+	void Release(UINT64 completedFenceValue);
+
+	// Bytes held by the queue, only buffer sizes are counted
+	UINT64 GetPendingBytes() const { return m_pendingBytes; }
+	size_t GetPendingCount() const { return m_unsubmitted.size() + m_submitted.size(); }
+
+	// Delete functions
+	DeferredReleaseQueue(DeferredReleaseQueue const& rhs) = delete;
+	DeferredReleaseQueue& operator=(DeferredReleaseQueue const& rhs) = delete;
+
+	DeferredReleaseQueue(DeferredReleaseQueue&& rhs) = delete;
+	DeferredReleaseQueue& operator=(DeferredReleaseQueue&& rhs) = delete;
+
+private:
+	struct Entry {
+		UINT64 fenceValue;
+		UINT64 size;
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	};
+
+	std::vector<Entry> m_unsubmitted;
+	std::deque<Entry> m_submitted;	// Ascending fence values
+	UINT64 m_pendingBytes{ 0 };
+};
@@ -0,0 +1,86 @@
+#include "stdafx.h"
+#include "DrawListClass.h"
+
+UINT64 DrawListClass::MakeSortKey(UINT view, UINT pipeline, UINT material, UINT mesh, UINT lod, float depth) {
+	assert(view < MaxViews && pipeline < MaxPipelines && material < MaxMaterials && lod < MaxLods);
+
+	// Anything behind the view origin sorts as closest
+	depth = depth > 0.0f ? depth : 0.0f;
+	UINT32 depthBits;
+	std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	// The sign bit is always clear, keep the exponent and the top of the mantissa
+	depthBits >>= 31 - DepthBits;
+
+	// Mesh ids past the limit wrap around, which only costs batching
+	return
+		(static_cast<UINT64>(view) << 60) |
+		(static_cast<UINT64>(pipeline) << 56) |
+		(static_cast<UINT64>(material) << 40) |
+		(static_cast<UINT64>(mesh & (MaxMeshes - 1)) << 24) |
+		(static_cast<UINT64>(lod) << DepthBits) |
+		static_cast<UINT64>(depthBits);
+}
+
+void DrawListClass::Clear() {
+	m_packets.clear();
+	m_viewOffsets.fill(0U);
+}
+
+void DrawListClass::Add(UINT64 key, UINT32 modelIndex, UINT32 clusterSpan) {
+	m_packets.push_back({ key, modelIndex, clusterSpan });
+	++m_viewOffsets[GetKeyView(key) + 1];
+}
+
+void DrawListClass::Sort() {
+	// Views occupy the top bits, so after sorting they are laid out in order
+	for (UINT view = 1; view <= MaxViews; ++view) {
+		m_viewOffsets[view] += m_viewOffsets[view - 1];
+	}
+
+	const size_t count = m_packets.size();
+	if (count < 2) return;
+
+	m_scratch.resize(count);
+
+	// Histograms for all eight digits in a single read of the keys
+	std::array<std::array<UINT, 256>, 8> histograms{};
+	for (const auto& packet : m_packets) {
+		for (UINT digit = 0; digit < 8; ++digit) {
+			++histograms[digit][(packet.key >> (digit * 8)) & 0xFF];
+		}
+	}
+
+	DrawPacket* src = m_packets.data();
+	DrawPacket* dst = m_scratch.data();
+
+	for (UINT digit = 0; digit < 8; ++digit) {
+		const UINT shift = digit * 8;
+		auto& histogram = histograms[digit];
+
+		if (histogram[(src[0].key >> shift) & 0xFF] == count) continue;
+
+		UINT offset = 0;
+		for (auto& bucket : histogram) {
+			const UINT bucketSize = bucket;
+			bucket = offset;
+			offset += bucketSize;
+		}
+
+		for (size_t i = 0; i < count; ++i) {
+			dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+		}
+
+		std::swap(src, dst);
+	}
+
+	if (src != m_packets.data()) {
+		m_packets.swap(m_scratch);
+	}
+}
+
+DrawListClass::Range DrawListClass::GetView(UINT view) const {
+	assert(view < MaxViews);
+	const DrawPacket* packets = m_packets.data();
+	return { packets + m_viewOffsets[view], packets + m_viewOffsets[view + 1] };
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+struct DrawPacket {
+	UINT64 key;
+	UINT32 modelIndex;
+	UINT32 clusterSpan;	// ClusterCullingClass span to draw instead of the whole mesh, or DrawListClass::NoClusterSpan
+};
+
+// Per frame list of draws for every view, sorted on a 64-bit key so that draws
+// sharing a pipeline state and material end up next to each other, and draws of
+// the same mesh within those form a run that can be drawn instanced.
+//
+// Key layout, most significant first:
+//	[63..60] view
+//	[59..56] pipeline state
+//	[55..40] material id
+//	[39..24] mesh id
+//	[23..22] level of detail
+//	[21..0]  view depth (top bits of a non-negative float, which sort like integers)
+class DrawListClass
+{
+public:
+	static constexpr UINT MaxViews = 16;
+	static constexpr UINT MaxPipelines = 16;
+	static constexpr UINT MaxMaterials = 1 << 16;
+	static constexpr UINT MaxMeshes = 1 << 16;
+	static constexpr UINT MaxLods = 4;
+	static constexpr UINT DepthBits = 22;
+	static constexpr UINT32 NoClusterSpan = UINT_MAX;
+
+	struct Range {
+		const DrawPacket* first;
+		const DrawPacket* last;
+
+		const DrawPacket* begin() const { return first; }
+		const DrawPacket* end() const { return last; }
+		size_t size() const { return static_cast<size_t>(last - first); }
+	};
+
+	DrawListClass() = default;
+
+	static UINT64 MakeSortKey(UINT view, UINT pipeline, UINT material, UINT mesh, UINT lod, float depth);
+	static UINT GetKeyView(UINT64 key) { return static_cast<UINT>(key >> 60); }
+	static UINT GetKeyPipeline(UINT64 key) { return static_cast<UINT>(key >> 56) & (MaxPipelines - 1); }
+	static UINT GetKeyMaterial(UINT64 key) { return static_cast<UINT>(key >> 40) & (MaxMaterials - 1); }
+	static UINT GetKeyMesh(UINT64 key) { return static_cast<UINT>(key >> 24) & (MaxMeshes - 1); }
+	static UINT GetKeyLod(UINT64 key) { return static_cast<UINT>(key >> DepthBits) & (MaxLods - 1); }
+
+	// Packets with equal batch keys only differ in depth and can share a single draw, the level of detail included
+	static UINT64 GetKeyBatch(UINT64 key) { return key >> DepthBits; }
+
+	void Clear();
+	void Add(UINT64 key, UINT32 modelIndex, UINT32 clusterSpan = NoClusterSpan);
+
+	// LSD radix sort, 8 bits per pass. Passes over a byte that every key shares are skipped.
+	void Sort();
+
+	// Packets of a single view, valid after Sort
+	Range GetView(UINT view) const;
+	size_t GetCount() const { return m_packets.size(); }
+
+	// Delete functions
+	DrawListClass(DrawListClass const& rhs) = delete;
+	DrawListClass& operator=(DrawListClass const& rhs) = delete;
+
+	DrawListClass(DrawListClass&& rhs) = delete;
+	DrawListClass& operator=(DrawListClass&& rhs) = delete;
+
+private:
+	std::vector<DrawPacket> m_packets;
+	std::vector<DrawPacket> m_scratch;
+	std::array<UINT, MaxViews + 1> m_viewOffsets{};
+};
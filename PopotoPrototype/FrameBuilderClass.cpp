@@ -0,0 +1,419 @@
+#include "stdafx.h"
+#include "FrameBuilderClass.h"
+#include "Profiler.h"
+
+using namespace Utility;
+
+void FrameBuilderClass::RecordFrame(RenderBackend& backend, FrameMemory& memory, const FrameScene& scene, const FrameTargets& targets, UINT frame) {
+	PROFILE_SCOPE("FrameBuilderClass::RecordFrame");
+
+	const Recording recording{ backend, memory, scene, targets, frame };
+	auto& models = scene.models;
+
+	// Reset command allocator and lists
+	backend.Reset(targets.allocator, targets.pipelines[DrawPipeline::Default][0]);
+
+	// Set required state
+	backend.SetDescriptorHeap(targets.descriptorHeap);
+	backend.SetGraphicsRootSignature(targets.rootSignature);
+
+	m_frameStats = {};
+
+	if (models.size() != m_modelDirtyFrames.size() || MaterialClass::TOTALMATERIALCOUNT != m_materialDirtyFrames.size()) {
+		ResizeSceneData(models);
+	}
+
+	backend.SetGraphicsRootConstantBufferView(RootParameterIndices::MainPass, memory.Push(scene.mainPass));
+
+	for (UINT i = 0; i < static_cast<UINT>(models.size()); ++i) {
+		UpdateModel(recording, i);
+	}
+
+	CullViews(scene);
+	BuildDrawList(scene);
+
+	// Every pass binds the same descriptor range per material, so copy them once up front.
+	// Materials are shared by many models, each range is copied for the first visible one.
+	{
+		const UINT shadowMapIDs[]{ targets.directionalShadow.textureId, targets.pointShadow.textureId };
+		std::fill(m_materialDescriptorsCopied.begin(), m_materialDescriptorsCopied.end(), UINT8{ 0 });
+
+		for (UINT i = 0; i < static_cast<UINT>(models.size()); ++i) {
+			const auto& material = *models[i].m_material;
+			if (m_modelViewMasks[i] && !m_materialDescriptorsCopied[material.m_id]) {
+				material.CopyDescriptors(backend, targets.descriptorSize, targets.globalDescriptors, targets.frameDescriptors, shadowMapIDs);
+				m_materialDescriptorsCopied[material.m_id] = 1;
+			}
+		}
+	}
+
+	backend.IASetPrimitiveTopology(PrimitiveTopology::TriangleList);
+
+	RecordShadowPass(recording, targets.directionalShadow, RenderView::DirectionalLight);
+	RecordShadowPass(recording, targets.pointShadow, RenderView::PointLightFace0);
+
+	backend.RSSetViewport(targets.viewport);
+	backend.RSSetScissorRect(targets.scissorRect);
+
+	// Signal the commandlist that the back buffer will be used as the render target
+	{
+		const ResourceTransition transitionBarrier{
+			targets.backBuffer,
+			ResourceState::Present,
+			ResourceState::RenderTarget
+		};
+
+		backend.ResourceBarrier(1, &transitionBarrier);
+	}
+
+	backend.OMSetRenderTargets(&targets.rtv, &targets.dsv);
+
+	// Issue commands to the commandlist
+	{
+		// Start clearing the rendertarget
+		constexpr std::array<FLOAT, 4> clearColour = { 0.3f, 0.5f, 0.8f, 1.0f };
+		backend.ClearDepthStencilView(targets.dsv, 1.0f, 0UI8);
+		backend.ClearRenderTargetView(targets.rtv, clearColour.data());
+
+		RecordDraws(recording, RenderView::Camera);
+	}
+
+	// Signal the commandlist that the back buffer is to be presented
+	{
+		const ResourceTransition transitionBarrier{
+			targets.backBuffer,
+			ResourceState::RenderTarget,
+			ResourceState::Present
+		};
+
+		backend.ResourceBarrier(1, &transitionBarrier);
+	}
+
+	// Pass constants and instance data allocated this frame
+	m_frameStats.uploadBytes += memory.GetFrameBytes();
+
+	backend.Close();
+}
+
+void FrameBuilderClass::ResolveRenderFlags(const std::vector<ModelClass>& models) {
+	m_modelRenderFlags.resize(models.size());
+	for (size_t i = 0; i < models.size(); ++i) {
+		m_modelRenderFlags[i] = models[i].GetRenderFlags();
+	}
+}
+
+void FrameBuilderClass::PrintFrameStats() const {
+	const wchar_t* viewNames[RenderView::NUM_VIEWS]{
+		L"Camera", L"Directional light",
+		L"Point light -X", L"Point light +X", L"Point light +Y", L"Point light -Y", L"Point light +Z", L"Point light -Z"
+	};
+
+	std::wstringstream t_SStream;
+	for (UINT i = 0; i < RenderView::NUM_VIEWS; ++i) {
+		const auto& view = m_frameStats.views[i];
+		t_SStream << viewNames[i] << ": " << view.visible << " visible, " << view.culled << " culled, "
+			<< view.clusterCulled << " cluster culled, " << view.triangles << " triangles ("
+			<< view.clusterCulledTriangles << " cluster culled, " << view.lodReducedTriangles << " saved by "
+			<< view.reducedLod << " reduced levels of detail)" << std::endl;
+	}
+	t_SStream << "Draw packets: " << m_frameStats.drawPackets
+		<< ", binds saved: " << m_frameStats.pipelineBindsSaved << " pipeline, "
+		<< m_frameStats.materialBindsSaved << " material" << std::endl;
+	t_SStream << "Instanced draws: " << m_frameStats.instancedDraws
+		<< ", models drawn instanced: " << m_frameStats.instancesBatched << std::endl;
+	t_SStream << "Models updated: " << m_frameStats.modelsUpdated
+		<< ", upload bytes: " << m_frameStats.uploadBytes << std::endl;
+	OutputDebugString(t_SStream.str().c_str());
+}
+
+void FrameBuilderClass::ResizeSceneData(const std::vector<ModelClass>& models) {
+	// Slots past the old size start out unseen, removed models simply drop off the end
+	m_modelCulling.Resize(static_cast<UINT>(models.size()));
+	m_modelDirtyFrames.resize(models.size(), AllFramesDirty);
+	m_modelRevisions.resize(models.size(), 0);
+	m_materialDirtyFrames.resize(MaterialClass::TOTALMATERIALCOUNT, AllFramesDirty);
+	m_materialRevisions.resize(MaterialClass::TOTALMATERIALCOUNT, 0);
+	m_materialDescriptorsCopied.resize(MaterialClass::TOTALMATERIALCOUNT);
+	ResolveRenderFlags(models);
+}
+
+void FrameBuilderClass::UpdateModel(const Recording& recording, UINT modelIndex) {
+	auto& model = recording.scene.models[modelIndex];
+	const UINT8 frameBit = static_cast<UINT8>(1U << recording.frame);
+
+	if (model.m_dirty) {
+		model.m_modelConstantBuffer.worldMat = Math::Matrix4(model.m_Transform) * Math::Matrix4::MakeScale(model.m_UniformScale);
+		model.UpdateWorldBounds(model.m_modelConstantBuffer.worldMat);
+
+		model.m_dirty = false;
+		model.m_revision = ++ModelClass::TOTALREVISIONCOUNT;
+	}
+
+	// Also picks up changes another builder recomputed, and models that took over the index of a removed one
+	if (model.m_revision != m_modelRevisions[modelIndex]) {
+		m_modelCulling.SetBounds(modelIndex, model.m_worldBoundsMin, model.m_worldBoundsMax);
+		m_modelRevisions[modelIndex] = model.m_revision;
+		m_modelDirtyFrames[modelIndex] = AllFramesDirty;
+		++m_frameStats.modelsUpdated;
+	}
+
+	if (m_modelDirtyFrames[modelIndex] & frameBit) {
+		recording.memory.WriteModel(recording.frame, model.m_id, model.m_modelConstantBuffer);
+		m_modelDirtyFrames[modelIndex] &= ~frameBit;
+		m_frameStats.uploadBytes += sizeof(ModelConstantBuffer);
+	}
+
+	// Materials can be shared, the first model using one picks up the change
+	auto& material = *model.m_material;
+	if (material.m_dirty) {
+		material.m_dirty = false;
+		material.m_revision = ++MaterialClass::TOTALREVISIONCOUNT;
+	}
+
+	if (material.m_revision != m_materialRevisions[material.m_id]) {
+		m_materialRevisions[material.m_id] = material.m_revision;
+		m_materialDirtyFrames[material.m_id] = AllFramesDirty;
+	}
+
+	if (m_materialDirtyFrames[material.m_id] & frameBit) {
+		recording.memory.WriteMaterial(recording.frame, material.m_id, material.m_materialConstantBuffer);
+		m_materialDirtyFrames[material.m_id] &= ~frameBit;
+		m_frameStats.uploadBytes += sizeof(MaterialClass::MaterialConstantBuffer);
+	}
+}
+
+void FrameBuilderClass::CullViews(const FrameScene& scene) {
+	PROFILE_SCOPE("FrameBuilderClass::CullViews");
+
+	for (UINT v = 0; v < RenderView::NUM_VIEWS; ++v) {
+		const auto& view = scene.views[v];
+		m_viewFrusta[v] = view.frustum;
+		m_clusterViews[v] = { view.frustum, view.position, view.forward, view.orthographic };
+	}
+
+	m_modelCulling.CullViews(m_viewFrusta.data(), RenderView::NUM_VIEWS, m_modelViewMasks, m_visibleModels.data());
+
+	for (UINT v = 0; v < RenderView::NUM_VIEWS; ++v) {
+		m_frameStats.views[v].culled = m_modelCulling.GetCount() - static_cast<UINT>(m_visibleModels[v].size());
+	}
+}
+
+UINT FrameBuilderClass::SelectLod(const ModelClass& model, const FrameView& view) const {
+	const auto& mesh = *model.m_mesh;
+	if (!m_lodSelectionEnabled || mesh.GetLodCount() < 2) return 0;
+
+	// Pixels per unit of object space error at the model, errors grow with the uniform scale
+	float pixelsPerUnit = view.lodScale * model.m_UniformScale;
+	if (!view.orthographic) {
+		const float distance = Math::Length(model.m_worldBoundingSphere.GetCenter() - view.position) - model.m_worldBoundingSphere.GetRadius();
+		if (distance <= 0.0f) return 0;
+		pixelsPerUnit /= distance;
+	}
+
+	// The errors only grow along the chain
+	UINT lod = 0;
+	const UINT lodCount = std::min(mesh.GetLodCount(), DrawListClass::MaxLods);
+	while (lod + 1 < lodCount && mesh.GetLod(lod + 1).error * pixelsPerUnit <= MaxLodPixelError) {
+		++lod;
+	}
+	return lod;
+}
+
+void FrameBuilderClass::BuildDrawList(const FrameScene& scene) {
+	PROFILE_SCOPE("FrameBuilderClass::BuildDrawList");
+
+	m_drawList.Clear();
+	m_clusterCulling.Clear();
+
+	for (UINT view = 0; view < RenderView::NUM_VIEWS; ++view) {
+		const bool renderToShadowMap = view != RenderView::Camera;
+		const auto& frameView = scene.views[view];
+		auto& stats = m_frameStats.views[view];
+
+		// A model is skipped when any of these bits is set
+		const UINT8 skipFlags = RenderFlags::Hidden | RenderFlags::Excluded | RenderFlags::Streaming;
+
+		for (const auto modelIndex : m_visibleModels[view]) {
+			const UINT8 flags = m_modelRenderFlags[modelIndex];
+
+			if (flags & skipFlags) continue;
+			if (renderToShadowMap && !(flags & RenderFlags::CastShadows)) continue;
+
+			const auto& model = scene.models[modelIndex];
+			const auto& meshlets = model.m_mesh->GetMeshlets();
+			const UINT lod = SelectLod(model, frameView);
+			const UINT meshTriangles = model.m_mesh->GetIndexCount(lod) / 3;
+
+			if (lod > 0) {
+				++stats.reducedLod;
+				stats.lodReducedTriangles += model.m_mesh->GetIndexCount() / 3 - meshTriangles;
+			}
+
+			UINT32 clusterSpan = DrawListClass::NoClusterSpan;
+			UINT triangles = meshTriangles;
+
+			// The meshlets cover the full detail level only
+			if (lod == 0 && m_clusterCullingEnabled && meshlets.size() >= ClusterCullingClass::MinMeshlets &&
+				model.m_worldClusterBounds.size() == meshlets.size()) {
+				clusterSpan = m_clusterCulling.Cull(m_clusterViews[view], meshlets.data(), model.m_worldClusterBounds.data(), static_cast<UINT>(meshlets.size()));
+				triangles = m_clusterCulling.GetSpan(clusterSpan).indexCount / 3;
+				stats.clusterCulledTriangles += meshTriangles - triangles;
+
+				if (triangles == 0) {
+					++stats.clusterCulled;
+					continue;
+				}
+			}
+
+			++stats.visible;
+			stats.triangles += triangles;
+
+			const UINT pipeline = [&] {
+				if (renderToShadowMap)
+					return DrawPipeline::ShadowMap;
+				else {
+					return (flags & RenderFlags::ReceiveShadows) ? DrawPipeline::Default : DrawPipeline::ReceiveNoShadow;
+				}
+			}();
+
+			const float depth = Math::Dot(model.m_worldBoundingSphere.GetCenter() - frameView.position, frameView.forward);
+
+			m_drawList.Add(DrawListClass::MakeSortKey(view, pipeline, model.m_material->m_id, model.m_mesh->m_id, lod, depth), modelIndex, clusterSpan);
+		}
+	}
+
+	m_drawList.Sort();
+	m_frameStats.drawPackets = static_cast<UINT>(m_drawList.GetCount());
+}
+
+void FrameBuilderClass::RecordShadowPass(const Recording& recording, const ShadowPassTargets& pass, UINT firstView) {
+	PROFILE_SCOPE("FrameBuilderClass::RecordShadowPass");
+
+	auto& backend = recording.backend;
+
+	backend.RSSetViewport(pass.viewport);
+	backend.RSSetScissorRect(pass.scissorRect);
+
+	{
+		const ResourceTransition transitionBarrier{
+			pass.shadowMap,
+			ResourceState::PixelShaderResource,
+			ResourceState::DepthWrite
+		};
+
+		backend.ResourceBarrier(1, &transitionBarrier);
+	}
+
+	for (UINT i = 0U; i < pass.viewCount; ++i) {
+		const LightPassConstantBuffer lightPass{ recording.scene.views[firstView + i].viewProjMat };
+
+		backend.SetGraphicsRootConstantBufferView(
+			RootParameterIndices::Light,
+			recording.memory.Push(lightPass));
+
+		backend.ClearDepthStencilView(pass.dsvs[i], 1.0f, 0UI8);
+		backend.OMSetRenderTargets(nullptr, &pass.dsvs[i]);
+
+		RecordDraws(recording, firstView + i);
+	}
+
+	{
+		const ResourceTransition transitionBarrier{
+			pass.shadowMap,
+			ResourceState::DepthWrite,
+			ResourceState::PixelShaderResource
+		};
+
+		backend.ResourceBarrier(1, &transitionBarrier);
+	}
+}
+
+void FrameBuilderClass::RecordDraws(const Recording& recording, UINT view) {
+	PROFILE_SCOPE("FrameBuilderClass::RecordDraws");
+
+	auto& backend = recording.backend;
+	const auto& models = recording.scene.models;
+	const auto& targets = recording.targets;
+
+	// State bound by the previous packet, packets are sorted so that these repeat as often as possible
+	UINT boundPipeline = UINT_MAX;
+	bool boundInstanced = false;
+	UINT boundMaterial = UINT_MAX;
+	DXGI_FORMAT boundIndexFormat = DXGI_FORMAT_UNKNOWN;
+
+	// Every mesh lives in the arena, so its vertices only have to be bound once
+	recording.scene.geometryArena.Bind(backend);
+
+	const auto packets = m_drawList.GetView(view);
+
+	for (auto packet = packets.begin(); packet != packets.end();) {
+		const auto& model = models[packet->modelIndex];
+		const auto& material = *model.m_material;
+		const auto* mesh = model.m_mesh.get();
+
+		// Packets that only differ in depth follow each other, the mesh is compared as well
+		// because mesh ids wrap around in the key. Cluster culled packets draw their own ranges.
+		const auto batchKey = DrawListClass::GetKeyBatch(packet->key);
+		const bool clusterCulled = packet->clusterSpan != DrawListClass::NoClusterSpan;
+		auto batchEnd = packet + 1;
+		while (m_instancingEnabled && !clusterCulled && batchEnd != packets.end() &&
+			DrawListClass::GetKeyBatch(batchEnd->key) == batchKey &&
+			batchEnd->clusterSpan == DrawListClass::NoClusterSpan &&
+			models[batchEnd->modelIndex].m_mesh.get() == mesh) {
+			++batchEnd;
+		}
+
+		const auto instanceCount = static_cast<UINT>(batchEnd - packet);
+		const auto lod = DrawListClass::GetKeyLod(packet->key);
+		const bool instanced = instanceCount >= MinInstanceCount;
+
+		const auto pipeline = DrawListClass::GetKeyPipeline(packet->key);
+		if (pipeline != boundPipeline || instanced != boundInstanced) {
+			backend.SetPipelineState(targets.pipelines[pipeline][instanced ? 1 : 0]);
+			boundPipeline = pipeline;
+			boundInstanced = instanced;
+		}
+		else {
+			++m_frameStats.pipelineBindsSaved;
+		}
+
+		// Most meshes use 16-bit indices, the index pool only changes for the few large ones
+		if (mesh->GetIndexFormat() != boundIndexFormat) {
+			recording.scene.geometryArena.BindIndices(backend, mesh->GetIndexFormat());
+			boundIndexFormat = mesh->GetIndexFormat();
+		}
+
+		if (material.m_id != boundMaterial) {
+			material.BindMaterial(backend, targets.descriptorSize, recording.memory.GetMaterialAddress(recording.frame, material.m_id), targets.frameDescriptorsGpu);
+			boundMaterial = material.m_id;
+		}
+		else {
+			++m_frameStats.materialBindsSaved;
+		}
+
+		if (instanced) {
+			// The world matrices of the run go to the frame memory, read by the shader through SV_InstanceID
+			const auto allocation = recording.memory.Allocate(instanceCount * sizeof(ModelConstantBuffer));
+			auto* instanceData = reinterpret_cast<ModelConstantBuffer*>(allocation.cpuAddress);
+
+			for (auto instance = packet; instance != batchEnd; ++instance) {
+				*instanceData++ = models[instance->modelIndex].m_modelConstantBuffer;
+			}
+
+			backend.SetGraphicsRootShaderResourceView(RootParameterIndices::Instances, allocation.gpuAddress);
+			mesh->Draw(backend, instanceCount, lod);
+
+			++m_frameStats.instancedDraws;
+			m_frameStats.instancesBatched += instanceCount;
+		}
+		else if (clusterCulled) {
+			const auto& span = m_clusterCulling.GetSpan(packet->clusterSpan);
+			model.DrawModel(backend, recording.memory.GetModelAddress(recording.frame, model.m_id), m_clusterCulling.GetRanges(span), span.rangeCount);
+		}
+		else {
+			model.DrawModel(backend, recording.memory.GetModelAddress(recording.frame, model.m_id), lod);
+		}
+
+		packet = batchEnd;
+	}
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include "ModelClass.h"
+#include "FrameMemory.h"
+#include "CullingClass.h"
+#include "ClusterCullingClass.h"
+#include "DrawListClass.h"
+
+struct Light
+{
+	DirectX::XMFLOAT3 Strength = { 0.5f, 0.5f, 0.5f };
+	float FalloffStart = 1.0f;                          // point/spot light only
+	DirectX::XMFLOAT3 Direction = { 0.0f, -1.0f, 0.0f };// directional/spot light only
+	float FalloffEnd = 10.0f;                           // point/spot light only
+	DirectX::XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };  // point/spot light only
+	float SpotPower = 64.0f;                            // spot light only
+};
+
+#define MaxLights 16
+
+/*
+	Directional:
+		[0, 1]
+	Point:
+		[2]
+	Spot:
+		-
+*/
+
+struct MainPassConstantBuffer {
+	Math::Vector3 eyePosition{ 0.0f, 0.0f, 0.0f };
+	Math::Vector4 ambientLight{ 0.0f, 0.0f, 0.0f, 0.0f };
+	Math::Matrix4 vpMat{ Math::kIdentity };
+	Math::Matrix4 directionalLightVpMat{ Math::kIdentity };
+	std::array<Math::Matrix4, 6> pointLightVpMats{ Math::Matrix4{ Math::kIdentity } };
+	Light lights[MaxLights];
+};
+
+struct LightPassConstantBuffer {
+	Math::Matrix4 lightVpMat{ Math::kIdentity };
+};
+
+// Every view that is culled and recorded in a frame
+namespace RenderView {
+	enum : UINT {
+		Camera,
+		DirectionalLight,
+		PointLightFace0,	// Followed by the remaining five cube faces
+		NUM_VIEWS = PointLightFace0 + 6
+	};
+};
+
+struct ViewCullStats {
+	UINT visible = 0;	// Models drawn in the view
+	UINT culled = 0;	// Models rejected by the frustum test
+	UINT clusterCulled = 0;	// Models that passed it, but none of whose meshlets did
+	UINT reducedLod = 0;	// Models drawn at a coarser level of detail than their full mesh
+
+	UINT64 triangles = 0;				// Submitted for drawing
+	UINT64 clusterCulledTriangles = 0;	// Left out by cluster culling
+	UINT64 lodReducedTriangles = 0;		// Left out by drawing a coarser level of detail
+};
+
+// Pipeline states in the order draws are sorted within a view
+namespace DrawPipeline {
+	enum : UINT {
+		Default,
+		ReceiveNoShadow,
+		ShadowMap,
+		NUM_PIPELINES
+	};
+};
+
+struct FrameStats {
+	std::array<ViewCullStats, RenderView::NUM_VIEWS> views{};
+	UINT drawPackets = 0;
+
+	// Binds skipped because the previous draw in the pass already had the same state bound
+	UINT pipelineBindsSaved = 0;
+	UINT materialBindsSaved = 0;	// Material CBV and descriptor table
+
+	UINT instancedDraws = 0;		// Draws covering more than one model
+	UINT instancesBatched = 0;		// Models drawn by those
+
+	UINT modelsUpdated = 0;			// World matrices recomputed
+	UINT64 uploadBytes = 0;			// Constant data written to upload memory
+};
+
+// A view as it is culled and drawn
+struct FrameView {
+	Math::Frustum frustum;							// World space
+	Math::Vector3 position{ Math::kZero };
+	Math::Vector3 forward{ Math::kZero };
+	Math::Matrix4 viewProjMat{ Math::kIdentity };	// Written to the light pass constants of the shadow views
+	float lodScale{ 0.0f };	// Pixels a unit of world space covers at unit distance, or at any distance when orthographic
+	bool orthographic{ false };
+};
+
+// What a frame draws. D3DClass fills in the views and pass constants from its camera and lights.
+struct FrameScene {
+	std::vector<ModelClass>& models;
+	const GeometryArenaClass& geometryArena;
+	const std::array<FrameView, RenderView::NUM_VIEWS>& views;
+	const MainPassConstantBuffer& mainPass;
+};
+
+// The depth targets of a shadow map, one per view of its light
+struct ShadowPassTargets {
+	ResourceHandle shadowMap{ ResourceHandle::Null };
+	std::array<CpuDescriptorHandle, 6> dsvs{};
+	UINT viewCount{ 1 };
+	UINT textureId{ 0 };	// Slot of its SRV in the global heap
+	Viewport viewport{};
+	ScissorRect scissorRect{};
+};
+
+// The objects a frame is recorded against, as backend handles. Headless frames can leave them null.
+struct FrameTargets {
+	CommandAllocatorHandle allocator{ CommandAllocatorHandle::Null };
+	RootSignatureHandle rootSignature{ RootSignatureHandle::Null };
+	std::array<std::array<PipelineHandle, 2>, DrawPipeline::NUM_PIPELINES> pipelines{};	// Indexed by DrawPipeline, then by instanced
+
+	// Every material has a range of descriptors in the shader visible heap, copied from the global heap
+	DescriptorHeapHandle descriptorHeap{ DescriptorHeapHandle::Null };
+	CpuDescriptorHandle globalDescriptors{};		// Start of the global heap
+	CpuDescriptorHandle frameDescriptors{};			// Start of the shader visible heap as it is written
+	GpuDescriptorHandle frameDescriptorsGpu{};		// And as it is bound
+	UINT descriptorSize{ 0 };
+
+	ResourceHandle backBuffer{ ResourceHandle::Null };
+	CpuDescriptorHandle rtv{};
+	CpuDescriptorHandle dsv{};
+	Viewport viewport{};
+	ScissorRect scissorRect{};
+
+	ShadowPassTargets directionalShadow{};
+	ShadowPassTargets pointShadow{};
+};
+
+// ----------------------------
+// ----Class Definitions----
+// ----------------------------
+
+// Builds the CPU side of a frame: writes the constants of changed models, culls every view, selects
+// the levels of detail, sorts the draws and records the passes into a RenderBackend. It holds no graphics
+// API object, D3DClass passes its D3D12 objects as handles next to a D3D12FrameMemory, while a headless
+// frame records into a RecordingRenderBackend and a CpuFrameMemory without any device.
+// Builders keep their own track of model and material changes, so several can draw the same scene.
+class FrameBuilderClass
+{
+public:
+	static constexpr UINT MinInstanceCount = 2;		// Shortest run of packets that is drawn instanced
+	static constexpr float MaxLodPixelError = 1.0f;	// Largest simplification error a level may show, in pixels of its view
+
+	FrameBuilderClass() = default;
+
+	// Records the frame from Reset to Close. frame selects the copy of the constant slots that is written.
+	void RecordFrame(RenderBackend& backend, FrameMemory& memory, const FrameScene& scene, const FrameTargets& targets, UINT frame);
+
+	// Packs the shadow and visibility flags of every model for the draw loops. Has to be called again
+	// after changing any of these flags on a model, RecordFrame does so after models were added or removed.
+	void ResolveRenderFlags(const std::vector<ModelClass>& models);
+
+	// Culling results of the last recorded frame
+	const FrameStats& GetFrameStats() const { return m_frameStats; }
+	const std::array<Math::Frustum, RenderView::NUM_VIEWS>& GetViewFrusta() const { return m_viewFrusta; }
+	void PrintFrameStats() const;
+
+	// Meshes with enough meshlets are culled per meshlet after the per model test, on by default
+	void SetClusterCulling(bool enabled) { m_clusterCullingEnabled = enabled; }
+	bool IsClusterCullingEnabled() const { return m_clusterCullingEnabled; }
+
+	// Models are drawn at the coarsest level of detail whose error stays below MaxLodPixelError on screen, on by default
+	void SetLodSelection(bool enabled) { m_lodSelectionEnabled = enabled; }
+	bool IsLodSelectionEnabled() const { return m_lodSelectionEnabled; }
+
+	// Runs of at least MinInstanceCount packets with the same mesh and material become one instanced draw, on by default
+	void SetInstancing(bool enabled) { m_instancingEnabled = enabled; }
+	bool IsInstancingEnabled() const { return m_instancingEnabled; }
+
+	// Delete functions
+	FrameBuilderClass(FrameBuilderClass const& rhs) = delete;
+	FrameBuilderClass& operator=(FrameBuilderClass const& rhs) = delete;
+
+	FrameBuilderClass(FrameBuilderClass&& rhs) = delete;
+	FrameBuilderClass& operator=(FrameBuilderClass&& rhs) = delete;
+
+private:
+	// The arguments of the frame being recorded
+	struct Recording {
+		RenderBackend& backend;
+		FrameMemory& memory;
+		const FrameScene& scene;
+		const FrameTargets& targets;
+		UINT frame;
+	};
+
+	// Sizes the per model and per material data after models or materials were added or removed
+	void ResizeSceneData(const std::vector<ModelClass>& models);
+
+	// Recomputes the world matrix and bounds of a changed model and writes its constants
+	// into the slots of frames that have not seen the change yet
+	void UpdateModel(const Recording& recording, UINT modelIndex);
+
+	void CullViews(const FrameScene& scene);
+	void BuildDrawList(const FrameScene& scene);
+	UINT SelectLod(const ModelClass& model, const FrameView& view) const;
+
+	void RecordShadowPass(const Recording& recording, const ShadowPassTargets& pass, UINT firstView);
+
+	// Records the sorted draw packets of the view, skipping binds that are already in place.
+	// Runs of packets drawing the same mesh and material become a single instanced draw.
+	void RecordDraws(const Recording& recording, UINT view);
+
+	// Bit per frame copy that still holds outdated constants, indexed like the models and by material id.
+	// A change is written to every copy in turn, after that the model is not touched again.
+	static constexpr UINT8 AllFramesDirty = (1U << FrameMemory::FrameCount) - 1U;
+	std::vector<UINT8> m_modelDirtyFrames;
+	std::vector<UINT8> m_materialDirtyFrames;
+
+	// Revision of every model and material the dirty bits were last set for, 0 before the first
+	std::vector<UINT64> m_modelRevisions;
+	std::vector<UINT64> m_materialRevisions;
+
+	// Set for the materials whose descriptors were copied this frame, indexed by material id
+	std::vector<UINT8> m_materialDescriptorsCopied;
+
+	FrameStats m_frameStats{};
+
+	// World space bounds of the models
+	CullingClass m_modelCulling;
+	std::array<Math::Frustum, RenderView::NUM_VIEWS> m_viewFrusta;
+	std::vector<UINT8> m_modelViewMasks;	// Bit per view, set when the model intersects its frustum
+	std::array<std::vector<UINT>, RenderView::NUM_VIEWS> m_visibleModels;
+	std::vector<UINT8> m_modelRenderFlags;	// RenderFlags, indexed like the models
+	DrawListClass m_drawList;
+
+	// Index ranges of the meshlets surviving in each view, referenced by the draw packets
+	ClusterCullingClass m_clusterCulling;
+	std::array<ClusterCullingClass::View, RenderView::NUM_VIEWS> m_clusterViews;
+	bool m_clusterCullingEnabled{ true };
+
+	bool m_lodSelectionEnabled{ true };
+	bool m_instancingEnabled{ true };
+};
@@ -0,0 +1,88 @@
+#include "stdafx.h"
+#include "FrameMemory.h"
+
+D3D12FrameMemory::D3D12FrameMemory(Microsoft::WRL::ComPtr<ID3D12Device> device, UINT64 initialFrameSize) :
+	m_frameUploadBuffer{ device, initialFrameSize, L"m_frameUploadBuffer" },
+	m_modelConstantBuffers{ device, L"m_modelConstantBuffers" },
+	m_materialConstantBuffers{ device, L"m_materialConstantBuffers" } {}
+
+void D3D12FrameMemory::BeginFrame(UINT64 completedFenceValue) {
+	m_frameUploadBuffer.BeginFrame(completedFenceValue);
+	m_modelConstantBuffers.ReleaseRetired(completedFenceValue);
+	m_materialConstantBuffers.ReleaseRetired(completedFenceValue);
+}
+
+void D3D12FrameMemory::EndFrame(UINT64 fenceValue) {
+	m_frameUploadBuffer.EndFrame(fenceValue);
+}
+
+void D3D12FrameMemory::Reserve(UINT modelCount, UINT materialCount, UINT64 fenceValue) {
+	m_modelConstantBuffers.Reserve(modelCount, fenceValue);
+	m_materialConstantBuffers.Reserve(materialCount, fenceValue);
+}
+
+FrameMemory::Allocation D3D12FrameMemory::Allocate(UINT64 size) {
+	const auto allocation = m_frameUploadBuffer.Allocate(size);
+	return { allocation.cpuAddress, allocation.gpuAddress };
+}
+
+void D3D12FrameMemory::WriteModel(UINT frame, UINT id, const ModelConstantBuffer& data) {
+	m_modelConstantBuffers.Write(frame, id, data);
+}
+
+GpuAddress D3D12FrameMemory::GetModelAddress(UINT frame, UINT id) const {
+	return m_modelConstantBuffers.GetGPUAddress(frame, id);
+}
+
+void D3D12FrameMemory::WriteMaterial(UINT frame, UINT id, const MaterialClass::MaterialConstantBuffer& data) {
+	m_materialConstantBuffers.Write(frame, id, data);
+}
+
+GpuAddress D3D12FrameMemory::GetMaterialAddress(UINT frame, UINT id) const {
+	return m_materialConstantBuffers.GetGPUAddress(frame, id);
+}
+
+void CpuFrameMemory::BeginFrame() {
+	if (m_frameBytes > m_frameBuffer.size()) {
+		m_frameBuffer.resize(static_cast<size_t>(m_frameBytes));
+	}
+	m_overflow.clear();
+	m_frameBytes = 0;
+}
+
+FrameMemory::Allocation CpuFrameMemory::Allocate(UINT64 size) {
+	const UINT64 offset = Math::AlignUp(m_frameBytes, SlotSize);
+	m_frameBytes = offset + size;
+
+	// Growing the buffer now would move the allocations handed out before
+	if (m_frameBytes > m_frameBuffer.size()) {
+		m_overflow.push_back(std::make_unique<UINT8[]>(static_cast<size_t>(size)));
+		return { m_overflow.back().get(), FrameBase + offset };
+	}
+
+	return { m_frameBuffer.data() + offset, FrameBase + offset };
+}
+
+void CpuFrameMemory::WriteModel(UINT frame, UINT id, const ModelConstantBuffer& data) {
+	auto& slots = m_models[frame];
+	if (id >= slots.size()) {
+		slots.resize(id + 1);
+	}
+	slots[id] = data;
+}
+
+GpuAddress CpuFrameMemory::GetModelAddress(UINT frame, UINT id) const {
+	return ModelBase + frame * FrameStride + id * SlotSize;
+}
+
+void CpuFrameMemory::WriteMaterial(UINT frame, UINT id, const MaterialClass::MaterialConstantBuffer& data) {
+	auto& slots = m_materials[frame];
+	if (id >= slots.size()) {
+		slots.resize(id + 1);
+	}
+	slots[id] = data;
+}
+
+GpuAddress CpuFrameMemory::GetMaterialAddress(UINT frame, UINT id) const {
+	return MaterialBase + frame * FrameStride + id * SlotSize;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "ModelClass.h"
+#include "MaterialClass.h"
+#include "RenderBackend.h"
+#include "UploadBufferClass.h"
+
+// ----------------------------
+// ----Class Definitions----
+// ----------------------------
+
+// Where the constants of a recorded frame go. Models and materials have a fixed slot per id, with
+// a copy for every frame in flight, the rest is memory of the frame itself that the next frame
+// recorded into the same copy can reuse.
+// D3DClass writes to upload heaps through the D3D12FrameMemory, headless frames to the CpuFrameMemory.
+class FrameMemory {
+public:
+	static constexpr UINT FrameCount = 3;	// Frames in flight
+
+	struct Allocation {
+		UINT8* cpuAddress;
+		GpuAddress gpuAddress;
+	};
+
+	virtual ~FrameMemory() = default;
+
+	// Constant buffer aligned memory of the frame being recorded
+	virtual Allocation Allocate(UINT64 size) = 0;
+
+	// frame selects the copy of the slot, in [0, FrameCount)
+	virtual void WriteModel(UINT frame, UINT id, const ModelConstantBuffer& data) = 0;
+	virtual GpuAddress GetModelAddress(UINT frame, UINT id) const = 0;
+	virtual void WriteMaterial(UINT frame, UINT id, const MaterialClass::MaterialConstantBuffer& data) = 0;
+	virtual GpuAddress GetMaterialAddress(UINT frame, UINT id) const = 0;
+
+	// Bytes allocated by the frame being recorded, slot writes not included
+	virtual UINT64 GetFrameBytes() const = 0;
+
+	// Copies data into a new allocation and returns its GPU address
+	template<typename T>
+	GpuAddress Push(const T& data) {
+		const auto allocation = Allocate(sizeof(T));
+		std::memcpy(allocation.cpuAddress, &data, sizeof(T));
+		return allocation.gpuAddress;
+	}
+};
+
+// Upload heap memory, a ring for the frame's allocations and a ConstantBufferArray per kind of slot
+class D3D12FrameMemory final : public FrameMemory {
+public:
+	D3D12FrameMemory(Microsoft::WRL::ComPtr<ID3D12Device> device, UINT64 initialFrameSize);
+
+	// Frees the memory of every frame the GPU has completed, see UploadRingBuffer::BeginFrame
+	void BeginFrame(UINT64 completedFenceValue);
+
+	// The frame's allocations are in use until the GPU passes fenceValue
+	void EndFrame(UINT64 fenceValue);
+
+	// Grows the slots to at least the given counts, replaced buffers are released once the GPU has passed fenceValue
+	void Reserve(UINT modelCount, UINT materialCount, UINT64 fenceValue);
+
+	Allocation Allocate(UINT64 size) override;
+
+	void WriteModel(UINT frame, UINT id, const ModelConstantBuffer& data) override;
+	GpuAddress GetModelAddress(UINT frame, UINT id) const override;
+	void WriteMaterial(UINT frame, UINT id, const MaterialClass::MaterialConstantBuffer& data) override;
+	GpuAddress GetMaterialAddress(UINT frame, UINT id) const override;
+
+	UINT64 GetFrameBytes() const override { return m_frameUploadBuffer.GetBytesAllocatedThisFrame(); }
+
+	// Delete functions
+	D3D12FrameMemory(D3D12FrameMemory const& rhs) = delete;
+	D3D12FrameMemory& operator=(D3D12FrameMemory const& rhs) = delete;
+
+	D3D12FrameMemory(D3D12FrameMemory&& rhs) = delete;
+	D3D12FrameMemory& operator=(D3D12FrameMemory&& rhs) = delete;
+
+private:
+	UploadRingBuffer m_frameUploadBuffer;
+	ConstantBufferArray<ModelConstantBuffer, FrameCount> m_modelConstantBuffers;
+	ConstantBufferArray<MaterialClass::MaterialConstantBuffer, FrameCount> m_materialConstantBuffers;
+};
+
+// Memory of headless frames, which no GPU reads. The addresses are offsets from made up bases, so the
+// recorded stream looks like the one of a real frame. Slots grow as they are written.
+class CpuFrameMemory final : public FrameMemory {
+public:
+	CpuFrameMemory() = default;
+
+	// Starts a frame, reusing the memory of the previous one
+	void BeginFrame();
+
+	Allocation Allocate(UINT64 size) override;
+
+	void WriteModel(UINT frame, UINT id, const ModelConstantBuffer& data) override;
+	GpuAddress GetModelAddress(UINT frame, UINT id) const override;
+	void WriteMaterial(UINT frame, UINT id, const MaterialClass::MaterialConstantBuffer& data) override;
+	GpuAddress GetMaterialAddress(UINT frame, UINT id) const override;
+
+	UINT64 GetFrameBytes() const override { return m_frameBytes; }
+
+	// Delete functions
+	CpuFrameMemory(CpuFrameMemory const& rhs) = delete;
+	CpuFrameMemory& operator=(CpuFrameMemory const& rhs) = delete;
+
+	CpuFrameMemory(CpuFrameMemory&& rhs) = delete;
+	CpuFrameMemory& operator=(CpuFrameMemory&& rhs) = delete;
+
+private:
+	static constexpr UINT64 SlotSize = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+	static constexpr GpuAddress FrameBase = 1ULL << 40;
+	static constexpr GpuAddress ModelBase = 2ULL << 40;		// Followed by the copy of every frame
+	static constexpr GpuAddress MaterialBase = 4ULL << 40;	// Same
+	static constexpr GpuAddress FrameStride = 1ULL << 36;	// Between the copies of a slot
+
+	std::vector<UINT8> m_frameBuffer;
+	std::vector<std::unique_ptr<UINT8[]>> m_overflow;	// Allocations past the end of m_frameBuffer, which grows at the next BeginFrame
+	UINT64 m_frameBytes{ 0 };
+
+	std::array<std::vector<ModelConstantBuffer>, FrameCount> m_models;
+	std::array<std::vector<MaterialClass::MaterialConstantBuffer>, FrameCount> m_materials;
+};
@@ -0,0 +1,278 @@
+#include "stdafx.h"
+#include "GeometryArenaClass.h"
+#include "D3D12RenderBackend.h"
+
+#include <algorithm>
+
+using Microsoft::WRL::ComPtr;
+using namespace Utility;
+
+// ----------------------------
+// ----RangeAllocator----
+// ----------------------------
+
+UINT RangeAllocator::Allocate(UINT count) {
+	if (count == 0) return 0;
+
+	for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it) {
+		if (it->second < count) continue;
+
+		const UINT offset = it->first;
+		const UINT remaining = it->second - count;
+		m_freeRanges.erase(it);
+
+		if (remaining) {
+			m_freeRanges.emplace(offset + count, remaining);
+		}
+
+		m_used += count;
+		return offset;
+	}
+
+	return InvalidOffset;
+}
+
+void RangeAllocator::Free(UINT offset, UINT count) {
+	if (count == 0) return;
+	assert(offset + count <= m_capacity && count <= m_used);
+
+	m_used -= count;
+
+	auto next = m_freeRanges.lower_bound(offset);
+	assert(next == m_freeRanges.end() || next->first >= offset + count);
+
+	// Merge with the free range that ends where this one starts
+	if (next != m_freeRanges.begin()) {
+		auto previous = std::prev(next);
+		assert(previous->first + previous->second <= offset);
+
+		if (previous->first + previous->second == offset) {
+			offset = previous->first;
+			count += previous->second;
+			m_freeRanges.erase(previous);
+		}
+	}
+
+	// And with the one that starts where this one ends
+	if (next != m_freeRanges.end() && next->first == offset + count) {
+		count += next->second;
+		m_freeRanges.erase(next);
+	}
+
+	m_freeRanges.emplace(offset, count);
+}
+
+void RangeAllocator::Grow(UINT newCapacity) {
+	assert(newCapacity >= m_capacity);
+
+	const UINT oldCapacity = m_capacity;
+	m_capacity = newCapacity;
+
+	// Freeing the new tail merges it with a free range at the old end
+	m_used += newCapacity - oldCapacity;
+	Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+// ----------------------------
+// ----GeometryArenaClass----
+// ----------------------------
+
+template<typename T>
+GeometryArenaClass::Range GeometryArenaClass::Allocate(Pool<T>& pool, const T* elements, UINT count, std::shared_ptr<const void> owner, UINT initialCapacity) {
+	UINT offset = pool.allocator.Allocate(count);
+
+	if (offset == RangeAllocator::InvalidOffset) {
+		const UINT capacity = pool.allocator.GetCapacity();
+		pool.allocator.Grow(std::max({ initialCapacity, capacity * 2, capacity + count }));
+
+		offset = pool.allocator.Allocate(count);
+		assert(offset != RangeAllocator::InvalidOffset);
+	}
+
+	if (count == 0) return { offset, count };
+
+	// Consecutive ranges from consecutive memory, like the meshes of a cooked scene, upload as a single copy
+	if (!pool.pendingWrites.empty()) {
+		auto& last = pool.pendingWrites.back();
+		if (last.offset + last.count == offset && last.elements + last.count == elements && last.owner == owner) {
+			last.count += count;
+			return { offset, count };
+		}
+	}
+
+	pool.pendingWrites.push_back({ offset, count, elements, std::move(owner) });
+	return { offset, count };
+}
+
+GeometryArenaClass::Range GeometryArenaClass::AllocateVertices(const GeometryClass::Vertex* vertices, UINT count, std::shared_ptr<const void> owner) {
+	return Allocate(m_vertices, vertices, count, std::move(owner), InitialVertexCapacity);
+}
+
+GeometryArenaClass::IndexRange GeometryArenaClass::AllocateIndices(const UINT32* indices, UINT count, UINT vertexCount, std::shared_ptr<const void> owner) {
+	IndexRange range;
+	range.format = SelectIndexFormat(vertexCount);
+	static_cast<Range&>(range) = Allocate(GetIndexPool(range.format), indices, count, std::move(owner), InitialIndexCapacity);
+	return range;
+}
+
+void GeometryArenaClass::FreeVertices(const Range& range) {
+	m_vertices.allocator.Free(range.offset, range.count);
+}
+
+void GeometryArenaClass::FreeIndices(const IndexRange& range) {
+	GetIndexPool(range.format).allocator.Free(range.offset, range.count);
+}
+
+UINT64 GeometryArenaClass::GetVertexBytes() const {
+	return static_cast<UINT64>(VertexPacking::GetStride(m_vertexFormat)) * m_vertices.allocator.GetUsed();
+}
+
+UINT64 GeometryArenaClass::GetIndexBytes() const {
+	return sizeof(UINT16) * static_cast<UINT64>(m_indices16.allocator.GetUsed()) +
+		sizeof(UINT32) * static_cast<UINT64>(m_indices32.allocator.GetUsed());
+}
+
+void GeometryArenaClass::StageElements(const GeometryClass::Vertex* vertices, UINT count, UINT stride, void* dst) const {
+	assert(stride == VertexPacking::GetStride(m_vertexFormat));
+	VertexPacking::Pack(m_vertexFormat, vertices, count, dst);
+}
+
+void GeometryArenaClass::StageElements(const UINT32* indices, UINT count, UINT stride, void* dst) const {
+	if (stride == sizeof(UINT32)) {
+		std::memcpy(dst, indices, sizeof(UINT32) * static_cast<size_t>(count));
+		return;
+	}
+
+	// Narrowed in blocks on the stack, dst is usually write combined upload memory that is slow to touch piecewise
+	constexpr UINT BlockSize = 1024;
+	UINT16 block[BlockSize];
+	auto* dstIndices = static_cast<UINT16*>(dst);
+
+	for (UINT first = 0; first < count; first += BlockSize) {
+		const UINT blockCount = std::min(BlockSize, count - first);
+		for (UINT i = 0; i < blockCount; ++i) {
+			assert(indices[first + i] <= UINT16_MAX);
+			block[i] = static_cast<UINT16>(indices[first + i]);
+		}
+		std::memcpy(dstIndices + first, block, sizeof(UINT16) * static_cast<size_t>(blockCount));
+	}
+}
+
+template<typename T>
+IndexBufferBinding GeometryArenaClass::GetIndexBinding(const Pool<T>& pool, DXGI_FORMAT format) {
+	IndexBufferBinding binding{};
+	binding.format = D3D12Handles::ToIndexFormat(format);
+	if (pool.buffer) {
+		const UINT stride = format == DXGI_FORMAT_R16_UINT ? sizeof(UINT16) : sizeof(UINT32);
+		binding.address = pool.buffer->GetGPUVirtualAddress();
+		binding.sizeInBytes = stride * pool.bufferCapacity;
+	}
+	return binding;
+}
+
+template<typename T>
+void GeometryArenaClass::UploadPool(
+	Pool<T>& pool,
+	ID3D12Device* device,
+	UploadBatchClass& uploadBatch,
+	UINT stride,
+	D3D12_RESOURCE_STATES usedState,
+	const wchar_t* name) {
+
+	const auto poolCapacity = pool.allocator.GetCapacity();
+	bool written = false;
+
+	if (pool.bufferCapacity < poolCapacity) {
+		ComPtr<ID3D12Resource> buffer;
+		const auto defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+		const auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(stride * static_cast<UINT64>(poolCapacity));
+
+		ThrowIfFailed(
+			device->CreateCommittedResource(
+				&defaultHeapProperties,
+				D3D12_HEAP_FLAG_NONE,
+				&bufferDesc,
+				D3D12_RESOURCE_STATE_COPY_DEST,
+				nullptr,
+				IID_PPV_ARGS(&buffer)));
+		SetName(buffer.Get(), name);
+
+		// Too small, the new buffer receives the old pool on the GPU, ahead of the pending writes.
+		// The old one is drawn from until this upload is published.
+		if (pool.buffer) {
+			uploadBatch.CopyBuffer(buffer.Get(), 0, pool.buffer.Get(), 0, stride * static_cast<UINT64>(pool.bufferCapacity));
+			m_replacedBuffers.push_back({ m_lastUploadId, std::move(pool.buffer) });
+		}
+
+		pool.buffer = std::move(buffer);
+		pool.bufferCapacity = poolCapacity;
+		written = true;
+	}
+
+	// Buffers decay to the common state after every submission, so an existing pool is promoted to
+	// the copy destination state by the copy itself and needs no barrier in front of it
+	for (const auto& write : pool.pendingWrites) {
+		void* staged = uploadBatch.StageBuffer(
+			pool.buffer.Get(),
+			stride * static_cast<UINT64>(write.offset),
+			stride * static_cast<UINT64>(write.count));
+		StageElements(write.elements, write.count, stride, staged);
+		written = true;
+	}
+	pool.pendingWrites.clear();
+
+	if (written) {
+		uploadBatch.AddPostCopyBarrier(CD3DX12_RESOURCE_BARRIER::Transition(pool.buffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, usedState));
+	}
+}
+
+UINT64 GeometryArenaClass::Upload(
+	ComPtr<ID3D12Device> device,
+	UploadBatchClass& uploadBatch) {
+
+	++m_lastUploadId;
+
+	const UINT vertexStride = VertexPacking::GetStride(m_vertexFormat);
+
+	UploadPool(m_vertices, device.Get(), uploadBatch, vertexStride, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, L"GeometryArena Vertices");
+	UploadPool(m_indices16, device.Get(), uploadBatch, sizeof(UINT16), D3D12_RESOURCE_STATE_INDEX_BUFFER, L"GeometryArena Indices16");
+	UploadPool(m_indices32, device.Get(), uploadBatch, sizeof(UINT32), D3D12_RESOURCE_STATE_INDEX_BUFFER, L"GeometryArena Indices32");
+
+	Publication publication{ m_lastUploadId, {}, {}, {} };
+
+	if (m_vertices.buffer) {
+		publication.vertexBinding.address = m_vertices.buffer->GetGPUVirtualAddress();
+		publication.vertexBinding.strideInBytes = vertexStride;
+		publication.vertexBinding.sizeInBytes = vertexStride * m_vertices.bufferCapacity;
+	}
+
+	publication.indexBinding16 = GetIndexBinding(m_indices16, DXGI_FORMAT_R16_UINT);
+	publication.indexBinding32 = GetIndexBinding(m_indices32, DXGI_FORMAT_R32_UINT);
+
+	m_publications.push_back(publication);
+	return m_lastUploadId;
+}
+
+void GeometryArenaClass::Publish(UINT64 uploadId, DeferredReleaseQueue& releaseQueue) {
+	while (!m_publications.empty() && m_publications.front().uploadId <= uploadId) {
+		m_vertexBinding = m_publications.front().vertexBinding;
+		m_indexBinding16 = m_publications.front().indexBinding16;
+		m_indexBinding32 = m_publications.front().indexBinding32;
+		m_publications.pop_front();
+	}
+
+	// A pool replaced during upload n was drawn from up to publication n
+	auto replaced = m_replacedBuffers.begin();
+	for (; replaced != m_replacedBuffers.end() && replaced->uploadId <= uploadId; ++replaced) {
+		releaseQueue.Enqueue(std::move(replaced->buffer));
+	}
+	m_replacedBuffers.erase(m_replacedBuffers.begin(), replaced);
+}
+
+void GeometryArenaClass::Bind(RenderBackend& backend) const {
+	backend.IASetVertexBuffer(m_vertexBinding);
+}
+
+void GeometryArenaClass::BindIndices(RenderBackend& backend, DXGI_FORMAT format) const {
+	backend.IASetIndexBuffer(format == DXGI_FORMAT_R16_UINT ? m_indexBinding16 : m_indexBinding32);
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <deque>
+#include <map>
+
+#include "GeometryClass.h"
+#include "RenderBackend.h"
+#include "UploadBatchClass.h"
+#include "VertexPacking.h"
+
+// First fit allocator over a range of [0, capacity) elements. Only does the bookkeeping,
+// the memory itself is owned by the user. Freed ranges are merged with their neighbours.
+class RangeAllocator
+{
+public:
+	static constexpr UINT InvalidOffset = UINT_MAX;
+
+	RangeAllocator() = default;
+
+	// Returns InvalidOffset when no free range is large enough
+	UINT Allocate(UINT count);
+	void Free(UINT offset, UINT count);
+
+	// Appends [capacity, newCapacity) as free space
+	void Grow(UINT newCapacity);
+
+	UINT GetCapacity() const { return m_capacity; }
+	UINT GetUsed() const { return m_used; }
+
+private:
+	std::map<UINT, UINT> m_freeRanges;	// Offset to count
+	UINT m_capacity{ 0 };
+	UINT m_used{ 0 };
+};
+
+// One vertex pool and two index pools shared by every mesh in the scene. Meshes own a range of
+// the vertex pool and of one index pool, drawn through the base vertex and first index of
+// DrawIndexedInstanced, so the vertices are bound once per pass and the indices whenever the
+// index format changes. Indices are relative to the base vertex, so meshes with fewer than
+// 65536 vertices go to the 16-bit pool and the rest to the 32-bit one.
+// Allocations only remember where their data is, Upload copies it straight from there into
+// upload memory. The arena keeps no CPU copy of the pools. Vertices are converted to the vertex
+// format of the arena and indices narrowed to the format of their pool while they are staged.
+class GeometryArenaClass
+{
+public:
+	struct Range {
+		UINT offset{ 0 };
+		UINT count{ 0 };
+	};
+
+	// Indices of a range are all in the same pool
+	struct IndexRange : Range {
+		DXGI_FORMAT format{ DXGI_FORMAT_R16_UINT };
+	};
+
+	explicit GeometryArenaClass(VertexFormat vertexFormat = VertexFormat::Full) :
+		m_vertexFormat{ vertexFormat } {}
+
+	// Ranges are in elements, the pools grow when they are full. The elements are read by the next
+	// Upload, owner keeps them alive until then and may be empty when they outlive it anyway.
+	Range AllocateVertices(const GeometryClass::Vertex* vertices, UINT count, std::shared_ptr<const void> owner);
+	// vertexCount is the number of vertices the indices refer to, it selects the index pool
+	IndexRange AllocateIndices(const UINT32* indices, UINT count, UINT vertexCount, std::shared_ptr<const void> owner);
+	void FreeVertices(const Range& range);
+	void FreeIndices(const IndexRange& range);
+
+	// The smallest index format that can address vertexCount vertices
+	static DXGI_FORMAT SelectIndexFormat(UINT vertexCount) {
+		return vertexCount < (1u << 16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	}
+
+	// Stages everything allocated since the last upload in uploadBatch. A pool that became too small
+	// is recreated and receives the contents of the old one through a GPU copy, so every upload has
+	// to execute after the one before it, on the same queue or once that one has completed.
+	// Returns the id to publish the upload with.
+	UINT64 Upload(
+		Microsoft::WRL::ComPtr<ID3D12Device> device,
+		UploadBatchClass& uploadBatch);
+
+	// Makes the pools written by upload uploadId the ones Bind binds. Call once its copies have
+	// executed, or right away when they are recorded on the list that draws. Pools replaced by
+	// that upload or an earlier one are handed to releaseQueue.
+	void Publish(UINT64 uploadId, DeferredReleaseQueue& releaseQueue);
+
+	// Uploads that were staged but not published yet
+	size_t GetUnpublishedCount() const { return m_publications.size(); }
+
+	// Binds the vertex pool
+	void Bind(RenderBackend& backend) const;
+
+	// Binds the index pool of the format, ranges of that format can be drawn afterwards
+	void BindIndices(RenderBackend& backend, DXGI_FORMAT format) const;
+
+	VertexFormat GetVertexFormat() const { return m_vertexFormat; }
+	UINT GetVertexCount() const { return m_vertices.allocator.GetUsed(); }
+	UINT GetIndexCount() const { return m_indices16.allocator.GetUsed() + m_indices32.allocator.GetUsed(); }
+
+	// Bytes of the allocated vertices and indices in their GPU layout
+	UINT64 GetVertexBytes() const;
+	UINT64 GetIndexBytes() const;
+
+	// Delete functions
+	GeometryArenaClass(GeometryArenaClass const& rhs) = delete;
+	GeometryArenaClass& operator=(GeometryArenaClass const& rhs) = delete;
+
+	GeometryArenaClass(GeometryArenaClass&& rhs) = delete;
+	GeometryArenaClass& operator=(GeometryArenaClass&& rhs) = delete;
+
+private:
+	// Elements allocated since the last upload, still in the memory of their owner
+	template<typename T>
+	struct PendingWrite {
+		UINT offset;
+		UINT count;
+		const T* elements;
+		std::shared_ptr<const void> owner;
+	};
+
+	template<typename T>
+	struct Pool {
+		RangeAllocator allocator;
+		std::vector<PendingWrite<T>> pendingWrites;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+		UINT bufferCapacity{ 0 };
+	};
+
+	struct Publication {
+		UINT64 uploadId;
+		VertexBufferBinding vertexBinding;
+		IndexBufferBinding indexBinding16;
+		IndexBufferBinding indexBinding32;
+	};
+
+	struct ReplacedBuffer {
+		UINT64 uploadId;
+		Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+	};
+
+	template<typename T>
+	static Range Allocate(Pool<T>& pool, const T* elements, UINT count, std::shared_ptr<const void> owner, UINT initialCapacity);
+
+	// Stages the pending writes of the pool, recreating the GPU buffer when it is too small.
+	// Stride is the size of an element in the GPU buffer.
+	template<typename T>
+	void UploadPool(
+		Pool<T>& pool,
+		ID3D12Device* device,
+		UploadBatchClass& uploadBatch,
+		UINT stride,
+		D3D12_RESOURCE_STATES usedState,
+		const wchar_t* name);
+
+	// Writes elements to staging memory in their GPU layout, stride bytes each
+	void StageElements(const GeometryClass::Vertex* vertices, UINT count, UINT stride, void* dst) const;
+	void StageElements(const UINT32* indices, UINT count, UINT stride, void* dst) const;
+
+	template<typename T>
+	static IndexBufferBinding GetIndexBinding(const Pool<T>& pool, DXGI_FORMAT format);
+
+	Pool<UINT32>& GetIndexPool(DXGI_FORMAT format) {
+		return format == DXGI_FORMAT_R16_UINT ? m_indices16 : m_indices32;
+	}
+
+	static constexpr UINT InitialVertexCapacity = 1 << 16;
+	static constexpr UINT InitialIndexCapacity = 1 << 18;
+
+	const VertexFormat m_vertexFormat;
+	Pool<GeometryClass::Vertex> m_vertices;
+	Pool<UINT32> m_indices16;	// Staged as UINT16
+	Pool<UINT32> m_indices32;
+
+	VertexBufferBinding m_vertexBinding{};
+	IndexBufferBinding m_indexBinding16{};
+	IndexBufferBinding m_indexBinding32{};
+
+	// Uploads not published yet, and pools still bound until the upload replacing them is published
+	UINT64 m_lastUploadId{ 0 };
+	std::deque<Publication> m_publications;
+	std::vector<ReplacedBuffer> m_replacedBuffers;
+};
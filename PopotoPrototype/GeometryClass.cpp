@@ -1,217 +1,467 @@
 #include "stdafx.h"
 #include "GeometryClass.h"
+#include "ThreadPoolClass.h"
+#include "GeometryTables.h"
+
+#include <atomic>
+#include <sstream>
 
 using namespace Math;
 
+static_assert(sizeof(GeometryTables::VertexData) == sizeof(GeometryClass::Vertex) &&
+	offsetof(GeometryTables::VertexData, normal) == offsetof(GeometryClass::Vertex, m_normal) &&
+	offsetof(GeometryTables::VertexData, tangent) == offsetof(GeometryClass::Vertex, m_tangent) &&
+	offsetof(GeometryTables::VertexData, uv) == offsetof(GeometryClass::Vertex, m_uv) &&
+	std::is_trivially_copyable_v<GeometryClass::Vertex>,
+	"GeometryTables are copied into meshes as they are");
+
+namespace {
+	template<size_t VertexCount, size_t IndexCount>
+	GeometryClass::Mesh FromTable(const GeometryTables::MeshTable<VertexCount, IndexCount>& table) {
+		GeometryClass::Mesh mesh{};
+		mesh.m_vertices.resize(VertexCount);
+		mesh.m_indices.resize(IndexCount);
+		std::memcpy(mesh.m_vertices.data(), table.vertices.data(), sizeof(table.vertices));
+		std::memcpy(mesh.m_indices.data(), table.indices.data(), sizeof(table.indices));
+		return mesh;
+	}
+
+	constexpr UINT64 EmptyEdge = UINT64_MAX;
+
+	// Items per ParallelFor item, large enough that handing them out costs nothing next to the work
+	constexpr UINT32 SubdivideChunkSize = 16384;
+
+	// Smallest bits with 1 << bits >= value
+	UINT CeilLog2(UINT64 value) {
+		UINT bits = 0;
+		while ((1ULL << bits) < value) ++bits;
+		return bits;
+	}
+
+	// Edges start probing at a block of slots reserved for their lower vertex. Triangles close in the index
+	// buffer use vertices close in the vertex buffer, so the probes of neighbouring triangles stay in cache.
+	size_t HashEdge(UINT32 a, UINT32 b, UINT slotsPerVertexBits) {
+		return (static_cast<size_t>(a) << slotsPerVertexBits) + (b & ((1U << slotsPerVertexBits) - 1U));
+	}
+
+	// Calls body(first, last) over [0, count) in chunks, on the pool when there is one and more than one chunk
+	template<typename BodyT>
+	void ForEachChunk(ThreadPoolClass* threadPool, UINT32 count, const BodyT& body) {
+		const UINT32 chunkCount = (count + SubdivideChunkSize - 1) / SubdivideChunkSize;
+		if (!threadPool || chunkCount < 2) {
+			body(0, count);
+			return;
+		}
+
+		threadPool->ParallelFor(chunkCount, [&](UINT chunk) {
+			const UINT32 first = chunk * SubdivideChunkSize;
+			body(first, std::min(first + SubdivideChunkSize, count));
+		});
+	}
+}
+
 GeometryClass::Mesh GeometryClass::CreateBox(
 	const float width,
 	const float height,
 	const float depth,
-	const UINT numSubdivisions) {
+	const UINT numSubdivisions,
+	ThreadPoolClass* threadPool) {
 
-	Mesh meshData{};
+	Mesh meshData = FromTable(GeometryTables::Box);
 
-	{ // Generate Vertices
-		std::array<Vertex, 24> v;
-		const float w2 = 0.5f * width;
-		const float h2 = 0.5f * height;
-		const float d2 = 0.5f * depth;
-
-		// Front face
-		v[0] = Vertex{ { -w2, -h2, -d2 },{ 0.0f, 0.0f, -1.0f },{ 1.0f, 0.0f, 0.0f},{ 0.0f, 1.0f } };
-		v[1] = Vertex{ { -w2, +h2, -d2 },{ 0.0f, 0.0f, -1.0f },{ 1.0f, 0.0f, 0.0f},{ 0.0f, 0.0f } };
-		v[2] = Vertex{ { +w2, +h2, -d2 },{ 0.0f, 0.0f, -1.0f },{ 1.0f, 0.0f, 0.0f},{ 1.0f, 0.0f } };
-		v[3] = Vertex{ { +w2, -h2, -d2 },{ 0.0f, 0.0f, -1.0f },{ 1.0f, 0.0f, 0.0f},{ 1.0f, 1.0f } };
-
-		// Back face										   					 
-		v[4] = Vertex{ { -w2, -h2, +d2 },{ 0.0f, 0.0f, 1.0f }, {-1.0f, 0.0f, 0.0f},{ 1.0f, 1.0f } };
-		v[5] = Vertex{ { +w2, -h2, +d2 },{ 0.0f, 0.0f, 1.0f }, {-1.0f, 0.0f, 0.0f},{ 0.0f, 1.0f } };
-		v[6] = Vertex{ { +w2, +h2, +d2 },{ 0.0f, 0.0f, 1.0f }, {-1.0f, 0.0f, 0.0f},{ 0.0f, 0.0f } };
-		v[7] = Vertex{ { -w2, +h2, +d2 },{ 0.0f, 0.0f, 1.0f }, {-1.0f, 0.0f, 0.0f},{ 1.0f, 0.0f } };
-
-		// Top face											   					 
-		v[8] = Vertex{ { -w2, +h2, -d2 },{ 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f},{ 0.0f, 1.0f } };
-		v[9] = Vertex{ { -w2, +h2, +d2 },{ 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f},{ 0.0f, 0.0f } };
-		v[10] = Vertex{ { +w2, +h2, +d2 },{ 0.0f, 1.0f, 0.0f },{ 1.0f, 0.0f, 0.0f},{ 1.0f, 0.0f } };
-		v[11] = Vertex{ { +w2, +h2, -d2 },{ 0.0f, 1.0f, 0.0f },{ 1.0f, 0.0f, 0.0f},{ 1.0f, 1.0f } };
-
-		// Bottom face
-		v[12] = Vertex{ { -w2, -h2, -d2 },{ 0.0f, -1.0f, 0.0f },{-1.0f, 0.0f, 0.0f,}, { 1.0f, 1.0f } };
-		v[13] = Vertex{ { +w2, -h2, -d2 },{ 0.0f, -1.0f, 0.0f },{-1.0f, 0.0f, 0.0f,}, { 0.0f, 1.0f } };
-		v[14] = Vertex{ { +w2, -h2, +d2 },{ 0.0f, -1.0f, 0.0f },{-1.0f, 0.0f, 0.0f,}, { 0.0f, 0.0f } };
-		v[15] = Vertex{ { -w2, -h2, +d2 },{ 0.0f, -1.0f, 0.0f },{-1.0f, 0.0f, 0.0f,}, { 1.0f, 0.0f } };
-
-		// Left face											
-		v[16] = Vertex{ { -w2, -h2, +d2 },{ -1.0f, 0.0f, 0.0f },{0.0f, 0.0f, -1.0f,}, { 0.0f, 1.0f } };
-		v[17] = Vertex{ { -w2, +h2, +d2 },{ -1.0f, 0.0f, 0.0f },{0.0f, 0.0f, -1.0f,}, { 0.0f, 0.0f } };
-		v[18] = Vertex{ { -w2, +h2, -d2 },{ -1.0f, 0.0f, 0.0f },{0.0f, 0.0f, -1.0f,}, { 1.0f, 0.0f } };
-		v[19] = Vertex{ { -w2, -h2, -d2 },{ -1.0f, 0.0f, 0.0f },{0.0f, 0.0f, -1.0f,}, { 1.0f, 1.0f } };
-
-		// Right face											 
-		v[20] = Vertex{ { +w2, -h2, -d2 },{ 1.0f, 0.0f, 0.0f }, {0.0f, 0.0f, 1.0f, }, { 0.0f, 1.0f } };
-		v[21] = Vertex{ { +w2, +h2, -d2 },{ 1.0f, 0.0f, 0.0f }, {0.0f, 0.0f, 1.0f, }, { 0.0f, 0.0f } };
-		v[22] = Vertex{ { +w2, +h2, +d2 },{ 1.0f, 0.0f, 0.0f }, {0.0f, 0.0f, 1.0f, }, { 1.0f, 0.0f } };
-		v[23] = Vertex{ { +w2, -h2, +d2 },{ 1.0f, 0.0f, 0.0f }, {0.0f, 0.0f, 1.0f, }, { 1.0f, 1.0f } };
-
-		for (auto& vert : v) {
-			vert.m_uv.x = (vert.m_uv.x == 0.0f) ? 1.0f : 0.0f;
+	const Vector3 scale{ width, height, depth };
+	for (auto& vertex : meshData.m_vertices) {
+		vertex.m_position = vertex.m_position * scale;
+	}
+
+	// The faces do not share vertices, so their edges stay sharp
+	Subdivide(meshData, numSubdivisions, threadPool);
+
+	return meshData;
+}
+
+GeometryClass::Mesh GeometryClass::CreateSphere(
+	const float radius, 
+	const UINT numSubdivisions,
+	ThreadPoolClass* threadPool) {
+
+	// The low levels are subdivided by the compiler
+	Mesh meshData = [numSubdivisions] {
+		switch (numSubdivisions) {
+		case 0: return FromTable(GeometryTables::Icosahedron);
+		case 1: return FromTable(GeometryTables::Icosphere1);
+		case 2: return FromTable(GeometryTables::Icosphere2);
+		default: return FromTable(GeometryTables::Icosphere3);
 		}
+	}();
 
-		meshData.m_vertices.assign(v.begin(), v.end());
+	if (numSubdivisions > GeometryTables::MaxIcosphereLevel) {
+		Subdivide(meshData, numSubdivisions - GeometryTables::MaxIcosphereLevel, threadPool);
 	}
 
-	{// Generate Indices
-		std::array<UINT32, 36> k;
+	auto* vertices = meshData.m_vertices.data();
+	ForEachChunk(threadPool, static_cast<UINT32>(meshData.m_vertices.size()), [&](UINT32 first, UINT32 last) {
+		for (UINT32 i = first; i < last; ++i) {
+			auto& vertex = vertices[i];
+
+			vertex.m_normal = Normalize(vertex.m_position);
+			vertex.m_position = vertex.m_normal * radius;
 
-		// Front face
-		k[0] = 0; k[1] = 1; k[2] = 2;
-		k[3] = 0; k[4] = 2; k[5] = 3;
+			auto theta = atan2f(vertex.m_position.GetZ(), vertex.m_position.GetX());
+			theta = theta < 0.0f ? theta + XM_2PI : theta;
 
-		// Back face
-		k[6] = 4; k[7] = 5; k[8] = 6;
-		k[9] = 4; k[10] = 6; k[11] = 7;
+			float phi = acosf(vertex.m_position.GetY() / radius);
+			vertex.m_uv.x = 1.0f - (theta / XM_2PI);
+			vertex.m_uv.y = phi / XM_PI;
 
-		// Top face
-		k[12] = 8; k[13] = 9; k[14] = 10;
-		k[15] = 8; k[16] = 10; k[17] = 11;
+			vertex.m_tangent = {
+				-radius*sinf(phi)*sinf(theta),
+				0.0f,
+				+radius*sinf(phi)*cosf(theta)};
+			vertex.m_tangent = Math::Normalize(vertex.m_tangent);
+		}
+	});
 
-		// Bottom face
-		k[18] = 12; k[19] = 13; k[20] = 14;
-		k[21] = 12; k[22] = 14; k[23] = 15;
+	return meshData;
+}
 
-		// Left face
-		k[24] = 16; k[25] = 17; k[26] = 18;
-		k[27] = 16; k[28] = 18; k[29] = 19;
+GeometryClass::Mesh GeometryClass::CreateCylinder(
+	const float radius,
+	const float height,
+	const UINT numSubdivisions) {
 
-		// Right face
-		k[30] = 20; k[31] = 21; k[32] = 22;
-		k[33] = 20; k[34] = 22; k[35] = 23;
+	const UINT slices = 8u << numSubdivisions;
+	const UINT stacks = 1u << numSubdivisions;
+	const float h2 = 0.5f * height;
 
-		// Convert to left-handed
-		for (auto i = 0; i < k.size(); i += 3) {
-			auto rest = k[i + 1];
-			k[i + 1] = k[i + 2];
-			k[i + 2] = rest;
+	Mesh meshData{};
+	meshData.m_vertices.reserve((stacks + 1) * (slices + 1) + 2 * (slices + 2));
+	meshData.m_indices.reserve(6 * stacks * slices + 6 * slices);
+
+	// Side, bottom to top. The seam column is doubled so u can run from 1 to 0.
+	for (UINT i = 0; i <= stacks; ++i) {
+		const float y = -h2 + height * i / stacks;
+
+		for (UINT j = 0; j <= slices; ++j) {
+			const float theta = XM_2PI * j / slices;
+			const Vector3 normal{ cosf(theta), 0.0f, sinf(theta) };
+
+			meshData.m_vertices.push_back(Vertex{
+				Vector3(radius * cosf(theta), y, radius * sinf(theta)),
+				normal,
+				{ -sinf(theta), 0.0f, cosf(theta) },
+				{ 1.0f - static_cast<float>(j) / slices, 1.0f - static_cast<float>(i) / stacks } });
 		}
-
-		meshData.m_indices.assign(k.begin(), k.end());
 	}
+	AppendGridIndices(meshData.m_indices, 0, stacks, slices);
+
+	// Caps, a fan around a center vertex each
+	for (const float side : { -1.0f, 1.0f }) {
+		const UINT32 center = static_cast<UINT32>(meshData.m_vertices.size());
+		meshData.m_vertices.push_back(Vertex{ { 0.0f, side * h2, 0.0f }, { 0.0f, side, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.5f, 0.5f } });
+
+		for (UINT j = 0; j <= slices; ++j) {
+			const float theta = XM_2PI * j / slices;
+			meshData.m_vertices.push_back(Vertex{
+				Vector3(radius * cosf(theta), side * h2, radius * sinf(theta)),
+				{ 0.0f, side, 0.0f },
+				{ 1.0f, 0.0f, 0.0f },
+				{ 0.5f + 0.5f * cosf(theta), 0.5f - 0.5f * side * sinf(theta) } });
+		}
 
-	for (auto i = 0u; i < (numSubdivisions < 6u ? numSubdivisions : 6u); ++i) {
-		Subdivide(meshData);
+		for (UINT32 j = 0; j < slices; ++j) {
+			const UINT32 ring = center + 1 + j;
+			if (side > 0.0f) {
+				meshData.m_indices.insert(meshData.m_indices.end(), { center, ring, ring + 1 });
+			}
+			else {
+				meshData.m_indices.insert(meshData.m_indices.end(), { center, ring + 1, ring });
+			}
+		}
 	}
 
 	return meshData;
 }
 
-GeometryClass::Mesh GeometryClass::CreateSphere(
-	const float radius, 
+GeometryClass::Mesh GeometryClass::CreateGrid(
+	const float width,
+	const float depth,
 	const UINT numSubdivisions) {
 
-	Mesh meshData{};
+	const UINT cells = 1u << numSubdivisions;
+	const float w2 = 0.5f * width;
+	const float d2 = 0.5f * depth;
 
-	const auto X = 0.525731f;
-	const auto Z = 0.850651f;
+	Mesh meshData{};
+	meshData.m_vertices.reserve((cells + 1) * (cells + 1));
+	meshData.m_indices.reserve(6 * cells * cells);
+
+	// Rows along +Z, columns along +X
+	for (UINT i = 0; i <= cells; ++i) {
+		const float v = static_cast<float>(i) / cells;
+
+		for (UINT j = 0; j <= cells; ++j) {
+			const float u = static_cast<float>(j) / cells;
+			meshData.m_vertices.push_back(Vertex{
+				Vector3(-w2 + width * u, 0.0f, -d2 + depth * v),
+				{ 0.0f, 1.0f, 0.0f },
+				{ 1.0f, 0.0f, 0.0f },
+				{ u, 1.0f - v } });
+		}
+	}
+	AppendGridIndices(meshData.m_indices, 0, cells, cells);
 
-	std::array<Vector3, 12> pos{
-		Vector3{ -X, 0.0f, Z }, Vector3{ X, 0.0f, Z },
-		Vector3{ -X, 0.0f, -Z }, Vector3{ X, 0.0f, -Z },
-		Vector3{ 0.0f, Z, X }, Vector3{ 0.0f, Z, -X },
-		Vector3{ 0.0f, -Z, X }, Vector3{ 0.0f, -Z, -X },
-		Vector3{ Z, X, 0.0f }, Vector3{ -Z, X, 0.0f },
-		Vector3{ Z, -X, 0.0f }, Vector3{ -Z, -X, 0.0f }
-	};
+	return meshData;
+}
 
-	std::array<Vertex, pos.size()> verts;
-	for (auto i = 0; i < pos.size(); ++i) {
-		verts[i] = Vertex{ pos[i], {}, {}, {} };
-	}
+GeometryClass::Mesh GeometryClass::CreateTorus(
+	const float majorRadius,
+	const float minorRadius,
+	const UINT numSubdivisions) {
 
-	std::array<UINT32, 60> k{
-		1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
-		1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
-		3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
-		10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
-	};
+	const UINT majorSegments = 16u << numSubdivisions;
+	const UINT minorSegments = 8u << numSubdivisions;
 
-	// Convert to left-handed
-	for (auto i = 0; i < k.size(); i += 3) {
-		auto rest = k[i + 1];
-		k[i + 1] = k[i + 2];
-		k[i + 2] = rest;
+	Mesh meshData{};
+	meshData.m_vertices.reserve((majorSegments + 1) * (minorSegments + 1));
+	meshData.m_indices.reserve(6 * majorSegments * minorSegments);
+
+	// Rows around the tube, columns around the Y axis, both seams doubled
+	for (UINT i = 0; i <= minorSegments; ++i) {
+		const float psi = XM_2PI * i / minorSegments;
+
+		for (UINT j = 0; j <= majorSegments; ++j) {
+			const float phi = XM_2PI * j / majorSegments;
+			const Vector3 normal{ cosf(psi) * cosf(phi), sinf(psi), cosf(psi) * sinf(phi) };
+
+			meshData.m_vertices.push_back(Vertex{
+				Vector3(majorRadius * cosf(phi), 0.0f, majorRadius * sinf(phi)) + minorRadius * normal,
+				normal,
+				{ -sinf(phi), 0.0f, cosf(phi) },
+				{ 1.0f - static_cast<float>(j) / majorSegments, static_cast<float>(i) / minorSegments } });
+		}
 	}
+	AppendGridIndices(meshData.m_indices, 0, minorSegments, majorSegments);
 
-	meshData.m_vertices.assign(verts.begin(), verts.end());
-	meshData.m_indices.assign(k.begin(), k.end());
+	return meshData;
+}
 
+GeometryClass::Mesh GeometryClass::CreateCapsule(
+	const float radius,
+	const float height,
+	const UINT numSubdivisions) {
 
-	for (auto i = 0u; i < (numSubdivisions < 6u ? numSubdivisions : 6u); ++i) {
-		Subdivide(meshData);
+	const UINT slices = 8u << numSubdivisions;
+	const UINT hemisphereRings = 2u << numSubdivisions;
+	const UINT stacks = 1u << numSubdivisions;
+	const float h2 = 0.5f * height;
+
+	// Rings from the bottom pole to the top one: latitude and the height of the half sphere's center
+	std::vector<std::pair<float, float>> rings;
+	rings.reserve(2 * (hemisphereRings + 1) + stacks - 1);
+	for (UINT k = 0; k <= hemisphereRings; ++k) {
+		rings.emplace_back(-XM_PIDIV2 + XM_PIDIV2 * k / hemisphereRings, -h2);
+	}
+	for (UINT k = 1; k < stacks; ++k) {
+		rings.emplace_back(0.0f, -h2 + height * k / stacks);
+	}
+	for (UINT k = 0; k <= hemisphereRings; ++k) {
+		rings.emplace_back(XM_PIDIV2 * k / hemisphereRings, h2);
 	}
 
-	for (size_t i = 0; i < meshData.m_vertices.size(); ++i) {
-		auto& vertex = meshData.m_vertices[i];
+	const UINT rows = static_cast<UINT>(rings.size()) - 1;
 
-		vertex.m_normal = Normalize(vertex.m_position);
-		vertex.m_position = vertex.m_normal * radius;
+	Mesh meshData{};
+	meshData.m_vertices.reserve(rings.size() * (slices + 1));
+	meshData.m_indices.reserve(6 * rows * slices);
 
-		auto theta = atan2f(vertex.m_position.GetZ(), vertex.m_position.GetX());
-		theta = theta < 0.0f ? theta + XM_2PI : theta;
+	for (UINT i = 0; i <= rows; ++i) {
+		const auto [latitude, centerY] = rings[i];
 
-		float phi = acosf(vertex.m_position.GetY() / radius);
-		vertex.m_uv.x = 1.0f - (theta / XM_2PI);
-		vertex.m_uv.y = phi / XM_PI;
+		for (UINT j = 0; j <= slices; ++j) {
+			const float theta = XM_2PI * j / slices;
+			const Vector3 normal{ cosf(latitude) * cosf(theta), sinf(latitude), cosf(latitude) * sinf(theta) };
 
-		vertex.m_tangent = {
-			-radius*sinf(phi)*sinf(theta),
-			0.0f,
-			+radius*sinf(phi)*cosf(theta)};
-		vertex.m_tangent = Math::Normalize(vertex.m_tangent);
+			meshData.m_vertices.push_back(Vertex{
+				Vector3(0.0f, centerY, 0.0f) + radius * normal,
+				normal,
+				{ -sinf(theta), 0.0f, cosf(theta) },
+				{ 1.0f - static_cast<float>(j) / slices, 1.0f - static_cast<float>(i) / rows } });
+		}
 	}
+	AppendGridIndices(meshData.m_indices, 0, rows, slices, true, true);
 
 	return meshData;
 }
 
-void GeometryClass::Subdivide(Mesh& meshData) {
-	const auto copy = meshData;
-
-	meshData.m_vertices.resize(0);
-	meshData.m_indices.resize(0);
-
-	const UINT32 numTris = static_cast<UINT32>(copy.m_indices.size() / 3);
-
-	for (UINT32 i = 0; i < numTris; ++i) {
-		Vertex v0 = copy.m_vertices[copy.m_indices[i * 3 + 0]];
-		Vertex v1 = copy.m_vertices[copy.m_indices[i * 3 + 1]];
-		Vertex v2 = copy.m_vertices[copy.m_indices[i * 3 + 2]];
-
-		Vertex m0 = MidPoint(v0, v1);
-		Vertex m1 = MidPoint(v1, v2);
-		Vertex m2 = MidPoint(v0, v2);
-
-		meshData.m_vertices.push_back(v0);
-		meshData.m_vertices.push_back(v1);
-		meshData.m_vertices.push_back(v2);
-		meshData.m_vertices.push_back(m0);
-		meshData.m_vertices.push_back(m1);
-		meshData.m_vertices.push_back(m2);
-
-		const UINT32 i6 = i * 6ui32;
-		meshData.m_indices.push_back(i6 + 0ui32);
-		meshData.m_indices.push_back(i6 + 3ui32);
-		meshData.m_indices.push_back(i6 + 5ui32);
-
-		meshData.m_indices.push_back(i6 + 3ui32);
-		meshData.m_indices.push_back(i6 + 4ui32);
-		meshData.m_indices.push_back(i6 + 5ui32);
-										   
-		meshData.m_indices.push_back(i6 + 5ui32);
-		meshData.m_indices.push_back(i6 + 4ui32);
-		meshData.m_indices.push_back(i6 + 2ui32);
-										   
-		meshData.m_indices.push_back(i6 + 3ui32);
-		meshData.m_indices.push_back(i6 + 1ui32);
-		meshData.m_indices.push_back(i6 + 4ui32);
+void GeometryClass::AppendGridIndices(
+	std::vector<UINT32>& indices,
+	UINT32 firstVertex,
+	UINT rows, UINT columns,
+	bool collapsedFirstRow,
+	bool collapsedLastRow) {
+
+	const UINT32 stride = columns + 1;
+
+	for (UINT32 i = 0; i < rows; ++i) {
+		for (UINT32 j = 0; j < columns; ++j) {
+			const UINT32 v00 = firstVertex + i * stride + j;
+			const UINT32 v01 = v00 + 1;
+			const UINT32 v10 = v00 + stride;
+			const UINT32 v11 = v10 + 1;
+
+			if (!(collapsedFirstRow && i == 0)) {
+				indices.insert(indices.end(), { v00, v01, v10 });
+			}
+			if (!(collapsedLastRow && i == rows - 1)) {
+				indices.insert(indices.end(), { v01, v11, v10 });
+			}
+		}
+	}
+}
+
+void GeometryClass::Subdivide(Mesh& meshData, UINT numSubdivisions, ThreadPoolClass* threadPool) {
+	// Levels past the one whose indices or vertices would no longer fit 32 bits are skipped
+	UINT levels = 0;
+	for (UINT64 triangles = meshData.m_indices.size() / 3, vertices = meshData.m_vertices.size();
+		levels < numSubdivisions && triangles * 12 <= UINT_MAX && vertices + triangles * 3 <= UINT_MAX;
+		++levels, vertices += triangles * 3, triangles *= 4) {}
+
+	if (levels < numSubdivisions) {
+		std::wstringstream t_SStream;
+		t_SStream << "Subdivide: stopped after " << levels << " of " << numSubdivisions << " levels, the next would overflow 32-bit indices" << std::endl;
+		OutputDebugString(t_SStream.str().c_str());
+	}
+	if (levels == 0) return;
+
+	// Sized for the last level, the earlier ones reuse them
+	const size_t maxTriangles = (meshData.m_indices.size() / 3) << (2 * (levels - 1));
+	// Every triangle adds at most three edges, so the table is at most three quarters full. Closed meshes
+	// have half as many edges and fill less than two fifths of it.
+	const size_t tableSize = size_t{ 1 } << CeilLog2(maxTriangles * 4);
+	std::vector<std::atomic<UINT64>> edgeKeys(tableSize);
+	std::vector<std::atomic<UINT32>> edgeFirstUses(tableSize);
+	std::vector<UINT32> edgeMidpoints(tableSize);
+	// The table slot of the edge starting at every index, until the edges are numbered
+	std::vector<UINT32> edgeSlots(maxTriangles * 3);
+	std::vector<UINT32> chunkEdgeOffsets((maxTriangles * 3 + SubdivideChunkSize - 1) / SubdivideChunkSize);
+
+	// The levels write their indices to the two vectors in turn, the one the last level writes to is sized for
+	// it and the other for the level before
+	std::vector<UINT32> indices;
+	const size_t finalIndexCount = meshData.m_indices.size() << (2 * levels);
+	(levels % 2 == 1 ? indices : meshData.m_indices).reserve(finalIndexCount);
+	(levels % 2 == 1 ? meshData.m_indices : indices).reserve(finalIndexCount / 4);
+
+	for (UINT level = 0; level < levels; ++level) {
+		const UINT32 vertexCount = static_cast<UINT32>(meshData.m_vertices.size());
+		const UINT32 triangleCount = static_cast<UINT32>(meshData.m_indices.size() / 3);
+		const UINT32 halfEdgeCount = triangleCount * 3;
+		const auto* oldIndices = meshData.m_indices.data();
+
+		// A midpoint per undirected edge, numbered in order of first use so the result does not depend on the threads.
+		// The chunks find the slots of their edges and keep the first index using each, then every chunk numbers
+		// the edges it uses first after those of the chunks before it.
+		const UINT tableBits = CeilLog2(static_cast<UINT64>(triangleCount) * 4);
+		const size_t tableMask = (size_t{ 1 } << tableBits) - 1;
+		const UINT vertexBits = CeilLog2(vertexCount);
+		const UINT slotsPerVertexBits = tableBits > vertexBits ? tableBits - vertexBits : 0;
+
+		ForEachChunk(threadPool, static_cast<UINT32>(tableMask + 1), [&](UINT32 first, UINT32 last) {
+			for (UINT32 slot = first; slot < last; ++slot) {
+				edgeKeys[slot].store(EmptyEdge, std::memory_order_relaxed);
+				edgeFirstUses[slot].store(UINT_MAX, std::memory_order_relaxed);
+			}
+		});
+
+		ForEachChunk(threadPool, halfEdgeCount, [&](UINT32 first, UINT32 last) {
+			for (UINT32 i = first; i < last; ++i) {
+				const UINT32 a = oldIndices[i];
+				const UINT32 b = oldIndices[i % 3 == 2 ? i - 2 : i + 1];
+				const UINT32 low = std::min(a, b);
+				const UINT32 high = std::max(a, b);
+				const UINT64 key = (static_cast<UINT64>(low) << 32) | high;
+
+				// Claims the first empty slot unless another chunk claims it first, the key it stored is compared next
+				size_t slot = HashEdge(low, high, slotsPerVertexBits) & tableMask;
+				for (UINT64 current = edgeKeys[slot].load(std::memory_order_relaxed); current != key;) {
+					if (current == EmptyEdge && edgeKeys[slot].compare_exchange_strong(current, key, std::memory_order_relaxed)) {
+						break;
+					}
+					if (current != key) {
+						slot = (slot + 1) & tableMask;
+						current = edgeKeys[slot].load(std::memory_order_relaxed);
+					}
+				}
+
+				auto& firstUse = edgeFirstUses[slot];
+				for (UINT32 current = firstUse.load(std::memory_order_relaxed);
+					i < current && !firstUse.compare_exchange_weak(current, i, std::memory_order_relaxed);) {}
+				edgeSlots[i] = static_cast<UINT32>(slot);
+			}
+		});
+
+		const UINT32 chunkCount = (halfEdgeCount + SubdivideChunkSize - 1) / SubdivideChunkSize;
+		std::fill_n(chunkEdgeOffsets.begin(), chunkCount, 0);
+		ForEachChunk(threadPool, halfEdgeCount, [&](UINT32 first, UINT32 last) {
+			for (UINT32 i = first; i < last; ++i) {
+				if (edgeFirstUses[edgeSlots[i]].load(std::memory_order_relaxed) == i) {
+					++chunkEdgeOffsets[i / SubdivideChunkSize];
+				}
+			}
+		});
+
+		UINT32 edgeCount = 0;
+		for (UINT32 chunk = 0; chunk < chunkCount; ++chunk) {
+			const UINT32 chunkEdges = chunkEdgeOffsets[chunk];
+			chunkEdgeOffsets[chunk] = edgeCount;
+			edgeCount += chunkEdges;
+		}
+
+		// Later levels are derived from the first one, every edge splits in two and every triangle adds three inside.
+		// Exact for meshes without duplicate triangles, more than enough otherwise.
+		if (level == 0) {
+			UINT64 finalVertexCount = static_cast<UINT64>(vertexCount) + edgeCount;
+			for (UINT64 edges = edgeCount, triangles = triangleCount, l = 1; l < levels; ++l, triangles *= 4) {
+				edges = edges * 2 + triangles * 3;
+				finalVertexCount += edges;
+			}
+			meshData.m_vertices.reserve(static_cast<size_t>(std::min<UINT64>(finalVertexCount, UINT_MAX)));
+		}
+
+		meshData.m_vertices.resize(static_cast<size_t>(vertexCount) + edgeCount);
+		indices.resize(static_cast<size_t>(triangleCount) * 12);
+
+		auto* vertices = meshData.m_vertices.data();
+		ForEachChunk(threadPool, halfEdgeCount, [&](UINT32 first, UINT32 last) {
+			UINT32 nextEdge = chunkEdgeOffsets[first / SubdivideChunkSize];
+			for (UINT32 i = first; i < last; ++i) {
+				const UINT32 slot = edgeSlots[i];
+				if (edgeFirstUses[slot].load(std::memory_order_relaxed) == i) {
+					const UINT64 key = edgeKeys[slot].load(std::memory_order_relaxed);
+					vertices[vertexCount + nextEdge] = MidPoint(vertices[key >> 32], vertices[key & UINT_MAX]);
+					edgeMidpoints[slot] = vertexCount + nextEdge++;
+				}
+			}
+		});
+
+		// Every triangle becomes the three corner triangles and the middle one, winding preserved
+		auto* newIndices = indices.data();
+		ForEachChunk(threadPool, triangleCount, [&](UINT32 first, UINT32 last) {
+			for (UINT32 t = first; t < last; ++t) {
+				const UINT32* corner = oldIndices + t * 3;
+				const UINT32* slots = edgeSlots.data() + t * 3;
+				const UINT32 midpoint[3]{ edgeMidpoints[slots[0]], edgeMidpoints[slots[1]], edgeMidpoints[slots[2]] };
+				UINT32* out = newIndices + static_cast<size_t>(t) * 12;
+
+				out[0] = corner[0];		out[1] = midpoint[0];	out[2] = midpoint[2];
+				out[3] = midpoint[0];	out[4] = midpoint[1];	out[5] = midpoint[2];
+				out[6] = midpoint[2];	out[7] = midpoint[1];	out[8] = corner[2];
+				out[9] = midpoint[0];	out[10] = corner[1];	out[11] = midpoint[1];
+			}
+		});
+
+		meshData.m_indices.swap(indices);
 	}
 }
 
@@ -224,6 +474,7 @@ GeometryClass::Vertex GeometryClass::MidPoint(const Vertex& v0, const Vertex& v1
 	Vertex v{};
 	v.m_position = 0.5f * (v0.m_position + v1.m_position);
 	v.m_normal = Normalize(0.5f * (v0.m_normal + v1.m_normal));
+	v.m_tangent = Normalize(0.5f * (v0.m_tangent + v1.m_tangent));
 	DirectX::XMStoreFloat2(&v.m_uv, DirectX::XMVectorMultiply(DirectX::XMVectorAdd(tex0, tex1), { 0.5f, 0.5f, 0.5f }));
 
 	return v;
@@ -1,4 +1,7 @@
 #pragma once
+
+class ThreadPoolClass;
+
 class GeometryClass {
 public:
 	struct Vertex {
@@ -18,17 +21,92 @@ public:
 		DirectX::XMFLOAT2 m_uv;
 	};
 
+	// Contiguous run of at most 124 triangles using at most 64 vertices, in the index order of its mesh,
+	// culled on its own. The bounding sphere and normal cone are in object space. coneCutoff is the sine
+	// of the cone's half angle, 1 when the normals spread too far for the cone to ever face away.
+	struct Meshlet {
+		UINT32 firstIndex;
+		UINT32 indexCount;
+		DirectX::XMFLOAT3 center;
+		float radius;
+		DirectX::XMFLOAT3 coneAxis;
+		float coneCutoff;
+	};
+
+	// Index range of a level of detail, every level of a mesh indexes the same vertices. error is the
+	// object space distance the level may deviate from the full detail surface.
+	struct Lod {
+		UINT32 firstIndex;
+		UINT32 indexCount;
+		float error;
+	};
+
+	// Vertices and indices stored elsewhere, such as in a Mesh or a mapped file. The view does not copy
+	// them, m_owner keeps the memory alive for as long as a view referencing it exists.
+	struct MeshView {
+		const Vertex* m_vertices{ nullptr };
+		UINT m_vertexCount{ 0 };
+		const UINT32* m_indices{ nullptr };
+		UINT m_indexCount{ 0 };
+		const Meshlet* m_meshlets{ nullptr };
+		UINT m_meshletCount{ 0 };
+		const Lod* m_lods{ nullptr };
+		UINT m_lodCount{ 0 };
+		std::shared_ptr<const void> m_owner;
+
+		// Object space AABB of the vertices, both are zero for a mesh without vertices
+		void ComputeBounds(Math::Vector3& minBound, Math::Vector3& maxBound) const {
+			if (m_vertexCount == 0) {
+				minBound = maxBound = Math::Vector3(Math::kZero);
+				return;
+			}
+
+			minBound = maxBound = m_vertices[0].m_position;
+			for (UINT i = 1; i < m_vertexCount; ++i) {
+				minBound = Math::Min(minBound, m_vertices[i].m_position);
+				maxBound = Math::Max(maxBound, m_vertices[i].m_position);
+			}
+		}
+	};
+
 	struct Mesh {
 		std::vector<Vertex> m_vertices;
 		std::vector<UINT32> m_indices;
+		std::vector<Meshlet> m_meshlets;	// Empty unless built by MeshProcessing::BuildMeshlets, covers the first level of detail
+		std::vector<Lod> m_lods;			// Empty unless built by MeshProcessing::BuildLods, the first level is the full detail mesh
 
 		void Translate(const Math::Vector3 &trns) {
 			for (auto& vert : m_vertices) {
 				vert.m_position += trns;
 			}
+			for (auto& meshlet : m_meshlets) {
+				DirectX::XMStoreFloat3(&meshlet.center, Math::Vector3(meshlet.center) + trns);
+			}
+		}
+
+		// Without an owner, only valid while the mesh is alive and unchanged
+		MeshView GetView() const {
+			return {
+				m_vertices.data(), static_cast<UINT>(m_vertices.size()),
+				m_indices.data(), static_cast<UINT>(m_indices.size()),
+				m_meshlets.data(), static_cast<UINT>(m_meshlets.size()),
+				m_lods.data(), static_cast<UINT>(m_lods.size()),
+				nullptr };
+		}
+
+		void ComputeBounds(Math::Vector3& minBound, Math::Vector3& maxBound) const {
+			GetView().ComputeBounds(minBound, maxBound);
 		}
 	};
 
+	// Moves the mesh to the heap, the returned view owns it
+	static MeshView Share(Mesh mesh) {
+		auto owner = std::make_shared<const Mesh>(std::move(mesh));
+		auto view = owner->GetView();
+		view.m_owner = std::move(owner);
+		return view;
+	}
+
 	// Delete functions
 	GeometryClass() = delete;
 	GeometryClass(GeometryClass const& rhs) = delete;
@@ -38,10 +116,32 @@ public:
 	GeometryClass& operator=(GeometryClass&& rhs) = delete;
 
 public:
-	static Mesh CreateBox(const float width, const float height, const float depth, const UINT numSubdivisions);
-	static Mesh CreateSphere(const float radius, const UINT numSubdivisions);
+	// Subdivision runs on threadPool when one is given, every level has four times the triangles of the one before
+	static Mesh CreateBox(const float width, const float height, const float depth, const UINT numSubdivisions, ThreadPoolClass* threadPool = nullptr);
+	static Mesh CreateSphere(const float radius, const UINT numSubdivisions, ThreadPoolClass* threadPool = nullptr);
+
+	// Tessellated directly, every subdivision doubles the segments in both directions like a Subdivide level does.
+	// At zero subdivisions a cylinder has 8 slices, a grid a single cell, a torus 16 by 8 segments and a capsule
+	// 8 slices with 2 rings per half sphere. The cylinder and capsule stand on the Y axis, the grid lies in XZ facing +Y.
+	static Mesh CreateCylinder(const float radius, const float height, const UINT numSubdivisions);
+	static Mesh CreateGrid(const float width, const float depth, const UINT numSubdivisions);
+	static Mesh CreateTorus(const float majorRadius, const float minorRadius, const UINT numSubdivisions);
+	static Mesh CreateCapsule(const float radius, const float height, const UINT numSubdivisions);	// height of the straight part
+
+	// Splits every triangle into four, numSubdivisions times. Triangles sharing an edge by its vertex indices
+	// share its midpoint, so the vertices only grow by the edge count per level. Levels that would overflow
+	// 32-bit indices are skipped. The result is the same with or without threadPool.
+	static void Subdivide(Mesh& meshData, UINT numSubdivisions, ThreadPoolClass* threadPool = nullptr);
 
 private:
-	static void Subdivide(Mesh& meshData);
 	static Vertex MidPoint(const Vertex& v0, const Vertex& v1);
+
+	// Indices of the quads between rows + 1 rows of columns + 1 vertices starting at firstVertex, wound like
+	// CreateBox. The triangles a collapsed first or last row, a pole, would make without area are left out.
+	static void AppendGridIndices(
+		std::vector<UINT32>& indices,
+		UINT32 firstVertex,
+		UINT rows, UINT columns,
+		bool collapsedFirstRow = false,
+		bool collapsedLastRow = false);
 };
\ No newline at end of file
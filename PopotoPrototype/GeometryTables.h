@@ -0,0 +1,189 @@
+#pragma once
+
+// Base shapes of the GeometryClass generators, built by the compiler. The tables are written in the order
+// they were authored in and every fixup, the flipped texture u of the box and the winding of both shapes,
+// is applied by constexpr functions, so creating a shape at runtime copies a finished table.
+namespace GeometryTables {
+	// Laid out like GeometryClass::Vertex, whose Math::Vector3 members are padded to four floats
+	struct alignas(16) VertexData {
+		float position[4];
+		float normal[4];
+		float tangent[4];
+		float uv[2];
+	};
+
+	template<size_t VertexCount, size_t IndexCount>
+	struct MeshTable {
+		std::array<VertexData, VertexCount> vertices;
+		std::array<UINT32, IndexCount> indices;
+	};
+
+	// The tables are authored counter-clockwise around the outward normal, the renderer expects the reverse
+	template<size_t IndexCount>
+	constexpr std::array<UINT32, IndexCount> ReverseWinding(std::array<UINT32, IndexCount> indices) {
+		for (size_t i = 0; i < IndexCount; i += 3) {
+			const UINT32 rest = indices[i + 1];
+			indices[i + 1] = indices[i + 2];
+			indices[i + 2] = rest;
+		}
+		return indices;
+	}
+
+	template<size_t VertexCount>
+	constexpr std::array<VertexData, VertexCount> FlipU(std::array<VertexData, VertexCount> vertices) {
+		for (auto& vertex : vertices) {
+			vertex.uv[0] = vertex.uv[0] == 0.0f ? 1.0f : 0.0f;
+		}
+		return vertices;
+	}
+
+	constexpr VertexData MakeVertex(
+		float px, float py, float pz,
+		float nx, float ny, float nz,
+		float tx, float ty, float tz,
+		float u, float v) {
+		return { { px, py, pz, 0.0f }, { nx, ny, nz, 0.0f }, { tx, ty, tz, 0.0f }, { u, v } };
+	}
+
+	// Unit cube, CreateBox scales the positions by its dimensions
+	constexpr MeshTable<24, 36> Box{
+		FlipU(std::array<VertexData, 24>{
+			// Front face
+			MakeVertex(-0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+			MakeVertex(-0.5f, +0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f),
+			MakeVertex(+0.5f, +0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f),
+			MakeVertex(+0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f),
+
+			// Back face
+			MakeVertex(-0.5f, -0.5f, +0.5f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f),
+			MakeVertex(+0.5f, -0.5f, +0.5f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+			MakeVertex(+0.5f, +0.5f, +0.5f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f),
+			MakeVertex(-0.5f, +0.5f, +0.5f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f),
+
+			// Top face
+			MakeVertex(-0.5f, +0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+			MakeVertex(-0.5f, +0.5f, +0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f),
+			MakeVertex(+0.5f, +0.5f, +0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f),
+			MakeVertex(+0.5f, +0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f),
+
+			// Bottom face
+			MakeVertex(-0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f),
+			MakeVertex(+0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+			MakeVertex(+0.5f, -0.5f, +0.5f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f),
+			MakeVertex(-0.5f, -0.5f, +0.5f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f),
+
+			// Left face
+			MakeVertex(-0.5f, -0.5f, +0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f),
+			MakeVertex(-0.5f, +0.5f, +0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f),
+			MakeVertex(-0.5f, +0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f),
+			MakeVertex(-0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f),
+
+			// Right face
+			MakeVertex(+0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f),
+			MakeVertex(+0.5f, +0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f),
+			MakeVertex(+0.5f, +0.5f, +0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f),
+			MakeVertex(+0.5f, -0.5f, +0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f)
+		}),
+		ReverseWinding(std::array<UINT32, 36>{
+			0, 1, 2,	0, 2, 3,	// Front face
+			4, 5, 6,	4, 6, 7,	// Back face
+			8, 9, 10,	8, 10, 11,	// Top face
+			12, 13, 14,	12, 14, 15,	// Bottom face
+			16, 17, 18,	16, 18, 19,	// Left face
+			20, 21, 22,	20, 22, 23	// Right face
+		})
+	};
+
+	constexpr float IcosahedronX = 0.525731f;
+	constexpr float IcosahedronZ = 0.850651f;
+
+	// Positions only, CreateSphere projects them onto the sphere and derives the other attributes
+	constexpr VertexData MakePosition(float x, float y, float z) {
+		return { { x, y, z, 0.0f }, {}, {}, {} };
+	}
+
+	constexpr MeshTable<12, 60> Icosahedron{
+		std::array<VertexData, 12>{
+			MakePosition(-IcosahedronX, 0.0f, IcosahedronZ), MakePosition(IcosahedronX, 0.0f, IcosahedronZ),
+			MakePosition(-IcosahedronX, 0.0f, -IcosahedronZ), MakePosition(IcosahedronX, 0.0f, -IcosahedronZ),
+			MakePosition(0.0f, IcosahedronZ, IcosahedronX), MakePosition(0.0f, IcosahedronZ, -IcosahedronX),
+			MakePosition(0.0f, -IcosahedronZ, IcosahedronX), MakePosition(0.0f, -IcosahedronZ, -IcosahedronX),
+			MakePosition(IcosahedronZ, IcosahedronX, 0.0f), MakePosition(-IcosahedronZ, IcosahedronX, 0.0f),
+			MakePosition(IcosahedronZ, -IcosahedronX, 0.0f), MakePosition(-IcosahedronZ, -IcosahedronX, 0.0f)
+		},
+		ReverseWinding(std::array<UINT32, 60>{
+			1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
+			1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
+			3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+			10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
+		})
+	};
+
+	// Smallest power of two of at least value
+	constexpr size_t CeilPow2(size_t value) {
+		size_t result = 1;
+		while (result < value) result <<= 1;
+		return result;
+	}
+
+	// GeometryClass::Subdivide on the positions of a closed mesh, whose every edge is shared by two triangles.
+	// Midpoints are numbered and triangles split in the same order, so the result matches the runtime one.
+	template<size_t VertexCount, size_t IndexCount>
+	constexpr MeshTable<VertexCount + IndexCount / 2, IndexCount * 4> SubdividePositions(const MeshTable<VertexCount, IndexCount>& mesh) {
+		MeshTable<VertexCount + IndexCount / 2, IndexCount * 4> result{};
+
+		for (size_t v = 0; v < VertexCount; ++v) {
+			result.vertices[v] = mesh.vertices[v];
+		}
+
+		// Midpoints by edge, open addressed and at most half full with the IndexCount / 2 edges.
+		// Keys are offset by one so 0 marks an empty slot.
+		constexpr size_t TableSize = CeilPow2(IndexCount);
+		std::array<UINT64, TableSize> edgeKeys{};
+		std::array<UINT32, TableSize> edgeMidpoints{};
+		std::array<UINT32, IndexCount> triangleMidpoints{};
+		UINT32 nextVertex = static_cast<UINT32>(VertexCount);
+
+		for (size_t i = 0; i < IndexCount; ++i) {
+			const UINT32 a = mesh.indices[i];
+			const UINT32 b = mesh.indices[i % 3 == 2 ? i - 2 : i + 1];
+			const UINT32 low = a < b ? a : b;
+			const UINT32 high = a < b ? b : a;
+
+			const UINT64 key = static_cast<UINT64>(low) * VertexCount + high + 1;
+			size_t slot = static_cast<size_t>(key * 0x9E3779B97F4A7C15ULL >> 32) & (TableSize - 1);
+			while (edgeKeys[slot] != 0 && edgeKeys[slot] != key) {
+				slot = (slot + 1) & (TableSize - 1);
+			}
+
+			auto& midpoint = edgeMidpoints[slot];
+			if (edgeKeys[slot] == 0) {
+				edgeKeys[slot] = key;
+				auto& vertex = result.vertices[nextVertex];
+				for (size_t c = 0; c < 3; ++c) {
+					vertex.position[c] = 0.5f * (mesh.vertices[low].position[c] + mesh.vertices[high].position[c]);
+				}
+				midpoint = nextVertex++;
+			}
+			triangleMidpoints[i] = midpoint;
+		}
+
+		for (size_t t = 0; t < IndexCount / 3; ++t) {
+			const UINT32 c0 = mesh.indices[t * 3 + 0], c1 = mesh.indices[t * 3 + 1], c2 = mesh.indices[t * 3 + 2];
+			const UINT32 m0 = triangleMidpoints[t * 3 + 0], m1 = triangleMidpoints[t * 3 + 1], m2 = triangleMidpoints[t * 3 + 2];
+			const UINT32 split[12]{ c0, m0, m2,  m0, m1, m2,  m2, m1, c2,  m0, c1, m1 };
+
+			for (size_t k = 0; k < 12; ++k) {
+				result.indices[t * 12 + k] = split[k];
+			}
+		}
+
+		return result;
+	}
+
+	// The icosahedron subdivided once, twice and three times. Higher levels are subdivided at runtime from the last one.
+	constexpr auto Icosphere1 = SubdividePositions(Icosahedron);
+	constexpr auto Icosphere2 = SubdividePositions(Icosphere1);
+	constexpr auto Icosphere3 = SubdividePositions(Icosphere2);
+	constexpr UINT MaxIcosphereLevel = 3;
+};
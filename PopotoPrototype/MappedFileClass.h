@@ -0,0 +1,30 @@
+#pragma once
+
+// Read only view of a whole file, mapped into the address space instead of read into memory
+class MappedFileClass
+{
+public:
+	MappedFileClass() = default;
+	~MappedFileClass();
+
+	// Closes the current mapping first, returns false when the file can not be opened or is empty
+	bool Open(const wchar_t* fileName);
+	void Close();
+
+	bool IsOpen() const { return m_data != nullptr; }
+	const UINT8* GetData() const { return m_data; }
+	UINT64 GetSize() const { return m_size; }
+
+	// Delete functions
+	MappedFileClass(MappedFileClass const& rhs) = delete;
+	MappedFileClass& operator=(MappedFileClass const& rhs) = delete;
+
+	MappedFileClass(MappedFileClass&& rhs) = delete;
+	MappedFileClass& operator=(MappedFileClass&& rhs) = delete;
+
+private:
+	HANDLE m_file{ INVALID_HANDLE_VALUE };
+	HANDLE m_mapping{ nullptr };
+	const UINT8* m_data{ nullptr };
+	UINT64 m_size{ 0 };
+};
@@ -1,24 +1,59 @@
 #pragma once
 
+#include "RenderBackend.h"
+
+class UploadBatchClass;
 class MaterialClass
 {
 public:
+	// Ids of destroyed materials and textures are handed out again, so removing models frees their
+	// slots in the descriptor heaps and the material bits of the draw sort key
 	static UINT TOTALMATERIALCOUNT;
-	const UINT m_id{ TOTALMATERIALCOUNT++ };
+	static std::vector<UINT> FREEMATERIALIDS;
+	const UINT m_id{ Utility::AcquireId(TOTALMATERIALCOUNT, FREEMATERIALIDS) };
+
+	MaterialClass() = default;
+	~MaterialClass() { FREEMATERIALIDS.push_back(m_id); }
 
 	struct Texture {
 		static UINT TOTALTEXTURECOUNT;
-		const UINT m_id{ TOTALTEXTURECOUNT++ };
+		static std::vector<UINT> FREETEXTUREIDS;
+		const UINT m_id{ Utility::AcquireId(TOTALTEXTURECOUNT, FREETEXTUREIDS) };
+
+		Texture() = default;
+		~Texture() { FREETEXTUREIDS.push_back(m_id); }
+
+		Texture(Texture const& rhs) = delete;
+		Texture& operator=(Texture const& rhs) = delete;
 
 		std::wstring m_fileName{};
 
 		Microsoft::WRL::ComPtr<ID3D12Resource> m_textureResource{};
-		Microsoft::WRL::ComPtr<ID3D12Resource> m_textureResourceUpload{};
 
+		// A texture file read and decoded into memory, next to the resource that receives it
+		struct Decoded {
+			std::wstring fileName;
+			Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+			std::unique_ptr<uint8_t[]> data;
+			std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+		};
+
+		// Reads and decodes the file. Safe to call from any thread, the device is free threaded.
+		static Decoded Decode(Microsoft::WRL::ComPtr<ID3D12Device> device, const wchar_t* fileName);
+
+		// Takes over the decoded resource, stages its texels in uploadBatch and creates the SRV.
+		// The texture is usable once the batch has been flushed and executed.
+		void Upload(
+			Microsoft::WRL::ComPtr<ID3D12Device> device,
+			Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvHeap,
+			UploadBatchClass& uploadBatch,
+			Decoded& decoded);
+
+		// Decode followed by Upload
 		void Load(
-			Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> cmdList,
 			Microsoft::WRL::ComPtr<ID3D12Device> device,
 			Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvHeap,
+			UploadBatchClass& uploadBatch,
 			const wchar_t* fileName);
 	};
 
@@ -42,13 +77,32 @@ public:
 	std::shared_ptr<Texture> m_textures[NUM_TEXTURES_PER_MATERIAL];
 
 	MaterialConstantBuffer m_materialConstantBuffer{};
+	bool m_dirty{ true };	// Set after changing m_materialConstantBuffer to upload it again
+
+	// Taken from TOTALREVISIONCOUNT whenever a renderer picks up m_dirty, so every renderer sees the change
+	static UINT64 TOTALREVISIONCOUNT;
+	UINT64 m_revision{ 0 };
 public:
-	void DrawMaterial(
-		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> cmdList,
-		Microsoft::WRL::ComPtr<ID3D12Resource> materialCBResource,
-		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvHeapGlobal,
-		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvHeapDynamic,
-		const std::vector<UINT>* shadowMapTextureIDs);
-private:
-	UINT m_cbvSrvDescriptorSize{};
+	// Copies the textures and the two shadowmaps, given by their slots in the global heap, into this
+	// material's range of the shader visible heap. Only needs to happen once per frame, every pass binds the same range.
+	void CopyDescriptors(
+		RenderBackend& backend,
+		UINT descriptorSize,
+		CpuDescriptorHandle globalHeapStart,
+		CpuDescriptorHandle frameHeapStart,
+		const UINT* shadowMapTextureIDs) const;
+
+	// Binds the material constant buffer and descriptor table
+	void BindMaterial(
+		RenderBackend& backend,
+		UINT descriptorSize,
+		GpuAddress materialCBAddress,
+		GpuDescriptorHandle frameHeapStart) const;
+
+	// Delete functions
+	MaterialClass(MaterialClass const& rhs) = delete;
+	MaterialClass& operator=(MaterialClass const& rhs) = delete;
+
+	MaterialClass(MaterialClass&& rhs) = delete;
+	MaterialClass& operator=(MaterialClass&& rhs) = delete;
 };
@@ -64,8 +64,8 @@ void Frustum::ConstructOrthographicFrustum( float Left, float Right, float Top,
     m_FrustumPlanes[kFarPlane]		= BoundingPlane(  0.0f,  0.0f,  1.0f,   Back );
     m_FrustumPlanes[kLeftPlane]		= BoundingPlane(  1.0f,  0.0f,  0.0f,  -Left );
     m_FrustumPlanes[kRightPlane]	= BoundingPlane( -1.0f,  0.0f,  0.0f,  Right );
-    m_FrustumPlanes[kTopPlane]		= BoundingPlane(  0.0f, -1.0f,  0.0f, Bottom );
-    m_FrustumPlanes[kBottomPlane]	= BoundingPlane(  0.0f,  1.0f,  0.0f,   -Top );
+    m_FrustumPlanes[kTopPlane]		= BoundingPlane(  0.0f, -1.0f,  0.0f,    Top );
+    m_FrustumPlanes[kBottomPlane]	= BoundingPlane(  0.0f,  1.0f,  0.0f, -Bottom );
 }
 
 
@@ -85,8 +85,8 @@ Frustum::Frustum( const Matrix4& ProjMat )
         float Right	 = ( 1.0f - ProjMatF[12]) * RcpXX;
         float Top	 = ( 1.0f - ProjMatF[13]) * RcpYY;
         float Bottom = (-1.0f - ProjMatF[13]) * RcpYY;
-        float Front	 = ( 0.0f - ProjMatF[14]) * RcpZZ;
-        float Back   = ( 1.0f - ProjMatF[14]) * RcpZZ;
+        float Front	 = ProjMatF[14] * RcpZZ;
+        float Back   = (ProjMatF[14] - 1.0f) * RcpZZ;
 
         // Check for reverse Z here.  The bounding planes need to point into the frustum.
         if (Front < Back)
@@ -0,0 +1,65 @@
+#include "stdafx.h"
+#include "MeshClass.h"
+#include "RenderBackend.h"
+
+UINT MeshClass::TOTALMESHCOUNT{ 0 };
+std::vector<UINT> MeshClass::FREEMESHIDS;
+
+MeshClass::~MeshClass() {
+	if (m_arena) {
+		m_arena->FreeVertices(m_vertexRange);
+		m_arena->FreeIndices(m_indexRange);
+	}
+	FREEMESHIDS.push_back(m_id);
+}
+
+void MeshClass::Draw(RenderBackend& backend, UINT instanceCount, UINT lod) const {
+	const auto& level = m_lods[lod];
+
+	backend.DrawIndexedInstanced(
+		level.indexCount,
+		instanceCount,
+		m_indexRange.offset + level.firstIndex,
+		static_cast<INT>(m_vertexRange.offset),
+		0);
+}
+
+void MeshClass::DrawRange(RenderBackend& backend, UINT firstIndex, UINT indexCount) const {
+	assert(firstIndex + indexCount <= m_indexRange.count);
+
+	backend.DrawIndexedInstanced(
+		indexCount,
+		1,
+		m_indexRange.offset + firstIndex,
+		static_cast<INT>(m_vertexRange.offset),
+		0);
+}
+
+void MeshClass::ConstructBuffers(GeometryArenaClass& arena) {
+	Math::Vector3 minBound, maxBound;
+	m_source.ComputeBounds(minBound, maxBound);
+	ConstructBuffers(arena, minBound, maxBound);
+}
+
+void MeshClass::ConstructBuffers(GeometryArenaClass& arena, const Math::Vector3& boundsMin, const Math::Vector3& boundsMax) {
+	assert(!m_arena);
+
+	m_arena = &arena;
+	m_vertexRange = arena.AllocateVertices(m_source.m_vertices, m_source.m_vertexCount, m_source.m_owner);
+	m_indexRange = arena.AllocateIndices(m_source.m_indices, m_source.m_indexCount, m_source.m_vertexCount, m_source.m_owner);
+
+	m_meshlets.assign(m_source.m_meshlets, m_source.m_meshlets + m_source.m_meshletCount);
+
+	if (m_source.m_lodCount) {
+		m_lods.assign(m_source.m_lods, m_source.m_lods + m_source.m_lodCount);
+	}
+	else {
+		m_lods = { { 0, m_indexRange.count, 0.0f } };
+	}
+
+	m_localBoundsMin = boundsMin;
+	m_localBoundsMax = boundsMax;
+
+	// The arena holds on to the source until it is uploaded
+	m_source = {};
+}
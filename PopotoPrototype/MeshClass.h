@@ -0,0 +1,71 @@
+#pragma once
+#include "GeometryArenaClass.h"
+
+class RenderBackend;
+
+// A range of the scene's geometry arena. Models hold it through a shared_ptr so that every
+// instance of the same geometry draws from the same vertices and indices.
+class MeshClass
+{
+public:
+	// Ids of destroyed meshes are handed out again, they have to fit the mesh bits of the draw sort key
+	static UINT TOTALMESHCOUNT;
+	static std::vector<UINT> FREEMESHIDS;
+	const UINT m_id{ Utility::AcquireId(TOTALMESHCOUNT, FREEMESHIDS) };
+
+	MeshClass() = default;
+
+	explicit MeshClass(GeometryClass::Mesh data) :
+		m_source{ GeometryClass::Share(std::move(data)) } {}
+
+	// The viewed vertices and indices are read by the arena's next Upload, the view keeps them alive until then
+	explicit MeshClass(GeometryClass::MeshView source) :
+		m_source{ std::move(source) } {}
+
+	~MeshClass();
+
+	// Allocates the source in the arena and computes the local bounds, has to be called once the vertices are known.
+	// The arena has to outlive the mesh. The source reaches the GPU with the arena's next Upload, the mesh keeps
+	// no CPU copy of it.
+	void ConstructBuffers(GeometryArenaClass& arena);
+
+	// Same, with bounds that are already known, such as those stored in a scene cache
+	void ConstructBuffers(GeometryArenaClass& arena, const Math::Vector3& boundsMin, const Math::Vector3& boundsMax);
+
+	// Draws the whole level of detail, the arena and its index pool of GetIndexFormat have to be bound already
+	void Draw(RenderBackend& backend, UINT instanceCount, UINT lod = 0) const;
+
+	// Draws indexCount indices starting at firstIndex of the mesh, such as the meshlets left after culling
+	void DrawRange(RenderBackend& backend, UINT firstIndex, UINT indexCount) const;
+
+	// Meshes without a built chain have a single level covering every index
+	UINT GetLodCount() const { return static_cast<UINT>(m_lods.size()); }
+	const GeometryClass::Lod& GetLod(UINT lod) const { return m_lods[lod]; }
+	UINT GetIndexCount(UINT lod = 0) const { return m_lods[lod].indexCount; }
+	DXGI_FORMAT GetIndexFormat() const { return m_indexRange.format; }
+
+	// Object space meshlets of the first level of detail, kept on the CPU for cluster culling. Empty when none were built.
+	const std::vector<GeometryClass::Meshlet>& GetMeshlets() const { return m_meshlets; }
+
+	const Math::Vector3& GetLocalBoundsMin() const { return m_localBoundsMin; }
+	const Math::Vector3& GetLocalBoundsMax() const { return m_localBoundsMax; }
+
+	// Delete functions
+	MeshClass(MeshClass const& rhs) = delete;
+	MeshClass& operator=(MeshClass const& rhs) = delete;
+
+	MeshClass(MeshClass&& rhs) = delete;
+	MeshClass& operator=(MeshClass&& rhs) = delete;
+
+private:
+	GeometryClass::MeshView m_source;
+	std::vector<GeometryClass::Meshlet> m_meshlets;
+	std::vector<GeometryClass::Lod> m_lods{ { 0, 0, 0.0f } };
+
+	// Object space AABB of the vertices
+	Math::Vector3 m_localBoundsMin{ Math::kZero }, m_localBoundsMax{ Math::kZero };
+
+	GeometryArenaClass* m_arena{ nullptr };
+	GeometryArenaClass::Range m_vertexRange{};
+	GeometryArenaClass::IndexRange m_indexRange{};
+};
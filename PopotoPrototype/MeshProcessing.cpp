@@ -0,0 +1,877 @@
+#include "stdafx.h"
+#include "MeshProcessing.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+	constexpr UINT InvalidTriangle = UINT_MAX;
+
+	// Scoring of "Linear-Speed Vertex Cache Optimisation", Tom Forsyth
+	constexpr float CacheDecayPower = 1.5f;
+	constexpr float LastTriangleScore = 0.75f;
+	constexpr float ValenceBoostScale = 2.0f;
+	constexpr float ValenceBoostPower = 0.5f;
+
+	float VertexScore(int cachePosition, UINT remainingTriangles) {
+		// Nothing left to draw with it
+		if (remainingTriangles == 0) return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			// The vertices of the last triangle get a fixed score, so the next triangle does not simply reuse the same edge
+			if (cachePosition < 3) {
+				score = LastTriangleScore;
+			}
+			else {
+				const float scaler = 1.0f / (MeshProcessing::VertexCacheSize - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+			}
+		}
+
+		// Vertices with few triangles left are finished off early
+		return score + ValenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -ValenceBoostPower);
+	}
+
+	// Position, normal, tangent and uv, without the padding of the vectors
+	using VertexAttributes = std::array<float, 11>;
+
+	VertexAttributes GetAttributes(const GeometryClass::Vertex& vertex) {
+		VertexAttributes attributes;
+		DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&attributes[0]), vertex.m_position);
+		DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&attributes[3]), vertex.m_normal);
+		DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&attributes[6]), vertex.m_tangent);
+		attributes[9] = vertex.m_uv.x;
+		attributes[10] = vertex.m_uv.y;
+
+		// -0 and 0 compare equal, so they have to hash the same
+		for (auto& attribute : attributes) {
+			attribute += 0.0f;
+		}
+		return attributes;
+	}
+
+	struct AttributeHash {
+		size_t operator()(const VertexAttributes& attributes) const {
+			UINT64 hash = 14695981039346656037ULL;
+			for (const auto attribute : attributes) {
+				UINT32 bits;
+				std::memcpy(&bits, &attribute, sizeof(bits));
+				hash = (hash ^ bits) * 1099511628211ULL;
+			}
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	// Cell of the position grid used by the epsilon weld, cells are epsilon wide
+	struct WeldCell {
+		INT64 x, y, z;
+
+		bool operator==(const WeldCell& rhs) const { return x == rhs.x && y == rhs.y && z == rhs.z; }
+	};
+
+	struct WeldCellHash {
+		size_t operator()(const WeldCell& cell) const {
+			return static_cast<size_t>((cell.x * 73856093) ^ (cell.y * 19349663) ^ (cell.z * 83492791));
+		}
+	};
+
+	bool IsWithin(const VertexAttributes& a, const VertexAttributes& b, float epsilon) {
+		for (size_t i = 0; i < a.size(); ++i) {
+			if (std::abs(a[i] - b[i]) > epsilon) return false;
+		}
+		return true;
+	}
+
+	// Index of the vertex each vertex is merged into, every vertex kept maps to itself
+	std::vector<UINT32> FindExactDuplicates(const std::vector<GeometryClass::Vertex>& vertices) {
+		std::vector<UINT32> remap(vertices.size());
+		std::unordered_map<VertexAttributes, UINT32, AttributeHash> kept;
+		kept.reserve(vertices.size());
+
+		for (UINT32 i = 0; i < vertices.size(); ++i) {
+			remap[i] = kept.emplace(GetAttributes(vertices[i]), i).first->second;
+		}
+		return remap;
+	}
+
+	// Bounds of triangles [firstTriangle, lastTriangle) of the mesh
+	GeometryClass::Meshlet MakeMeshlet(const GeometryClass::Mesh& mesh, size_t firstTriangle, size_t lastTriangle) {
+		using namespace Math;
+
+		// Normals whose cone is wider than this, about 84 degrees, are not worth testing
+		constexpr float MinConeCosine = 0.1f;
+
+		GeometryClass::Meshlet meshlet{};
+		meshlet.firstIndex = static_cast<UINT32>(firstTriangle * 3);
+		meshlet.indexCount = static_cast<UINT32>((lastTriangle - firstTriangle) * 3);
+
+		const UINT32* indices = mesh.m_indices.data() + meshlet.firstIndex;
+
+		Vector3 minBound = mesh.m_vertices[indices[0]].m_position;
+		Vector3 maxBound = minBound;
+		for (UINT32 i = 1; i < meshlet.indexCount; ++i) {
+			minBound = Min(minBound, mesh.m_vertices[indices[i]].m_position);
+			maxBound = Max(maxBound, mesh.m_vertices[indices[i]].m_position);
+		}
+
+		const Vector3 center = (minBound + maxBound) * 0.5f;
+		float radius = 0.0f;
+		for (UINT32 i = 0; i < meshlet.indexCount; ++i) {
+			radius = std::max(radius, static_cast<float>(Length(mesh.m_vertices[indices[i]].m_position - center)));
+		}
+
+		// Triangles without area have no normal and do not constrain the cone. Meshes are wound clockwise
+		// around their outward normal, see ConvertMesh, so the edges are crossed in reverse.
+		std::vector<Vector3> normals;
+		normals.reserve(meshlet.indexCount / 3);
+		for (UINT32 i = 0; i < meshlet.indexCount; i += 3) {
+			const auto& p0 = mesh.m_vertices[indices[i + 0]].m_position;
+			const auto& p1 = mesh.m_vertices[indices[i + 1]].m_position;
+			const auto& p2 = mesh.m_vertices[indices[i + 2]].m_position;
+
+			const Vector3 normal = Cross(p2 - p0, p1 - p0);
+			const float length = Length(normal);
+			if (length > 0.0f) {
+				normals.push_back(normal / length);
+			}
+		}
+
+		Vector3 axis(kZero);
+		for (const auto& normal : normals) {
+			axis += normal;
+		}
+
+		float minCosine = -1.0f;
+		const float axisLength = Length(axis);
+		if (axisLength > 0.0f) {
+			axis = axis / axisLength;
+			minCosine = 1.0f;
+			for (const auto& normal : normals) {
+				minCosine = std::min(minCosine, static_cast<float>(Dot(axis, normal)));
+			}
+		}
+
+		DirectX::XMStoreFloat3(&meshlet.center, center);
+		meshlet.radius = radius;
+		DirectX::XMStoreFloat3(&meshlet.coneAxis, axis);
+		meshlet.coneCutoff = minCosine > MinConeCosine ? std::sqrt(1.0f - minCosine * minCosine) : 1.0f;
+		return meshlet;
+	}
+
+	// Symmetric 4x4 matrix of the plane equations summed into it, weighted by area
+	struct Quadric {
+		double a2, b2, c2, d2;
+		double ab, ac, ad;
+		double bc, bd, cd;
+		double weight;
+
+		void AddPlane(double a, double b, double c, double d, double planeWeight) {
+			a2 += planeWeight * a * a; b2 += planeWeight * b * b; c2 += planeWeight * c * c; d2 += planeWeight * d * d;
+			ab += planeWeight * a * b; ac += planeWeight * a * c; ad += planeWeight * a * d;
+			bc += planeWeight * b * c; bd += planeWeight * b * d; cd += planeWeight * c * d;
+			weight += planeWeight;
+		}
+
+		void Add(const Quadric& rhs) {
+			a2 += rhs.a2; b2 += rhs.b2; c2 += rhs.c2; d2 += rhs.d2;
+			ab += rhs.ab; ac += rhs.ac; ad += rhs.ad;
+			bc += rhs.bc; bd += rhs.bd; cd += rhs.cd;
+			weight += rhs.weight;
+		}
+
+		// Sum of the weighted squared distances of p to the planes
+		double Evaluate(const DirectX::XMFLOAT3& p) const {
+			const double x = p.x, y = p.y, z = p.z;
+			return a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+				2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z);
+		}
+	};
+
+	// Mean squared distance to the planes of both quadrics when collapsing onto p
+	double CollapseCost(const Quadric& from, const Quadric& to, const DirectX::XMFLOAT3& p) {
+		const double weight = from.weight + to.weight;
+		if (weight <= 0.0) return 0.0;
+		return std::max((from.Evaluate(p) + to.Evaluate(p)) / weight, 0.0);
+	}
+
+	struct Vector3d {
+		double x, y, z;
+	};
+
+	Vector3d Subtract(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+		return { static_cast<double>(a.x) - b.x, static_cast<double>(a.y) - b.y, static_cast<double>(a.z) - b.z };
+	}
+
+	Vector3d CrossD(const Vector3d& a, const Vector3d& b) {
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	double DotD(const Vector3d& a, const Vector3d& b) {
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	UINT64 EdgeKey(UINT32 from, UINT32 to) {
+		return (static_cast<UINT64>(from) << 32) | to;
+	}
+
+	// What a vertex may be collapsed into during simplification
+	enum class VertexKind : UINT8 {
+		Manifold,	// Any neighbour
+		Border,		// A border neighbour along an open edge
+		Locked		// Nothing
+	};
+
+	struct Collapse {
+		UINT32 from;
+		UINT32 to;
+		double cost;
+	};
+
+	std::vector<UINT32> FindNearDuplicates(const std::vector<GeometryClass::Vertex>& vertices, float epsilon) {
+		std::vector<UINT32> remap(vertices.size());
+		std::vector<VertexAttributes> attributes(vertices.size());
+		std::unordered_map<WeldCell, std::vector<UINT32>, WeldCellHash> cells;
+
+		for (UINT32 i = 0; i < vertices.size(); ++i) {
+			attributes[i] = GetAttributes(vertices[i]);
+			const WeldCell cell{
+				static_cast<INT64>(std::floor(attributes[i][0] / epsilon)),
+				static_cast<INT64>(std::floor(attributes[i][1] / epsilon)),
+				static_cast<INT64>(std::floor(attributes[i][2] / epsilon)) };
+
+			// A position within epsilon is at most one cell away
+			remap[i] = i;
+			for (INT64 z = cell.z - 1; z <= cell.z + 1 && remap[i] == i; ++z) {
+				for (INT64 y = cell.y - 1; y <= cell.y + 1 && remap[i] == i; ++y) {
+					for (INT64 x = cell.x - 1; x <= cell.x + 1 && remap[i] == i; ++x) {
+						const auto found = cells.find({ x, y, z });
+						if (found == cells.end()) continue;
+
+						for (const auto candidate : found->second) {
+							if (IsWithin(attributes[i], attributes[candidate], epsilon)) {
+								remap[i] = candidate;
+								break;
+							}
+						}
+					}
+				}
+			}
+
+			if (remap[i] == i) {
+				cells[cell].push_back(i);
+			}
+		}
+		return remap;
+	}
+}
+
+float MeshProcessing::ComputeACMR(const UINT32* indices, size_t indexCount, UINT vertexCount, UINT cacheSize) {
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) return 0.0f;
+
+	// A vertex is cached while fewer than cacheSize misses happened since it was last loaded
+	std::vector<UINT64> loadedAt(vertexCount, 0);
+	UINT64 misses = 0;
+
+	for (size_t i = 0; i < indexCount; ++i) {
+		const UINT32 index = indices[i];
+		if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize) {
+			++misses;
+			loadedAt[index] = misses;
+		}
+	}
+
+	return static_cast<float>(misses) / static_cast<float>(triangleCount);
+}
+
+UINT MeshProcessing::WeldVertices(GeometryClass::Mesh& mesh, float epsilon) {
+	const auto remap = epsilon > 0.0f ? FindNearDuplicates(mesh.m_vertices, epsilon) : FindExactDuplicates(mesh.m_vertices);
+
+	// Kept vertices stay in their order, remap already points at the first of each group
+	std::vector<UINT32> compacted(mesh.m_vertices.size());
+	std::vector<GeometryClass::Vertex> vertices;
+	vertices.reserve(mesh.m_vertices.size());
+
+	for (UINT32 i = 0; i < mesh.m_vertices.size(); ++i) {
+		if (remap[i] == i) {
+			compacted[i] = static_cast<UINT32>(vertices.size());
+			vertices.push_back(mesh.m_vertices[i]);
+		}
+	}
+
+	size_t indexCount = 0;
+	for (size_t triangle = 0; triangle + 2 < mesh.m_indices.size(); triangle += 3) {
+		const UINT32 i0 = compacted[remap[mesh.m_indices[triangle + 0]]];
+		const UINT32 i1 = compacted[remap[mesh.m_indices[triangle + 1]]];
+		const UINT32 i2 = compacted[remap[mesh.m_indices[triangle + 2]]];
+
+		if (i0 == i1 || i1 == i2 || i0 == i2) continue;
+
+		mesh.m_indices[indexCount++] = i0;
+		mesh.m_indices[indexCount++] = i1;
+		mesh.m_indices[indexCount++] = i2;
+	}
+	mesh.m_indices.resize(indexCount);
+
+	const auto removed = static_cast<UINT>(mesh.m_vertices.size() - vertices.size());
+	mesh.m_vertices.swap(vertices);
+	return removed;
+}
+
+void MeshProcessing::OptimizeVertexCache(std::vector<UINT32>& indices, UINT vertexCount) {
+	const UINT triangleCount = static_cast<UINT>(indices.size() / 3);
+	if (triangleCount < 2) return;
+
+	// Triangles using each vertex, the first remaining[v] entries of its range are still to be drawn
+	std::vector<UINT> adjacencyOffsets(vertexCount + 1, 0);
+	for (const auto index : indices) {
+		++adjacencyOffsets[index + 1];
+	}
+	std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+	std::vector<UINT> remaining(vertexCount, 0);
+	std::vector<UINT> adjacency(indices.size());
+	for (UINT triangle = 0; triangle < triangleCount; ++triangle) {
+		for (UINT corner = 0; corner < 3; ++corner) {
+			const UINT32 vertex = indices[triangle * 3 + corner];
+			adjacency[adjacencyOffsets[vertex] + remaining[vertex]++] = triangle;
+		}
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (UINT vertex = 0; vertex < vertexCount; ++vertex) {
+		vertexScores[vertex] = VertexScore(-1, remaining[vertex]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<UINT8> drawn(triangleCount, 0);
+
+	UINT bestTriangle = 0;
+	for (UINT triangle = 0; triangle < triangleCount; ++triangle) {
+		const UINT32* corners = &indices[triangle * 3];
+		triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+
+		if (triangleScores[triangle] > triangleScores[bestTriangle]) {
+			bestTriangle = triangle;
+		}
+	}
+
+	std::vector<UINT32> output;
+	output.reserve(indices.size());
+
+	// Room for the cache plus the three vertices pushed in front of it
+	std::array<UINT32, VertexCacheSize + 3> cache{}, nextCache{};
+	UINT cacheCount = 0;
+	UINT scanCursor = 0;
+
+	for (UINT drawnCount = 0; drawnCount < triangleCount; ++drawnCount) {
+		if (bestTriangle == InvalidTriangle) {
+			// Nothing in the cache has triangles left, continue with the first one not drawn yet
+			while (drawn[scanCursor]) ++scanCursor;
+			bestTriangle = scanCursor;
+		}
+
+		drawn[bestTriangle] = 1;
+		const UINT32 corners[3]{ indices[bestTriangle * 3 + 0], indices[bestTriangle * 3 + 1], indices[bestTriangle * 3 + 2] };
+		output.insert(output.end(), corners, corners + 3);
+
+		// Its vertices move to the front of the cache, followed by the rest of the old cache
+		UINT nextCount = 0;
+		for (const auto vertex : corners) {
+			if (std::find(nextCache.begin(), nextCache.begin() + nextCount, vertex) == nextCache.begin() + nextCount) {
+				nextCache[nextCount++] = vertex;
+			}
+
+			const auto first = adjacency.begin() + adjacencyOffsets[vertex];
+			const auto last = first + remaining[vertex];
+			std::iter_swap(std::find(first, last, bestTriangle), last - 1);
+			--remaining[vertex];
+		}
+
+		for (UINT i = 0; i < cacheCount; ++i) {
+			const UINT32 vertex = cache[i];
+			if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2]) {
+				nextCache[nextCount++] = vertex;
+			}
+		}
+
+		// Vertices that fell out of the cache lose their cache score
+		for (UINT i = VertexCacheSize; i < nextCount; ++i) {
+			cachePositions[nextCache[i]] = -1;
+		}
+
+		std::swap(cache, nextCache);
+		cacheCount = std::min(nextCount, VertexCacheSize);
+
+		// Rescore every vertex whose position changed, the dropped ones included
+		for (UINT i = 0; i < nextCount; ++i) {
+			const UINT32 vertex = cache[i];
+			if (i < cacheCount) {
+				cachePositions[vertex] = static_cast<int>(i);
+			}
+
+			const float score = VertexScore(cachePositions[vertex], remaining[vertex]);
+			const float delta = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+
+			const UINT first = adjacencyOffsets[vertex];
+			for (UINT j = first; j < first + remaining[vertex]; ++j) {
+				triangleScores[adjacency[j]] += delta;
+			}
+		}
+
+		// The next triangle is the best one that uses a cached vertex
+		bestTriangle = InvalidTriangle;
+		float bestScore = -1.0f;
+		for (UINT i = 0; i < cacheCount; ++i) {
+			const UINT32 vertex = cache[i];
+			const UINT first = adjacencyOffsets[vertex];
+
+			for (UINT j = first; j < first + remaining[vertex]; ++j) {
+				const UINT triangle = adjacency[j];
+				if (triangleScores[triangle] > bestScore) {
+					bestScore = triangleScores[triangle];
+					bestTriangle = triangle;
+				}
+			}
+		}
+	}
+
+	indices.swap(output);
+}
+
+void MeshProcessing::OptimizeOverdraw(std::vector<UINT32>& indices, const std::vector<GeometryClass::Vertex>& vertices, float threshold) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2) return;
+
+	const UINT vertexCount = static_cast<UINT>(vertices.size());
+
+	// A cluster starts at every triangle whose vertices all miss the cache, the cache order is kept within clusters
+	std::vector<size_t> clusterStarts;
+	{
+		std::vector<UINT64> loadedAt(vertexCount, 0);
+		UINT64 misses = 0;
+
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+			UINT triangleMisses = 0;
+			for (UINT corner = 0; corner < 3; ++corner) {
+				const UINT32 index = indices[triangle * 3 + corner];
+				if (loadedAt[index] == 0 || misses - loadedAt[index] >= VertexCacheSize) {
+					++misses;
+					++triangleMisses;
+					loadedAt[index] = misses;
+				}
+			}
+
+			if (triangleMisses == 3 || triangle == 0) {
+				clusterStarts.push_back(triangle);
+			}
+		}
+	}
+
+	const size_t clusterCount = clusterStarts.size();
+	if (clusterCount < 2) return;
+	clusterStarts.push_back(triangleCount);
+
+	Math::Vector3 meshCenter(Math::kZero);
+	for (const auto& vertex : vertices) {
+		meshCenter += vertex.m_position;
+	}
+	meshCenter = meshCenter / static_cast<float>(std::max(vertexCount, 1U));
+
+	// How far the area weighted center of the cluster lies along its average normal, seen from the mesh center
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+		Math::Vector3 center(Math::kZero);
+		Math::Vector3 normal(Math::kZero);
+		float area = 0.0f;
+
+		for (size_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; ++triangle) {
+			const auto& p0 = vertices[indices[triangle * 3 + 0]].m_position;
+			const auto& p1 = vertices[indices[triangle * 3 + 1]].m_position;
+			const auto& p2 = vertices[indices[triangle * 3 + 2]].m_position;
+
+			// Outward, the winding is clockwise around it
+			const Math::Vector3 triangleNormal = Math::Cross(p2 - p0, p1 - p0);
+			const float triangleArea = Math::Length(triangleNormal);
+
+			center += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += triangleNormal;
+			area += triangleArea;
+		}
+
+		const float normalLength = Math::Length(normal);
+		sortKeys[cluster] = (area > 0.0f && normalLength > 0.0f) ?
+			static_cast<float>(Math::Dot(center / area - meshCenter, normal / normalLength)) :
+			0.0f;
+	}
+
+	std::vector<size_t> clusterOrder(clusterCount);
+	std::iota(clusterOrder.begin(), clusterOrder.end(), size_t{ 0 });
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+		[&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<UINT32> sorted;
+	sorted.reserve(indices.size());
+	for (const auto cluster : clusterOrder) {
+		sorted.insert(sorted.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+	}
+
+	const float acmr = ComputeACMR(indices.data(), indices.size(), vertexCount);
+	const float sortedAcmr = ComputeACMR(sorted.data(), sorted.size(), vertexCount);
+	if (sortedAcmr <= acmr * threshold) {
+		indices.swap(sorted);
+	}
+}
+
+void MeshProcessing::OptimizeVertexFetch(GeometryClass::Mesh& mesh) {
+	constexpr UINT32 Unassigned = UINT32_MAX;
+
+	std::vector<UINT32> remap(mesh.m_vertices.size(), Unassigned);
+	std::vector<GeometryClass::Vertex> vertices;
+	vertices.reserve(mesh.m_vertices.size());
+
+	for (auto& index : mesh.m_indices) {
+		if (remap[index] == Unassigned) {
+			remap[index] = static_cast<UINT32>(vertices.size());
+			vertices.push_back(mesh.m_vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	mesh.m_vertices.swap(vertices);
+}
+
+void MeshProcessing::BuildMeshlets(GeometryClass::Mesh& mesh, UINT maxVertices, UINT maxTriangles) {
+	mesh.m_meshlets.clear();
+
+	const size_t triangleCount = mesh.m_indices.size() / 3;
+	if (triangleCount == 0 || mesh.m_vertices.empty()) return;
+
+	// Meshlet a vertex was last counted in, plus one so that 0 means none
+	std::vector<UINT> countedIn(mesh.m_vertices.size(), 0);
+	UINT stamp = 1;
+	UINT vertexCount = 0;
+	size_t firstTriangle = 0;
+
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+		const UINT32* corners = &mesh.m_indices[triangle * 3];
+
+		const auto countNew = [&] {
+			return (countedIn[corners[0]] != stamp ? 1U : 0U) +
+				(countedIn[corners[1]] != stamp && corners[1] != corners[0] ? 1U : 0U) +
+				(countedIn[corners[2]] != stamp && corners[2] != corners[0] && corners[2] != corners[1] ? 1U : 0U);
+		};
+
+		UINT newVertices = countNew();
+		if (vertexCount + newVertices > maxVertices || triangle - firstTriangle >= maxTriangles) {
+			mesh.m_meshlets.push_back(MakeMeshlet(mesh, firstTriangle, triangle));
+
+			firstTriangle = triangle;
+			vertexCount = 0;
+			++stamp;
+			newVertices = countNew();
+		}
+
+		countedIn[corners[0]] = countedIn[corners[1]] = countedIn[corners[2]] = stamp;
+		vertexCount += newVertices;
+	}
+
+	mesh.m_meshlets.push_back(MakeMeshlet(mesh, firstTriangle, triangleCount));
+}
+
+std::vector<UINT32> MeshProcessing::Simplify(
+	const UINT32* indices,
+	size_t indexCount,
+	const std::vector<GeometryClass::Vertex>& vertices,
+	size_t targetIndexCount,
+	float maxError,
+	float& error) {
+
+	// Triangles whose normal turns further than this, about 75 degrees, reject the collapse
+	constexpr double MinNormalCosine = 0.25;
+	// Weight of the planes that keep open borders in place, relative to those of the faces
+	constexpr double BorderWeight = 10.0;
+
+	std::vector<UINT32> result(indices, indices + indexCount - indexCount % 3);
+	error = 0.0f;
+
+	const UINT vertexCount = static_cast<UINT>(vertices.size());
+	if (result.size() <= targetIndexCount || vertexCount == 0) return result;
+
+	std::vector<DirectX::XMFLOAT3> positions(vertexCount);
+	for (UINT i = 0; i < vertexCount; ++i) {
+		DirectX::XMStoreFloat3(&positions[i], vertices[i].m_position);
+	}
+
+	// Edges without a twin running the other way lie on an open border. Rebuilt every pass, collapses
+	// create new edges.
+	std::unordered_set<UINT64> directedEdges;
+	const auto findEdges = [&directedEdges, &result] {
+		directedEdges.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (UINT k = 0; k < 3; ++k) {
+				directedEdges.insert(EdgeKey(result[i + k], result[i + (k + 1) % 3]));
+			}
+		}
+	};
+	findEdges();
+
+	const auto isOpen = [&directedEdges](UINT32 a, UINT32 b) {
+		return directedEdges.find(EdgeKey(b, a)) == directedEdges.end();
+	};
+
+	std::vector<VertexKind> kinds(vertexCount, VertexKind::Manifold);
+	{
+		// Only the position part of the key is used
+		std::unordered_map<VertexAttributes, UINT32, AttributeHash> firstAtPosition;
+		std::vector<UINT32> firstVertex(vertexCount);
+		std::vector<UINT32> sharing(vertexCount, 0);
+		for (UINT i = 0; i < vertexCount; ++i) {
+			VertexAttributes key{};
+			key[0] = positions[i].x + 0.0f;
+			key[1] = positions[i].y + 0.0f;
+			key[2] = positions[i].z + 0.0f;
+			firstVertex[i] = firstAtPosition.emplace(key, i).first->second;
+			++sharing[firstVertex[i]];
+		}
+		for (UINT i = 0; i < vertexCount; ++i) {
+			if (sharing[firstVertex[i]] > 1) {
+				kinds[i] = VertexKind::Locked;
+			}
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i = 0; i < result.size(); i += 3) {
+		const UINT32 corners[3]{ result[i], result[i + 1], result[i + 2] };
+		const Vector3d normal = CrossD(Subtract(positions[corners[1]], positions[corners[0]]), Subtract(positions[corners[2]], positions[corners[0]]));
+		const double length = std::sqrt(DotD(normal, normal));
+		if (length == 0.0) continue;
+
+		const Vector3d n{ normal.x / length, normal.y / length, normal.z / length };
+		const auto& p0 = positions[corners[0]];
+		const double d = -(n.x * p0.x + n.y * p0.y + n.z * p0.z);
+		const double area = 0.5 * length;
+
+		for (const auto corner : corners) {
+			quadrics[corner].AddPlane(n.x, n.y, n.z, d, area);
+		}
+
+		// A plane through every open edge, perpendicular to the face, holds the border in place
+		for (UINT k = 0; k < 3; ++k) {
+			const UINT32 a = corners[k];
+			const UINT32 b = corners[(k + 1) % 3];
+			if (!isOpen(a, b)) continue;
+
+			if (kinds[a] == VertexKind::Manifold) kinds[a] = VertexKind::Border;
+			if (kinds[b] == VertexKind::Manifold) kinds[b] = VertexKind::Border;
+
+			const Vector3d edge = Subtract(positions[b], positions[a]);
+			const Vector3d perpendicular = CrossD(edge, n);
+			const double perpendicularLength = std::sqrt(DotD(perpendicular, perpendicular));
+			if (perpendicularLength == 0.0) continue;
+
+			const Vector3d m{ perpendicular.x / perpendicularLength, perpendicular.y / perpendicularLength, perpendicular.z / perpendicularLength };
+			const double md = -(m.x * positions[a].x + m.y * positions[a].y + m.z * positions[a].z);
+			const double edgeWeight = BorderWeight * DotD(edge, edge);
+			quadrics[a].AddPlane(m.x, m.y, m.z, md, edgeWeight);
+			quadrics[b].AddPlane(m.x, m.y, m.z, md, edgeWeight);
+		}
+	}
+
+	const auto canCollapse = [&](UINT32 from, UINT32 to) {
+		switch (kinds[from]) {
+		case VertexKind::Manifold: return true;
+		case VertexKind::Border: return kinds[to] != VertexKind::Manifold && (isOpen(from, to) || isOpen(to, from));
+		default: return false;
+		}
+	};
+
+	const double maxCost = static_cast<double>(maxError) * maxError;
+	std::vector<UINT> adjacencyOffsets(vertexCount + 1);
+	std::vector<UINT> adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<UINT32> remap(vertexCount);
+	std::vector<UINT8> touched(vertexCount);
+
+	// Every pass collapses each vertex at most once, then rebuilds the triangles
+	while (result.size() > targetIndexCount) {
+		const UINT triangleCount = static_cast<UINT>(result.size() / 3);
+		findEdges();
+
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0U);
+		for (const auto index : result) {
+			++adjacencyOffsets[index + 1];
+		}
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+		adjacency.resize(result.size());
+		{
+			std::vector<UINT> filled(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (UINT triangle = 0; triangle < triangleCount; ++triangle) {
+				for (UINT k = 0; k < 3; ++k) {
+					adjacency[filled[result[triangle * 3 + k]]++] = triangle;
+				}
+			}
+		}
+
+		// The cheaper direction of every edge, each edge is seen from its lower vertex or from its open side
+		collapses.clear();
+		for (UINT triangle = 0; triangle < triangleCount; ++triangle) {
+			for (UINT k = 0; k < 3; ++k) {
+				const UINT32 a = result[triangle * 3 + k];
+				const UINT32 b = result[triangle * 3 + (k + 1) % 3];
+				if (a > b && !isOpen(a, b)) continue;
+
+				Collapse best{ a, b, DBL_MAX };
+				if (canCollapse(a, b)) {
+					best.cost = CollapseCost(quadrics[a], quadrics[b], positions[b]);
+				}
+				if (canCollapse(b, a)) {
+					const double cost = CollapseCost(quadrics[b], quadrics[a], positions[a]);
+					if (cost < best.cost) {
+						best = { b, a, cost };
+					}
+				}
+
+				if (best.cost <= maxCost) {
+					collapses.push_back(best);
+				}
+			}
+		}
+
+		if (collapses.empty()) break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.cost < rhs.cost; });
+
+		std::iota(remap.begin(), remap.end(), 0U);
+		std::fill(touched.begin(), touched.end(), UINT8{ 0 });
+
+		size_t remainingIndices = result.size();
+		bool collapsed = false;
+
+		for (const auto& collapse : collapses) {
+			if (remainingIndices <= targetIndexCount) break;
+			if (touched[collapse.from] || touched[collapse.to]) continue;
+
+			// The triangles kept around from must not turn over once it sits at to
+			bool flips = false;
+			UINT removedTriangles = 0;
+			for (UINT j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1] && !flips; ++j) {
+				const UINT32* corners = &result[adjacency[j] * 3];
+				if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+					++removedTriangles;
+					continue;
+				}
+
+				DirectX::XMFLOAT3 moved[3];
+				for (UINT k = 0; k < 3; ++k) {
+					moved[k] = positions[corners[k] == collapse.from ? collapse.to : corners[k]];
+				}
+
+				const Vector3d before = CrossD(Subtract(positions[corners[1]], positions[corners[0]]), Subtract(positions[corners[2]], positions[corners[0]]));
+				const Vector3d after = CrossD(Subtract(moved[1], moved[0]), Subtract(moved[2], moved[0]));
+				flips = DotD(before, after) < MinNormalCosine * std::sqrt(DotD(before, before) * DotD(after, after));
+			}
+			if (flips) continue;
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].Add(quadrics[collapse.from]);
+
+			// Neighbours keep their triangles unchanged for the flip tests of this pass
+			for (UINT j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1]; ++j) {
+				const UINT32* corners = &result[adjacency[j] * 3];
+				touched[corners[0]] = touched[corners[1]] = touched[corners[2]] = 1;
+			}
+
+			remainingIndices -= 3 * static_cast<size_t>(removedTriangles);
+			error = std::max(error, static_cast<float>(std::sqrt(collapse.cost)));
+			collapsed = true;
+		}
+
+		if (!collapsed) break;
+
+		size_t written = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			const UINT32 i0 = remap[result[i + 0]];
+			const UINT32 i1 = remap[result[i + 1]];
+			const UINT32 i2 = remap[result[i + 2]];
+			if (i0 == i1 || i1 == i2 || i0 == i2) continue;
+
+			result[written++] = i0;
+			result[written++] = i1;
+			result[written++] = i2;
+		}
+		result.resize(written);
+	}
+
+	return result;
+}
+
+void MeshProcessing::BuildLods(GeometryClass::Mesh& mesh, UINT maxLods) {
+	// The first level is the full detail mesh, the error bound doubles with every level after it
+	constexpr float FirstLodMaxError = 0.01f;	// Of the bounding box diagonal
+	constexpr UINT MinLodTriangles = 64;		// Smaller meshes are not worth a level
+	constexpr float MaxLodRatio = 0.8f;			// Levels that keep more triangles than this are dropped
+
+	mesh.m_lods.clear();
+	if (mesh.m_indices.empty() || mesh.m_vertices.empty()) return;
+
+	mesh.m_lods.push_back({ 0, static_cast<UINT32>(mesh.m_indices.size()), 0.0f });
+
+	Math::Vector3 minBound, maxBound;
+	mesh.ComputeBounds(minBound, maxBound);
+	const float extent = Math::Length(maxBound - minBound);
+
+	float maxError = FirstLodMaxError * extent;
+	for (UINT level = 1; level < maxLods; ++level, maxError *= 2.0f) {
+		const auto previous = mesh.m_lods.back();
+		if (previous.indexCount / 3 < MinLodTriangles) break;
+
+		// Copied, the index buffer grows below
+		const std::vector<UINT32> source(mesh.m_indices.begin() + previous.firstIndex, mesh.m_indices.begin() + previous.firstIndex + previous.indexCount);
+
+		const size_t target = (previous.indexCount / 6) * 3;
+		float error = 0.0f;
+		auto simplified = Simplify(source.data(), source.size(), mesh.m_vertices, target, maxError, error);
+		if (simplified.empty() || simplified.size() > previous.indexCount * MaxLodRatio) break;
+
+		OptimizeVertexCache(simplified, static_cast<UINT>(mesh.m_vertices.size()));
+
+		mesh.m_lods.push_back({ static_cast<UINT32>(mesh.m_indices.size()), static_cast<UINT32>(simplified.size()), std::max(error, previous.error) });
+		mesh.m_indices.insert(mesh.m_indices.end(), simplified.begin(), simplified.end());
+	}
+
+	// Nothing to choose from
+	if (mesh.m_lods.size() == 1) {
+		mesh.m_lods.clear();
+	}
+}
+
+MeshProcessing::OptimizeStats MeshProcessing::Optimize(GeometryClass::Mesh& mesh) {
+	OptimizeStats stats;
+
+	// Meshes the importer skipped keep their indices but have no vertices
+	if (mesh.m_vertices.empty() || mesh.m_indices.empty()) return stats;
+
+	stats.verticesBefore = static_cast<UINT>(mesh.m_vertices.size());
+	WeldVertices(mesh);
+
+	const UINT vertexCount = static_cast<UINT>(mesh.m_vertices.size());
+	stats.acmrBefore = ComputeACMR(mesh.m_indices.data(), mesh.m_indices.size(), vertexCount);
+
+	OptimizeVertexCache(mesh.m_indices, vertexCount);
+	OptimizeOverdraw(mesh.m_indices, mesh.m_vertices);
+	OptimizeVertexFetch(mesh);
+
+	stats.verticesAfter = static_cast<UINT>(mesh.m_vertices.size());
+	stats.acmrAfter = ComputeACMR(mesh.m_indices.data(), mesh.m_indices.size(), stats.verticesAfter);
+	return stats;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "GeometryClass.h"
+
+// Import time passes over the index and vertex order of a mesh. They run on the importer's worker
+// threads, before the mesh is cooked into the scene cache, so none of them cost anything at load.
+namespace MeshProcessing {
+	// Entries of the post transform cache the passes optimize for and ACMR is measured with
+	constexpr UINT VertexCacheSize = 32;
+
+	// Average cache miss ratio, vertices transformed per triangle with a FIFO cache of cacheSize
+	// entries. Ranges from 3 without any reuse down to about 0.5 for large regular grids.
+	float ComputeACMR(const UINT32* indices, size_t indexCount, UINT vertexCount, UINT cacheSize = VertexCacheSize);
+
+	// Merges vertices that are equal in every attribute, or with epsilon > 0 those whose attributes all
+	// lie within epsilon of a vertex kept before them, and points the indices at the kept one.
+	// Triangles that lose a corner to the merge are dropped. Returns the number of vertices removed.
+	UINT WeldVertices(GeometryClass::Mesh& mesh, float epsilon = 0.0f);
+
+	// Reorders the triangles for the post transform vertex cache, using Forsyth's linear speed
+	// greedy algorithm with an LRU cache model
+	void OptimizeVertexCache(std::vector<UINT32>& indices, UINT vertexCount);
+
+	// Splits the cache optimized order where the cache restarts and draws the clusters facing away
+	// from the mesh center first, so occluded triangles tend to fail the depth test. The new order
+	// is only kept when its ACMR stays within threshold times the current one.
+	void OptimizeOverdraw(std::vector<UINT32>& indices, const std::vector<GeometryClass::Vertex>& vertices, float threshold = 1.05f);
+
+	// Renumbers the vertices in order of first use by the indices, so vertex fetch walks the buffer
+	// forwards. Vertices no index refers to are dropped.
+	void OptimizeVertexFetch(GeometryClass::Mesh& mesh);
+
+	// Limits of a meshlet, the same as those of the D3D12 mesh shader samples
+	constexpr UINT MaxMeshletVertices = 64;
+	constexpr UINT MaxMeshletTriangles = 124;
+
+	// Splits the triangles into meshlets in their current order, starting a new one whenever the next
+	// triangle would exceed either limit. The index order is kept, so this runs after every pass that
+	// changes it and a vertex cache optimized order gives compact meshlets.
+	void BuildMeshlets(GeometryClass::Mesh& mesh, UINT maxVertices = MaxMeshletVertices, UINT maxTriangles = MaxMeshletTriangles);
+
+	// Levels of detail of a mesh, the full detail one included
+	constexpr UINT MaxLods = 4;
+
+	// Quadric error metric simplification. Collapses edges in order of increasing error until at most
+	// targetIndexCount indices are left or the next collapse would move the surface further than
+	// maxError. A vertex is only ever merged into a neighbour, so the result indexes the same vertices.
+	// Vertices sharing their position with another one, on a uv or normal seam, are kept in place and
+	// those on an open border only move along it. error receives the largest error of the collapses made.
+	std::vector<UINT32> Simplify(
+		const UINT32* indices,
+		size_t indexCount,
+		const std::vector<GeometryClass::Vertex>& vertices,
+		size_t targetIndexCount,
+		float maxError,
+		float& error);
+
+	// Appends levels of about half the triangles of the level before, each as an index range after the
+	// full detail indices, until maxLods levels exist or the mesh stops getting simpler. Runs last.
+	void BuildLods(GeometryClass::Mesh& mesh, UINT maxLods = MaxLods);
+
+	struct OptimizeStats {
+		UINT verticesBefore{ 0 };
+		UINT verticesAfter{ 0 };
+		float acmrBefore{ 0.0f };
+		float acmrAfter{ 0.0f };
+	};
+
+	// Welds exact duplicates, then runs the vertex cache, overdraw and vertex fetch passes in that order.
+	// The ACMR before is measured on the welded mesh.
+	OptimizeStats Optimize(GeometryClass::Mesh& mesh);
+};
@@ -1,67 +1,60 @@
 #include "stdafx.h"
 #include "ModelClass.h"
+#include "D3D12RenderBackend.h"
 
 UINT ModelClass::TOTALMODELCOUNT{ 0 };
+UINT64 ModelClass::TOTALREVISIONCOUNT{ 0 };
+
+UINT8 ModelClass::GetRenderFlags() const {
+	UINT8 flags = 0;
+	if (m_castShadows) flags |= RenderFlags::CastShadows;
+	if (m_receiveShadows) flags |= RenderFlags::ReceiveShadows;
+	if (m_hidden) flags |= RenderFlags::Hidden;
+	if (m_excluded) flags |= RenderFlags::Excluded;
+	if (m_streaming) flags |= RenderFlags::Streaming;
+	return flags;
+}
 
 void ModelClass::DrawModel(
-	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> cmdList,
-	Microsoft::WRL::ComPtr<ID3D12Resource> modelCBResource,
-	Microsoft::WRL::ComPtr<ID3D12Resource> materialCBResource,
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvHeapGlobal,
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvHeapDynamic,
-	const std::vector<UINT>* shadowMapTextureIDs) {
+	RenderBackend& backend,
+	D3D12_GPU_VIRTUAL_ADDRESS modelCBAddress,
+	UINT lod) const {
 
-	cmdList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-	cmdList->IASetIndexBuffer(&m_indexBufferView);
+	backend.SetGraphicsRootConstantBufferView(Utility::RootParameterIndices::Object, modelCBAddress);
 
+	m_mesh->Draw(backend, 1, lod);
+}
 
-	m_material.DrawMaterial(cmdList, materialCBResource, srvHeapGlobal, srvHeapDynamic, shadowMapTextureIDs);
+void ModelClass::DrawModel(
+	RenderBackend& backend,
+	D3D12_GPU_VIRTUAL_ADDRESS modelCBAddress,
+	const ClusterCullingClass::IndexRange* ranges,
+	UINT rangeCount) const {
 
-	cmdList->SetGraphicsRootConstantBufferView(
-		Utility::RootParameterIndices::Object, 
-		modelCBResource->GetGPUVirtualAddress() + (m_id * Math::AlignUp(sizeof(ModelConstantBuffer), 256))
-	);
+	backend.SetGraphicsRootConstantBufferView(Utility::RootParameterIndices::Object, modelCBAddress);
 
-	cmdList->DrawIndexedInstanced(static_cast<UINT>(m_mesh.m_indices.size()), 1, 0, 0, 0);
+	for (UINT i = 0; i < rangeCount; ++i) {
+		m_mesh->DrawRange(backend, ranges[i].firstIndex, ranges[i].indexCount);
+	}
 }
 
-void ModelClass::ConstructBuffers(
-	Microsoft::WRL::ComPtr<ID3D12Device> device,
-	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> cmdList) {
+void ModelClass::UpdateWorldBounds(const Math::Matrix4& worldMat) {
+	using namespace Math;
 
-	// Create vertex buffer
-	{
-		const auto vertexBufferSize = static_cast<UINT>(sizeof(GeometryClass::Vertex) * m_mesh.m_vertices.size());
+	const Vector3 localCenter = (m_mesh->GetLocalBoundsMin() + m_mesh->GetLocalBoundsMax()) * 0.5f;
+	const Vector3 localExtent = (m_mesh->GetLocalBoundsMax() - m_mesh->GetLocalBoundsMin()) * 0.5f;
 
-		m_vertexBuffer = Utility::CreateDefaultBuffer(
-			device.Get(), 
-			cmdList.Get(), 
-			m_mesh.m_vertices.data(), 
-			vertexBufferSize, 
-			m_vertexBufferUpload, 
-			D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+	// Project the extents onto the world axes, this gives the tightest AABB around the transformed box
+	const Vector3 worldCenter = Vector3(worldMat * localCenter);
+	const Vector3 worldExtent =
+		Abs(Vector3(worldMat.GetX())) * localExtent.GetX() +
+		Abs(Vector3(worldMat.GetY())) * localExtent.GetY() +
+		Abs(Vector3(worldMat.GetZ())) * localExtent.GetZ();
 
-		// Initialize vertex buffer view
-		m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
-		m_vertexBufferView.StrideInBytes = sizeof(GeometryClass::Vertex);
-		m_vertexBufferView.SizeInBytes = vertexBufferSize;
-	}
+	m_worldBoundsMin = worldCenter - worldExtent;
+	m_worldBoundsMax = worldCenter + worldExtent;
+	m_worldBoundingSphere = BoundingSphere(worldCenter, Length(worldExtent));
 
-	// Create index buffer
-	{
-		const auto indexBufferSize = static_cast<UINT>(sizeof(UINT32) * m_mesh.m_indices.size());
-
-		m_indexBuffer = Utility::CreateDefaultBuffer(
-			device.Get(), 
-			cmdList.Get(), 
-			m_mesh.m_indices.data(), 
-			indexBufferSize, 
-			m_indexBufferUpload, 
-			D3D12_RESOURCE_STATE_INDEX_BUFFER);
-
-		// Initialize index buffer view
-		m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
-		m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
-		m_indexBufferView.SizeInBytes = indexBufferSize;
-	}
-}
\ No newline at end of file
+	const auto& meshlets = m_mesh->GetMeshlets();
+	ClusterCullingClass::TransformBounds(meshlets.data(), static_cast<UINT>(meshlets.size()), worldMat, m_UniformScale, m_worldClusterBounds);
+}
@@ -1,6 +1,21 @@
 #pragma once
-#include "GeometryClass.h"
+#include "MeshClass.h"
 #include "MaterialClass.h"
+#include "ClusterCullingClass.h"
+#include "Math/BoundingSphere.h"
+
+class RenderBackend;
+
+// Per model bits read by the draw loops, resolved from the model's flags after loading
+namespace RenderFlags {
+	enum : UINT8 {
+		CastShadows		= 1 << 0,
+		ReceiveShadows	= 1 << 1,
+		Hidden			= 1 << 2,
+		Excluded		= 1 << 3,
+		Streaming		= 1 << 4
+	};
+};
 
 struct ModelConstantBuffer {
 	Math::Matrix4 worldMat;
@@ -12,43 +27,59 @@ public:
 	static UINT TOTALMODELCOUNT;
 	const UINT m_id{ TOTALMODELCOUNT++ };
 
-	ModelClass() :
-		m_mesh{} {}
+	ModelClass() = default;
 
-	ModelClass(const GeometryClass::Mesh& mesh) :
-		m_mesh{ mesh } {}
+	ModelClass(std::shared_ptr<MeshClass> mesh, std::shared_ptr<MaterialClass> material) :
+		m_mesh{ std::move(mesh) }, m_material{ std::move(material) } {}
+
+	// Sets the object constant buffer and draws, geometry and material have to be bound already
+	void DrawModel(
+		RenderBackend& backend,
+		D3D12_GPU_VIRTUAL_ADDRESS modelCBAddress,
+		UINT lod = 0) const;
 
+	// Same, drawing only the index ranges of the mesh that survived cluster culling
 	void DrawModel(
-		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> cmdList,
-		Microsoft::WRL::ComPtr<ID3D12Resource> modelCBResource,
-		Microsoft::WRL::ComPtr<ID3D12Resource> materialCBResource,
-		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvHeapGlobal,
-		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvHeapDynamic,
-		const std::vector<UINT>* shadowMapTextureIDs = nullptr);
-
-	void ConstructBuffers(
-		Microsoft::WRL::ComPtr<ID3D12Device> device,
-		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> cmdList);
+		RenderBackend& backend,
+		D3D12_GPU_VIRTUAL_ADDRESS modelCBAddress,
+		const ClusterCullingClass::IndexRange* ranges,
+		UINT rangeCount) const;
+
+	// Transforms the local AABB into a world space AABB and bounding sphere, and the meshlet bounds of the mesh
+	void UpdateWorldBounds(const Math::Matrix4& worldMat);
+
+	// Use these instead of writing m_Transform or m_UniformScale, so the renderer picks up the change
+	void SetTransform(const Math::OrthogonalTransform& transform) { m_Transform = transform; m_dirty = true; }
+	void SetTranslation(const Math::Vector3& translation) { m_Transform.SetTranslation(translation); m_dirty = true; }
+	void SetUniformScale(float scale) { m_UniformScale = scale; m_dirty = true; }
 public:
 	std::string m_name;
-	MaterialClass m_material;
 
-	GeometryClass::Mesh m_mesh;
+	// Both can be shared with other models, models with the same mesh and material are drawn instanced
+	std::shared_ptr<MeshClass> m_mesh;
+	std::shared_ptr<MaterialClass> m_material;
+
 	Math::OrthogonalTransform m_Transform{ Math::kIdentity };
 	ModelConstantBuffer m_modelConstantBuffer{};
 	float m_UniformScale{ 1.0f };
+	bool m_dirty{ true };	// World matrix and bounds are out of date
+
+	// Taken from TOTALREVISIONCOUNT whenever the world matrix and bounds are recomputed, renderers
+	// compare it with the revision they last saw
+	static UINT64 TOTALREVISIONCOUNT;
+	UINT64 m_revision{ 0 };
 	
 	bool
 		m_castShadows{ true },
-		m_receiveShadows{ true };
+		m_receiveShadows{ true },
+		m_hidden{ false },
+		m_excluded{ false },	// Listed in the exclusion file of the scene
+		m_streaming{ false };	// Uploads of its geometry or textures are still in flight
 
-private:
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_vertexBuffer{};
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_vertexBufferUpload{};
-	D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
+	UINT8 GetRenderFlags() const;
 
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_indexBuffer{};
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_indexBufferUpload{};
-	D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
+	// Bounding volumes used for view frustum culling
+	Math::Vector3 m_worldBoundsMin{ Math::kZero }, m_worldBoundsMax{ Math::kZero };
+	Math::BoundingSphere m_worldBoundingSphere{ Math::Vector3(Math::kZero), 0.0f };
+	std::vector<ClusterBounds> m_worldClusterBounds;	// Indexed like the meshlets of the mesh
 };
-
@@ -0,0 +1,54 @@
+#include "stdafx.h"
+#include "ProceduralMeshCacheClass.h"
+
+namespace {
+	// FNV-1a
+	constexpr UINT64 FnvOffsetBasis = 14695981039346656037ULL;
+	constexpr UINT64 FnvPrime = 1099511628211ULL;
+
+	UINT64 HashBytes(UINT64 hash, const void* data, size_t size) {
+		const auto* bytes = static_cast<const UINT8*>(data);
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * FnvPrime;
+		}
+		return hash;
+	}
+}
+
+size_t ProceduralMeshKeyHash::operator()(const ProceduralMeshKey& key) const {
+	UINT64 hash = HashBytes(FnvOffsetBasis, &key.shape, sizeof(key.shape));
+	for (float dimension : key.dimensions) {
+		// -0 equals 0, so it has to hash the same
+		dimension = dimension == 0.0f ? 0.0f : dimension;
+		hash = HashBytes(hash, &dimension, sizeof(dimension));
+	}
+	hash = HashBytes(hash, &key.subdivisions, sizeof(key.subdivisions));
+	return static_cast<size_t>(hash);
+}
+
+GeometryClass::MeshView ProceduralMeshCacheClass::GetMesh(const ProceduralMeshKey& key) {
+	const auto found = m_meshes.find(key);
+	if (found != m_meshes.end()) {
+		++m_hits;
+		return found->second;
+	}
+
+	++m_misses;
+	return m_meshes.emplace(key, GeometryClass::Share(Generate(key, m_threadPool))).first->second;
+}
+
+GeometryClass::Mesh ProceduralMeshCacheClass::Generate(const ProceduralMeshKey& key, ThreadPoolClass* threadPool) {
+	const auto& d = key.dimensions;
+
+	switch (key.shape) {
+	case ProceduralShape::Box: return GeometryClass::CreateBox(d[0], d[1], d[2], key.subdivisions, threadPool);
+	case ProceduralShape::Sphere: return GeometryClass::CreateSphere(d[0], key.subdivisions, threadPool);
+	case ProceduralShape::Cylinder: return GeometryClass::CreateCylinder(d[0], d[1], key.subdivisions);
+	case ProceduralShape::Grid: return GeometryClass::CreateGrid(d[0], d[1], key.subdivisions);
+	case ProceduralShape::Torus: return GeometryClass::CreateTorus(d[0], d[1], key.subdivisions);
+	case ProceduralShape::Capsule: return GeometryClass::CreateCapsule(d[0], d[1], key.subdivisions);
+	default: {
+		assert(false);
+		return {};
+	}}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "GeometryClass.h"
+
+#include <unordered_map>
+
+class ThreadPoolClass;
+
+enum class ProceduralShape : UINT8 {
+	Box,		// width, height, depth
+	Sphere,		// radius
+	Cylinder,	// radius, height
+	Grid,		// width, depth
+	Torus,		// major radius, minor radius
+	Capsule		// radius, height of the straight part
+};
+
+// The parameters of a GeometryClass generator, dimensions it does not take are zero
+struct ProceduralMeshKey {
+	ProceduralShape shape;
+	std::array<float, 3> dimensions;
+	UINT subdivisions;
+
+	static ProceduralMeshKey Box(float width, float height, float depth, UINT subdivisions) { return { ProceduralShape::Box, { width, height, depth }, subdivisions }; }
+	static ProceduralMeshKey Sphere(float radius, UINT subdivisions) { return { ProceduralShape::Sphere, { radius, 0.0f, 0.0f }, subdivisions }; }
+	static ProceduralMeshKey Cylinder(float radius, float height, UINT subdivisions) { return { ProceduralShape::Cylinder, { radius, height, 0.0f }, subdivisions }; }
+	static ProceduralMeshKey Grid(float width, float depth, UINT subdivisions) { return { ProceduralShape::Grid, { width, depth, 0.0f }, subdivisions }; }
+	static ProceduralMeshKey Torus(float majorRadius, float minorRadius, UINT subdivisions) { return { ProceduralShape::Torus, { majorRadius, minorRadius, 0.0f }, subdivisions }; }
+	static ProceduralMeshKey Capsule(float radius, float height, UINT subdivisions) { return { ProceduralShape::Capsule, { radius, height, 0.0f }, subdivisions }; }
+
+	bool operator==(const ProceduralMeshKey& rhs) const {
+		return shape == rhs.shape && dimensions == rhs.dimensions && subdivisions == rhs.subdivisions;
+	}
+};
+
+struct ProceduralMeshKeyHash {
+	size_t operator()(const ProceduralMeshKey& key) const;
+};
+
+// Generated meshes by the parameters they were generated with. Every request for the same key returns a
+// view sharing the one immutable mesh, so populating a scene with many equal primitives generates each
+// shape once. Not thread safe, the generators themselves may run on the thread pool.
+class ProceduralMeshCacheClass
+{
+public:
+	explicit ProceduralMeshCacheClass(ThreadPoolClass* threadPool = nullptr) :
+		m_threadPool{ threadPool } {}
+
+	// Generates the mesh on the first request for key
+	GeometryClass::MeshView GetMesh(const ProceduralMeshKey& key);
+
+	// Runs the generator of key without looking at the cache
+	static GeometryClass::Mesh Generate(const ProceduralMeshKey& key, ThreadPoolClass* threadPool = nullptr);
+
+	// Drops the cache's references, meshes still viewed elsewhere stay alive
+	void Clear() { m_meshes.clear(); }
+
+	size_t GetCount() const { return m_meshes.size(); }
+	UINT64 GetHitCount() const { return m_hits; }
+	UINT64 GetMissCount() const { return m_misses; }
+
+	// Delete functions
+	ProceduralMeshCacheClass(ProceduralMeshCacheClass const& rhs) = delete;
+	ProceduralMeshCacheClass& operator=(ProceduralMeshCacheClass const& rhs) = delete;
+
+	ProceduralMeshCacheClass(ProceduralMeshCacheClass&& rhs) = delete;
+	ProceduralMeshCacheClass& operator=(ProceduralMeshCacheClass&& rhs) = delete;
+
+private:
+	ThreadPoolClass* m_threadPool;
+	std::unordered_map<ProceduralMeshKey, GeometryClass::MeshView, ProceduralMeshKeyHash> m_meshes;
+	UINT64 m_hits{ 0 };
+	UINT64 m_misses{ 0 };
+};
@@ -0,0 +1,111 @@
+#include "stdafx.h"
+#include "Profiler.h"
+
+#include <fstream>
+#include <mutex>
+
+namespace {
+	std::mutex g_registryMutex;
+	std::vector<std::unique_ptr<Profiler::ThreadBuffer>> g_threadBuffers;
+
+	Profiler::ThreadBuffer* RegisterThread() {
+		std::lock_guard<std::mutex> lock(g_registryMutex);
+		g_threadBuffers.emplace_back(std::make_unique<Profiler::ThreadBuffer>(GetCurrentThreadId()));
+		return g_threadBuffers.back().get();
+	}
+
+	// Writes name as the contents of a JSON string, escaping quotes, backslashes and control characters
+	void WriteJsonString(std::ostream& out, const char* name) {
+		for (const char* c = name; *c; ++c) {
+			const auto ch = static_cast<unsigned char>(*c);
+			switch (ch) {
+			case '"': out << "\\\""; break;
+			case '\\': out << "\\\\"; break;
+			case '\n': out << "\\n"; break;
+			case '\r': out << "\\r"; break;
+			case '\t': out << "\\t"; break;
+			default:
+				if (ch < 0x20) {
+					const char* const hexDigits = "0123456789abcdef";
+					out << "\\u00" << hexDigits[ch >> 4] << hexDigits[ch & 0xF];
+				}
+				else {
+					out << *c;
+				}
+			}
+		}
+	}
+}
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer() {
+	// Buffers are owned by the registry so they outlive their thread and can still be dumped
+	thread_local ThreadBuffer* pBuffer = RegisterThread();
+	return *pBuffer;
+}
+
+void Profiler::ThreadBuffer::Snapshot(std::vector<Event>& out) const {
+	const auto end = m_writeIndex.load(std::memory_order_acquire);
+	const auto begin = end > Capacity ? end - Capacity : 0;
+
+	const auto firstOut = out.size();
+	for (auto i = begin; i < end; ++i) {
+		out.push_back(m_events[i & (Capacity - 1)]);
+	}
+
+	// The owning thread kept writing while we copied, drop the entries it may have overwritten. A push
+	// can be under way at endAfterCopy, which writes over the slot of the entry Capacity before it.
+	const auto endAfterCopy = m_writeIndex.load(std::memory_order_acquire);
+	const auto writtenEnd = endAfterCopy + 1;
+	const auto overwritten = writtenEnd > begin + Capacity ? writtenEnd - (begin + Capacity) : 0;
+	if (overwritten) {
+		const auto drop = static_cast<size_t>(std::min<UINT64>(overwritten, end - begin));
+		out.erase(out.begin() + firstOut, out.begin() + firstOut + drop);
+	}
+}
+
+bool Profiler::DumpChromeTrace(const wchar_t* fileName) {
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	const double microsecondsPerTick = 1000000.0 / static_cast<double>(frequency.QuadPart);
+
+	std::vector<std::pair<UINT32, std::vector<Event>>> threads;
+	{
+		std::lock_guard<std::mutex> lock(g_registryMutex);
+		for (const auto& buffer : g_threadBuffers) {
+			threads.emplace_back(buffer->GetThreadId(), std::vector<Event>{});
+			buffer->Snapshot(threads.back().second);
+		}
+	}
+
+	// Rebase timestamps so the trace starts at zero
+	INT64 origin = INT64_MAX;
+	for (const auto& thread : threads) {
+		for (const auto& e : thread.second) {
+			origin = std::min(origin, e.start);
+		}
+	}
+
+	std::ofstream file(fileName, std::ios::out | std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	for (const auto& thread : threads) {
+		for (const auto& e : thread.second) {
+			if (!first) file << ",\n";
+			first = false;
+
+			file << "{\"name\":\"";
+			WriteJsonString(file, e.name);
+			file << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.first
+				<< ",\"ts\":" << static_cast<double>(e.start - origin) * microsecondsPerTick
+				<< ",\"dur\":" << static_cast<double>(e.end - e.start) * microsecondsPerTick
+				<< ",\"args\":{\"depth\":" << e.depth << "}}";
+		}
+	}
+	file << "\n]}\n";
+
+	return file.good();
+}
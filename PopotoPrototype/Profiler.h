@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+
+// Scoped CPU timers, define POPOTO_RELEASE_LITE to compile all scopes out
+#if !defined(POPOTO_RELEASE_LITE)
+#define POPOTO_PROFILING 1
+#endif
+
+namespace Profiler {
+	struct Event {
+		const char* name;	// Must point to a string literal, only the pointer is stored
+		INT64 start;		// QueryPerformanceCounter ticks
+		INT64 end;
+		UINT32 depth;
+	};
+
+	// Single producer ring of finished scopes. Only the owning thread writes, readers copy
+	// the published range and discard whatever may have been overwritten while copying.
+	class ThreadBuffer {
+	public:
+		static constexpr UINT64 Capacity = 1 << 16;
+
+		explicit ThreadBuffer(UINT32 threadId) : m_threadId{ threadId } {}
+
+		void Push(const Event& e) {
+			const auto index = m_writeIndex.load(std::memory_order_relaxed);
+			m_events[index & (Capacity - 1)] = e;
+			m_writeIndex.store(index + 1, std::memory_order_release);
+		}
+
+		// Copies the events that are still resident in the ring
+		void Snapshot(std::vector<Event>& out) const;
+
+		UINT32 GetThreadId() const { return m_threadId; }
+
+		UINT32 m_depth{ 0 };
+
+	private:
+		const UINT32 m_threadId;
+		std::atomic<UINT64> m_writeIndex{ 0 };
+		std::array<Event, Capacity> m_events{};
+	};
+
+	// Buffer of the calling thread, registered on first use
+	ThreadBuffer& GetThreadBuffer();
+
+	inline INT64 Now() {
+		LARGE_INTEGER time;
+		QueryPerformanceCounter(&time);
+		return time.QuadPart;
+	}
+
+	class ScopedTimer {
+	public:
+		explicit ScopedTimer(const char* name) :
+			m_buffer{ GetThreadBuffer() }, m_name{ name }, m_depth{ m_buffer.m_depth++ }, m_start{ Now() } {}
+
+		~ScopedTimer() {
+			m_buffer.Push({ m_name, m_start, Now(), m_depth });
+			--m_buffer.m_depth;
+		}
+
+		// Delete functions
+		ScopedTimer(ScopedTimer const& rhs) = delete;
+		ScopedTimer& operator=(ScopedTimer const& rhs) = delete;
+
+		ScopedTimer(ScopedTimer&& rhs) = delete;
+		ScopedTimer& operator=(ScopedTimer&& rhs) = delete;
+
+	private:
+		ThreadBuffer& m_buffer;
+		const char* const m_name;
+		const UINT32 m_depth;
+		const INT64 m_start;
+	};
+
+	// Writes every resident event of every thread as a chrome://tracing / Perfetto JSON file
+	bool DumpChromeTrace(const wchar_t* fileName);
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if defined(POPOTO_PROFILING)
+#define PROFILE_SCOPE(name) const Profiler::ScopedTimer PROFILE_CONCAT(profileScope_, __LINE__){ name }
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#endif
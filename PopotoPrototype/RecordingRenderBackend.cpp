@@ -0,0 +1,149 @@
+#include "stdafx.h"
+#include "RecordingRenderBackend.h"
+
+RecordingRenderBackend::RecordingRenderBackend(size_t reserveCommands) {
+	m_commands.reserve(reserveCommands);
+}
+
+RecordedCommand& RecordingRenderBackend::Record(RenderCommandType type) {
+	++m_commandCounts[static_cast<size_t>(type)];
+
+	auto& command = m_commands.emplace_back();
+	command.type = type;
+	return command;
+}
+
+void RecordingRenderBackend::Reset(CommandAllocatorHandle /*allocator*/, PipelineHandle initialState) {
+	// Start of a new frame, keep the capacity of the previous stream around
+	m_commands.clear();
+	m_commandCounts.fill(0);
+
+	Record(RenderCommandType::Reset).handles[0] = static_cast<UINT64>(initialState);
+}
+
+void RecordingRenderBackend::Close() {
+	Record(RenderCommandType::Close);
+}
+
+void RecordingRenderBackend::SetDescriptorHeap(DescriptorHeapHandle heap) {
+	Record(RenderCommandType::SetDescriptorHeap).handles[0] = static_cast<UINT64>(heap);
+}
+
+void RecordingRenderBackend::SetGraphicsRootSignature(RootSignatureHandle rootSignature) {
+	Record(RenderCommandType::SetRootSignature).handles[0] = static_cast<UINT64>(rootSignature);
+}
+
+void RecordingRenderBackend::SetPipelineState(PipelineHandle pipelineState) {
+	Record(RenderCommandType::SetPipelineState).handles[0] = static_cast<UINT64>(pipelineState);
+}
+
+void RecordingRenderBackend::IASetPrimitiveTopology(PrimitiveTopology topology) {
+	Record(RenderCommandType::SetPrimitiveTopology).params[0] = static_cast<UINT32>(topology);
+}
+
+void RecordingRenderBackend::IASetVertexBuffer(const VertexBufferBinding& binding) {
+	auto& command = Record(RenderCommandType::SetVertexBuffer);
+	command.params[0] = binding.sizeInBytes;
+	command.params[1] = binding.strideInBytes;
+	command.handles[0] = binding.address;
+}
+
+void RecordingRenderBackend::IASetIndexBuffer(const IndexBufferBinding& binding) {
+	auto& command = Record(RenderCommandType::SetIndexBuffer);
+	command.params[0] = binding.sizeInBytes;
+	command.params[1] = static_cast<UINT32>(binding.format);
+	command.handles[0] = binding.address;
+}
+
+void RecordingRenderBackend::RSSetViewport(const Viewport& viewport) {
+	auto& command = Record(RenderCommandType::SetViewport);
+	command.params[0] = static_cast<UINT32>(viewport.width);
+	command.params[1] = static_cast<UINT32>(viewport.height);
+}
+
+void RecordingRenderBackend::RSSetScissorRect(const ScissorRect& rect) {
+	auto& command = Record(RenderCommandType::SetScissorRect);
+	command.params[0] = static_cast<UINT32>(rect.right - rect.left);
+	command.params[1] = static_cast<UINT32>(rect.bottom - rect.top);
+}
+
+void RecordingRenderBackend::OMSetRenderTargets(const CpuDescriptorHandle* rtv, const CpuDescriptorHandle* dsv) {
+	auto& command = Record(RenderCommandType::SetRenderTargets);
+	command.params[0] = rtv ? 1U : 0U;
+	command.handles[0] = rtv ? rtv->ptr : 0U;
+	command.handles[1] = dsv ? dsv->ptr : 0U;
+}
+
+void RecordingRenderBackend::ClearDepthStencilView(CpuDescriptorHandle dsv, float /*depth*/, UINT8 stencil) {
+	auto& command = Record(RenderCommandType::ClearDepthStencil);
+	command.params[0] = stencil;
+	command.handles[0] = dsv.ptr;
+}
+
+void RecordingRenderBackend::ClearRenderTargetView(CpuDescriptorHandle rtv, const FLOAT /*colour*/[4]) {
+	Record(RenderCommandType::ClearRenderTarget).handles[0] = rtv.ptr;
+}
+
+void RecordingRenderBackend::ResourceBarrier(UINT numBarriers, const ResourceTransition* barriers) {
+	for (UINT i = 0; i < numBarriers; ++i) {
+		auto& command = Record(RenderCommandType::ResourceBarrier);
+		command.params[0] = static_cast<UINT32>(barriers[i].before);
+		command.params[1] = static_cast<UINT32>(barriers[i].after);
+		command.handles[0] = static_cast<UINT64>(barriers[i].resource);
+	}
+}
+
+void RecordingRenderBackend::SetGraphicsRootConstantBufferView(UINT rootIndex, GpuAddress address) {
+	auto& command = Record(RenderCommandType::SetRootConstantBufferView);
+	command.params[0] = rootIndex;
+	command.handles[0] = address;
+}
+
+void RecordingRenderBackend::SetGraphicsRootDescriptorTable(UINT rootIndex, GpuDescriptorHandle handle) {
+	auto& command = Record(RenderCommandType::SetRootDescriptorTable);
+	command.params[0] = rootIndex;
+	command.handles[0] = handle.ptr;
+}
+
+void RecordingRenderBackend::SetGraphicsRootShaderResourceView(UINT rootIndex, GpuAddress address) {
+	auto& command = Record(RenderCommandType::SetRootShaderResourceView);
+	command.params[0] = rootIndex;
+	command.handles[0] = address;
+}
+
+void RecordingRenderBackend::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) {
+	auto& command = Record(RenderCommandType::DrawIndexedInstanced);
+	command.params[0] = indexCount;
+	command.params[1] = instanceCount;
+	command.params[2] = startIndex;
+	command.params[3] = static_cast<UINT32>(baseVertex);
+	command.params[4] = startInstance;
+}
+
+void RecordingRenderBackend::CopyDescriptors(UINT numDescriptors, const CpuDescriptorHandle* dst, const CpuDescriptorHandle* src) {
+	for (UINT i = 0; i < numDescriptors; ++i) {
+		auto& command = Record(RenderCommandType::CopyDescriptor);
+		command.handles[0] = dst[i].ptr;
+		command.handles[1] = src[i].ptr;
+	}
+}
+
+UINT64 RecordingRenderBackend::ComputeDigest() const {
+	// FNV-1a
+	UINT64 hash = 14695981039346656037ULL;
+	const auto accumulate = [&hash](UINT32 value) {
+		for (UINT i = 0; i < 4; ++i) {
+			hash ^= (value >> (i * 8)) & 0xFF;
+			hash *= 1099511628211ULL;
+		}
+	};
+
+	for (const auto& command : m_commands) {
+		accumulate(static_cast<UINT32>(command.type));
+		for (const auto param : command.params) {
+			accumulate(param);
+		}
+	}
+
+	return hash;
+}
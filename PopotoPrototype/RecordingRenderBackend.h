@@ -0,0 +1,93 @@
+#pragma once
+
+#include "RenderBackend.h"
+
+enum class RenderCommandType : UINT8 {
+	Reset,
+	Close,
+	SetDescriptorHeap,
+	SetRootSignature,
+	SetPipelineState,
+	SetPrimitiveTopology,
+	SetVertexBuffer,
+	SetIndexBuffer,
+	SetViewport,
+	SetScissorRect,
+	SetRenderTargets,
+	ClearDepthStencil,
+	ClearRenderTarget,
+	ResourceBarrier,
+	SetRootConstantBufferView,
+	SetRootDescriptorTable,
+	DrawIndexedInstanced,
+	CopyDescriptor,
+	SetRootShaderResourceView,
+	NUM_COMMAND_TYPES
+};
+
+// A single captured command. Barriers and descriptor copies are recorded one per entry.
+struct RecordedCommand {
+	RenderCommandType type{};
+	UINT32 params[5]{};	// Command specific values: root index, sizes, draw arguments, barrier states
+	UINT64 handles[2]{};	// Command specific addresses: GPU VAs, descriptor handles, object handles
+};
+
+// ----------------------------
+// ----Class Definitions----
+// ----------------------------
+
+// Captures the draw, barrier, root CBV and descriptor copy stream into memory.
+// Needs no device, handles are stored as they are and never resolved.
+class RecordingRenderBackend final : public RenderBackend {
+public:
+	explicit RecordingRenderBackend(size_t reserveCommands = 1 << 16);
+
+	void Reset(CommandAllocatorHandle allocator, PipelineHandle initialState) override;
+	void Close() override;
+
+	void SetDescriptorHeap(DescriptorHeapHandle heap) override;
+	void SetGraphicsRootSignature(RootSignatureHandle rootSignature) override;
+	void SetPipelineState(PipelineHandle pipelineState) override;
+
+	void IASetPrimitiveTopology(PrimitiveTopology topology) override;
+	void IASetVertexBuffer(const VertexBufferBinding& binding) override;
+	void IASetIndexBuffer(const IndexBufferBinding& binding) override;
+
+	void RSSetViewport(const Viewport& viewport) override;
+	void RSSetScissorRect(const ScissorRect& rect) override;
+
+	void OMSetRenderTargets(const CpuDescriptorHandle* rtv, const CpuDescriptorHandle* dsv) override;
+	void ClearDepthStencilView(CpuDescriptorHandle dsv, float depth, UINT8 stencil) override;
+	void ClearRenderTargetView(CpuDescriptorHandle rtv, const FLOAT colour[4]) override;
+
+	void ResourceBarrier(UINT numBarriers, const ResourceTransition* barriers) override;
+
+	void SetGraphicsRootConstantBufferView(UINT rootIndex, GpuAddress address) override;
+	void SetGraphicsRootDescriptorTable(UINT rootIndex, GpuDescriptorHandle handle) override;
+	void SetGraphicsRootShaderResourceView(UINT rootIndex, GpuAddress address) override;
+
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) override;
+
+	void CopyDescriptors(UINT numDescriptors, const CpuDescriptorHandle* dst, const CpuDescriptorHandle* src) override;
+
+	// Access to the stream of the last recorded frame
+	const std::vector<RecordedCommand>& GetCommands() const { return m_commands; }
+	UINT GetCommandCount(RenderCommandType type) const { return m_commandCounts[static_cast<size_t>(type)]; }
+
+	// Hash over command types and parameters. Addresses and handles are left out so the digest
+	// is stable between runs and can be compared to catch changes in the submitted stream.
+	UINT64 ComputeDigest() const;
+
+	// Delete functions
+	RecordingRenderBackend(RecordingRenderBackend const& rhs) = delete;
+	RecordingRenderBackend& operator=(RecordingRenderBackend const& rhs) = delete;
+
+	RecordingRenderBackend(RecordingRenderBackend&& rhs) = delete;
+	RecordingRenderBackend& operator=(RecordingRenderBackend&& rhs) = delete;
+
+private:
+	RecordedCommand& Record(RenderCommandType type);
+
+	std::vector<RecordedCommand> m_commands;
+	std::array<UINT, static_cast<size_t>(RenderCommandType::NUM_COMMAND_TYPES)> m_commandCounts{};
+};
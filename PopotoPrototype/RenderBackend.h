@@ -0,0 +1,120 @@
+#pragma once
+
+// ----------------------------
+// ----Handles----
+// ----------------------------
+
+// Objects are passed to the backend as opaque values only the backend recording them resolves,
+// so the interface and the RecordingRenderBackend do not depend on a graphics API
+enum class CommandAllocatorHandle : UINT64 { Null = 0 };
+enum class PipelineHandle : UINT64 { Null = 0 };
+enum class RootSignatureHandle : UINT64 { Null = 0 };
+enum class DescriptorHeapHandle : UINT64 { Null = 0 };
+enum class ResourceHandle : UINT64 { Null = 0 };
+
+using GpuAddress = UINT64;
+
+// Address of a descriptor as seen by the CPU and by the shaders
+struct CpuDescriptorHandle {
+	UINT64 ptr{ 0 };
+};
+
+struct GpuDescriptorHandle {
+	UINT64 ptr{ 0 };
+};
+
+enum class PrimitiveTopology : UINT8 {
+	TriangleList
+};
+
+enum class IndexFormat : UINT8 {
+	UInt16,
+	UInt32
+};
+
+struct VertexBufferBinding {
+	GpuAddress address{ 0 };
+	UINT sizeInBytes{ 0 };
+	UINT strideInBytes{ 0 };
+};
+
+struct IndexBufferBinding {
+	GpuAddress address{ 0 };
+	UINT sizeInBytes{ 0 };
+	IndexFormat format{ IndexFormat::UInt16 };
+};
+
+struct Viewport {
+	float x{ 0.0f };
+	float y{ 0.0f };
+	float width{ 0.0f };
+	float height{ 0.0f };
+	float minDepth{ 0.0f };
+	float maxDepth{ 1.0f };
+};
+
+struct ScissorRect {
+	INT32 left{ 0 };
+	INT32 top{ 0 };
+	INT32 right{ 0 };
+	INT32 bottom{ 0 };
+};
+
+// The states the frame moves its render targets and shadowmaps between
+enum class ResourceState : UINT8 {
+	Present,
+	RenderTarget,
+	DepthWrite,
+	PixelShaderResource
+};
+
+// Transition of every subresource of a resource
+struct ResourceTransition {
+	ResourceHandle resource{ ResourceHandle::Null };
+	ResourceState before{ ResourceState::Present };
+	ResourceState after{ ResourceState::Present };
+};
+
+// ----------------------------
+// ----Class Definitions----
+// ----------------------------
+
+// Thin command recording interface used by the per-frame pipeline.
+// D3DClass, ModelClass and MaterialClass record through this instead of talking
+// to ID3D12GraphicsCommandList directly, so the CPU side of a frame can be run
+// against the RecordingRenderBackend without submitting anything to a GPU.
+class RenderBackend {
+public:
+	virtual ~RenderBackend() = default;
+
+	// Resets the allocator and starts recording a new frame
+	virtual void Reset(CommandAllocatorHandle allocator, PipelineHandle initialState) = 0;
+	virtual void Close() = 0;
+
+	virtual void SetDescriptorHeap(DescriptorHeapHandle heap) = 0;
+	virtual void SetGraphicsRootSignature(RootSignatureHandle rootSignature) = 0;
+	virtual void SetPipelineState(PipelineHandle pipelineState) = 0;
+
+	virtual void IASetPrimitiveTopology(PrimitiveTopology topology) = 0;
+	virtual void IASetVertexBuffer(const VertexBufferBinding& binding) = 0;
+	virtual void IASetIndexBuffer(const IndexBufferBinding& binding) = 0;
+
+	virtual void RSSetViewport(const Viewport& viewport) = 0;
+	virtual void RSSetScissorRect(const ScissorRect& rect) = 0;
+
+	// rtv may be null for depth only passes
+	virtual void OMSetRenderTargets(const CpuDescriptorHandle* rtv, const CpuDescriptorHandle* dsv) = 0;
+	virtual void ClearDepthStencilView(CpuDescriptorHandle dsv, float depth, UINT8 stencil) = 0;
+	virtual void ClearRenderTargetView(CpuDescriptorHandle rtv, const FLOAT colour[4]) = 0;
+
+	virtual void ResourceBarrier(UINT numBarriers, const ResourceTransition* barriers) = 0;
+
+	virtual void SetGraphicsRootConstantBufferView(UINT rootIndex, GpuAddress address) = 0;
+	virtual void SetGraphicsRootDescriptorTable(UINT rootIndex, GpuDescriptorHandle handle) = 0;
+	virtual void SetGraphicsRootShaderResourceView(UINT rootIndex, GpuAddress address) = 0;
+
+	virtual void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) = 0;
+
+	// Copies numDescriptors single CBV/SRV/UAV descriptors from src[i] to dst[i]
+	virtual void CopyDescriptors(UINT numDescriptors, const CpuDescriptorHandle* dst, const CpuDescriptorHandle* src) = 0;
+};
@@ -0,0 +1,344 @@
+#include "stdafx.h"
+#include "SceneCache.h"
+#include "SceneImporter.h"
+#include "MappedFileClass.h"
+#include "Profiler.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace {
+	constexpr UINT32 CacheMagic = 0x4B435050;	// "PPCK"
+	constexpr UINT32 CacheVersion = 7;
+
+	// The vertex and index sections start on a page of their own and hold the meshes back to back,
+	// in the layout of the GPU pools, so each is staged with one copy straight out of the mapping
+	constexpr UINT64 SectionAlignment = 4096;
+
+	// Layout: header, mesh records, material records, names, texture paths, meshlets, levels of detail,
+	// vertices, indices.
+	// Offsets are in bytes from the start of the file.
+	struct FileHeader {
+		UINT32 magic;
+		UINT32 version;
+		UINT64 key;
+		UINT32 meshCount;
+		UINT32 materialCount;
+		UINT64 namesOffset;		// chars
+		UINT64 namesCount;
+		UINT64 pathsOffset;		// wchar_ts
+		UINT64 pathsCount;
+		UINT64 meshletsOffset;
+		UINT64 meshletCount;
+		UINT64 lodsOffset;
+		UINT64 lodCount;
+		UINT64 verticesOffset;
+		UINT64 vertexCount;
+		UINT64 indicesOffset;
+		UINT64 indexCount;
+	};
+
+	// First vertex, index, meshlet and level of detail are relative to their sections, names to the name section
+	struct MeshRecord {
+		UINT64 firstVertex;
+		UINT64 firstIndex;
+		UINT64 firstMeshlet;
+		UINT64 firstLod;
+		UINT32 vertexCount;
+		UINT32 indexCount;
+		UINT32 meshletCount;
+		UINT32 lodCount;
+		UINT32 material;
+		UINT32 nameOffset;
+		UINT32 nameLength;
+		DirectX::XMFLOAT3 boundsMin;
+		DirectX::XMFLOAT3 boundsMax;
+	};
+
+	struct MaterialRecord {
+		UINT32 used;
+		UINT32 pathOffsets[MaterialClass::NUM_TEXTURES_PER_MATERIAL];
+		UINT32 pathLengths[MaterialClass::NUM_TEXTURES_PER_MATERIAL];
+	};
+
+	// FNV-1a
+	constexpr UINT64 FnvOffsetBasis = 14695981039346656037ULL;
+	constexpr UINT64 FnvPrime = 1099511628211ULL;
+
+	UINT64 Accumulate(UINT64 hash, const void* data, UINT64 size) {
+		const auto* bytes = static_cast<const UINT8*>(data);
+		for (UINT64 i = 0; i < size; ++i) {
+			hash ^= bytes[i];
+			hash *= FnvPrime;
+		}
+		return hash;
+	}
+
+	std::wstring Widen(const std::string& text) {
+		return { text.begin(), text.end() };
+	}
+
+	// Section [offset, offset + size) has to lie within the file
+	bool InFile(UINT64 offset, UINT64 size, UINT64 fileSize) {
+		return offset <= fileSize && size <= fileSize - offset;
+	}
+}
+
+UINT64 SceneCache::ComputeKey(const std::string& assetPath, UINT importFlags, bool invertTexY) {
+	PROFILE_SCOPE("SceneCache::ComputeKey");
+
+	MappedFileClass source;
+	if (!source.Open(Widen(assetPath).c_str())) return 0;
+
+	UINT64 hash = Accumulate(FnvOffsetBasis, source.GetData(), source.GetSize());
+
+	// Materials of an .obj live in a sibling file, assumed to share its name
+	const auto extension = assetPath.find_last_of('.');
+	if (source.Open(Widen(assetPath.substr(0, extension).append(".mtl")).c_str())) {
+		hash = Accumulate(hash, source.GetData(), source.GetSize());
+	}
+
+	const UINT32 settings[]{
+		CacheVersion,
+		importFlags,
+		invertTexY ? 1U : 0U,
+		static_cast<UINT32>(sizeof(GeometryClass::Vertex))
+	};
+	hash = Accumulate(hash, settings, sizeof(settings));
+
+	// 0 is reserved for no key
+	return hash ? hash : 1;
+}
+
+std::string SceneCache::GetCachePath(const std::string& assetPath) {
+	return assetPath + ".cooked";
+}
+
+bool SceneCache::Read(const std::string& cachePath, UINT64 key, ImportedScene& scene) {
+	PROFILE_SCOPE("SceneCache::Read");
+
+	// Shared by the views of the meshes, stays mapped until the last of them is released
+	auto file = std::make_shared<MappedFileClass>();
+	if (!file->Open(Widen(cachePath).c_str())) return false;
+
+	const UINT8* data = file->GetData();
+	const UINT64 fileSize = file->GetSize();
+
+	if (fileSize < sizeof(FileHeader)) return false;
+
+	FileHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	if (header.magic != CacheMagic || header.version != CacheVersion || header.key != key) return false;
+
+	const UINT64 meshesOffset = sizeof(FileHeader);
+	const UINT64 materialsOffset = meshesOffset + header.meshCount * sizeof(MeshRecord);
+
+	if (!InFile(meshesOffset, header.meshCount * sizeof(MeshRecord), fileSize) ||
+		!InFile(materialsOffset, header.materialCount * sizeof(MaterialRecord), fileSize) ||
+		!InFile(header.namesOffset, header.namesCount, fileSize) ||
+		!InFile(header.pathsOffset, header.pathsCount * sizeof(wchar_t), fileSize) ||
+		!InFile(header.meshletsOffset, header.meshletCount * sizeof(GeometryClass::Meshlet), fileSize) ||
+		!InFile(header.lodsOffset, header.lodCount * sizeof(GeometryClass::Lod), fileSize) ||
+		!InFile(header.verticesOffset, header.vertexCount * sizeof(GeometryClass::Vertex), fileSize) ||
+		!InFile(header.indicesOffset, header.indexCount * sizeof(UINT32), fileSize) ||
+		header.meshletsOffset % alignof(GeometryClass::Meshlet) || header.lodsOffset % alignof(GeometryClass::Lod) ||
+		header.verticesOffset % SectionAlignment || header.indicesOffset % SectionAlignment) {
+		OutputDebugString(L"Malformed scene cache, importing the source instead.\n");
+		return false;
+	}
+
+	const auto* names = reinterpret_cast<const char*>(data + header.namesOffset);
+	const auto* paths = reinterpret_cast<const wchar_t*>(data + header.pathsOffset);
+	const auto* meshlets = reinterpret_cast<const GeometryClass::Meshlet*>(data + header.meshletsOffset);
+	const auto* lods = reinterpret_cast<const GeometryClass::Lod*>(data + header.lodsOffset);
+	const auto* vertices = reinterpret_cast<const GeometryClass::Vertex*>(data + header.verticesOffset);
+	const auto* indices = reinterpret_cast<const UINT32*>(data + header.indicesOffset);
+
+	// Filled separately so a malformed file leaves scene untouched
+	std::vector<ImportedMaterial> materials(header.materialCount);
+	for (UINT i = 0; i < header.materialCount; ++i) {
+		MaterialRecord record;
+		std::memcpy(&record, data + materialsOffset + i * sizeof(MaterialRecord), sizeof(record));
+
+		auto& material = materials[i];
+		material.used = record.used != 0;
+
+		for (auto j = 0; j < MaterialClass::NUM_TEXTURES_PER_MATERIAL; ++j) {
+			if (!InFile(record.pathOffsets[j], record.pathLengths[j], header.pathsCount)) {
+				OutputDebugString(L"Malformed scene cache, importing the source instead.\n");
+				return false;
+			}
+			material.texturePaths[j].assign(paths + record.pathOffsets[j], record.pathLengths[j]);
+		}
+	}
+
+	std::vector<ImportedMesh> meshes(header.meshCount);
+	for (UINT i = 0; i < header.meshCount; ++i) {
+		MeshRecord record;
+		std::memcpy(&record, data + meshesOffset + i * sizeof(MeshRecord), sizeof(record));
+
+		if (!InFile(record.firstVertex, record.vertexCount, header.vertexCount) ||
+			!InFile(record.firstIndex, record.indexCount, header.indexCount) ||
+			!InFile(record.firstMeshlet, record.meshletCount, header.meshletCount) ||
+			!InFile(record.firstLod, record.lodCount, header.lodCount) ||
+			!InFile(record.nameOffset, record.nameLength, header.namesCount) ||
+			record.material >= header.materialCount) {
+			OutputDebugString(L"Malformed scene cache, importing the source instead.\n");
+			return false;
+		}
+
+		// The levels index into the mesh's own indices
+		const auto* meshLods = lods + record.firstLod;
+		for (UINT lod = 0; lod < record.lodCount; ++lod) {
+			if (!InFile(meshLods[lod].firstIndex, meshLods[lod].indexCount, record.indexCount)) {
+				OutputDebugString(L"Malformed scene cache, importing the source instead.\n");
+				return false;
+			}
+		}
+
+		auto& mesh = meshes[i];
+		mesh.name.assign(names + record.nameOffset, record.nameLength);
+		mesh.material = record.material;
+		mesh.boundsMin = Math::Vector3(record.boundsMin);
+		mesh.boundsMax = Math::Vector3(record.boundsMax);
+
+		mesh.data = {
+			vertices + record.firstVertex, record.vertexCount,
+			indices + record.firstIndex, record.indexCount,
+			meshlets + record.firstMeshlet, record.meshletCount,
+			meshLods, record.lodCount,
+			file };
+	}
+
+	scene.meshes = std::move(meshes);
+	scene.materials = std::move(materials);
+	return true;
+}
+
+bool SceneCache::Write(const std::string& cachePath, UINT64 key, const ImportedScene& scene) {
+	PROFILE_SCOPE("SceneCache::Write");
+
+	std::string names;
+	std::wstring paths;
+
+	std::vector<MeshRecord> meshes(scene.meshes.size());
+	std::vector<MaterialRecord> materials(scene.materials.size());
+
+	UINT64 vertexCount = 0;
+	UINT64 indexCount = 0;
+	UINT64 meshletCount = 0;
+	UINT64 lodCount = 0;
+
+	for (size_t i = 0; i < scene.meshes.size(); ++i) {
+		const auto& mesh = scene.meshes[i];
+		auto& record = meshes[i];
+
+		record.firstVertex = vertexCount;
+		record.firstIndex = indexCount;
+		record.vertexCount = mesh.data.m_vertexCount;
+		record.indexCount = mesh.data.m_indexCount;
+		record.firstMeshlet = meshletCount;
+		record.meshletCount = mesh.data.m_meshletCount;
+		record.firstLod = lodCount;
+		record.lodCount = mesh.data.m_lodCount;
+		record.material = mesh.material;
+		record.nameOffset = static_cast<UINT32>(names.size());
+		record.nameLength = static_cast<UINT32>(mesh.name.size());
+		DirectX::XMStoreFloat3(&record.boundsMin, mesh.boundsMin);
+		DirectX::XMStoreFloat3(&record.boundsMax, mesh.boundsMax);
+
+		names += mesh.name;
+		vertexCount += record.vertexCount;
+		indexCount += record.indexCount;
+		meshletCount += record.meshletCount;
+		lodCount += record.lodCount;
+	}
+
+	for (size_t i = 0; i < scene.materials.size(); ++i) {
+		const auto& material = scene.materials[i];
+		auto& record = materials[i];
+
+		record.used = material.used ? 1U : 0U;
+		for (auto j = 0; j < MaterialClass::NUM_TEXTURES_PER_MATERIAL; ++j) {
+			record.pathOffsets[j] = static_cast<UINT32>(paths.size());
+			record.pathLengths[j] = static_cast<UINT32>(material.texturePaths[j].size());
+			paths += material.texturePaths[j];
+		}
+	}
+
+	FileHeader header{};
+	header.magic = CacheMagic;
+	header.version = CacheVersion;
+	header.key = key;
+	header.meshCount = static_cast<UINT32>(meshes.size());
+	header.materialCount = static_cast<UINT32>(materials.size());
+	header.namesOffset = sizeof(FileHeader) + meshes.size() * sizeof(MeshRecord) + materials.size() * sizeof(MaterialRecord);
+	header.namesCount = names.size();
+	header.pathsOffset = Math::AlignUp(header.namesOffset + names.size(), sizeof(wchar_t));
+	header.pathsCount = paths.size();
+	header.meshletsOffset = Math::AlignUp(header.pathsOffset + paths.size() * sizeof(wchar_t), alignof(GeometryClass::Meshlet));
+	header.meshletCount = meshletCount;
+	header.lodsOffset = Math::AlignUp(header.meshletsOffset + meshletCount * sizeof(GeometryClass::Meshlet), alignof(GeometryClass::Lod));
+	header.lodCount = lodCount;
+	header.verticesOffset = Math::AlignUp(header.lodsOffset + lodCount * sizeof(GeometryClass::Lod), SectionAlignment);
+	header.vertexCount = vertexCount;
+	header.indicesOffset = Math::AlignUp(header.verticesOffset + vertexCount * sizeof(GeometryClass::Vertex), SectionAlignment);
+	header.indexCount = indexCount;
+
+	const std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file) return false;
+
+		const auto pad = [&file](UINT64 offset) {
+			static const char zeros[SectionAlignment]{};
+			file.write(zeros, static_cast<std::streamsize>(offset - static_cast<UINT64>(file.tellp())));
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(meshes.data()), meshes.size() * sizeof(MeshRecord));
+		file.write(reinterpret_cast<const char*>(materials.data()), materials.size() * sizeof(MaterialRecord));
+		file.write(names.data(), names.size());
+
+		pad(header.pathsOffset);
+		file.write(reinterpret_cast<const char*>(paths.data()), paths.size() * sizeof(wchar_t));
+
+		pad(header.meshletsOffset);
+		for (const auto& mesh : scene.meshes) {
+			file.write(reinterpret_cast<const char*>(mesh.data.m_meshlets), mesh.data.m_meshletCount * sizeof(GeometryClass::Meshlet));
+		}
+
+		pad(header.lodsOffset);
+		for (const auto& mesh : scene.meshes) {
+			file.write(reinterpret_cast<const char*>(mesh.data.m_lods), mesh.data.m_lodCount * sizeof(GeometryClass::Lod));
+		}
+
+		pad(header.verticesOffset);
+		for (const auto& mesh : scene.meshes) {
+			file.write(reinterpret_cast<const char*>(mesh.data.m_vertices), mesh.data.m_vertexCount * sizeof(GeometryClass::Vertex));
+		}
+
+		pad(header.indicesOffset);
+		for (const auto& mesh : scene.meshes) {
+			file.write(reinterpret_cast<const char*>(mesh.data.m_indices), mesh.data.m_indexCount * sizeof(UINT32));
+		}
+
+		if (!file) {
+			file.close();
+			DeleteFileW(Widen(tempPath).c_str());
+			return false;
+		}
+	}
+
+	if (!MoveFileExW(Widen(tempPath).c_str(), Widen(cachePath).c_str(), MOVEFILE_REPLACE_EXISTING)) {
+		DeleteFileW(Widen(tempPath).c_str());
+		return false;
+	}
+
+	std::wstringstream t_SStream;
+	t_SStream << L"Scene cache written: " << Widen(cachePath) << L", "
+		<< header.indicesOffset + indexCount * sizeof(UINT32) << L" bytes.\n";
+	OutputDebugString(t_SStream.str().c_str());
+
+	return true;
+}
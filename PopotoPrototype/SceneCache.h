@@ -0,0 +1,25 @@
+#pragma once
+
+struct ImportedScene;
+
+// Cooked copy of an imported scene next to its source file (<scene>.cooked), so later runs map it
+// instead of going through assimp. Holds the converted vertices, indices and meshlets, mesh names,
+// material bindings, texture paths and bounds. Textures are not part of it, they are decoded from their own files.
+//
+// The file is only used when its key matches, the key covers the contents of the source file and its
+// .mtl, the import flags and the vertex layout. Anything else that changes the import output has to
+// bump the version in SceneCache.cpp.
+namespace SceneCache {
+	// Returns 0 when the source file can not be read, no cache is used then
+	UINT64 ComputeKey(const std::string& assetPath, UINT importFlags, bool invertTexY);
+
+	std::string GetCachePath(const std::string& assetPath);
+
+	// Fills scene with the cooked meshes and materials, returns false when the file is missing,
+	// stale or malformed. The meshes view the mapped file and keep it mapped, nothing is copied.
+	// scene.textures is left untouched.
+	bool Read(const std::string& cachePath, UINT64 key, ImportedScene& scene);
+
+	// Writes to a temporary file first, so an interrupted write never leaves a partial cache behind
+	bool Write(const std::string& cachePath, UINT64 key, const ImportedScene& scene);
+};
@@ -0,0 +1,245 @@
+#include "stdafx.h"
+#include "SceneImporter.h"
+#include "ThreadPoolClass.h"
+#include "SceneCache.h"
+#include "MeshProcessing.h"
+#include "GeometryArenaClass.h"
+#include "Profiler.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <array>
+#include <sstream>
+
+namespace {
+	// Part of the cache key, a cooked scene is only used when it was imported with the same flags
+	constexpr UINT ImportFlags = aiProcess_Triangulate | aiProcess_PreTransformVertices | aiProcess_CalcTangentSpace;
+
+	void ConvertMesh(const aiMesh& mesh, bool invertTexY, GeometryClass::Mesh& meshData) {
+		// Written by index into presized arrays, the conversion is the bulk of the work
+		meshData.m_indices.resize(static_cast<size_t>(mesh.mNumFaces) * 3);
+		UINT32* indices = meshData.m_indices.data();
+
+		for (UINT j = 0; j < mesh.mNumFaces; ++j) {
+			const auto& face = mesh.mFaces[j];
+			assert(!(face.mNumIndices % 3));
+
+			// Flip the winding
+			indices[j * 3 + 0] = face.mIndices[1];
+			indices[j * 3 + 1] = face.mIndices[0];
+			indices[j * 3 + 2] = face.mIndices[2];
+		}
+
+		if (!mesh.HasTangentsAndBitangents()) {
+			OutputDebugString(L"No Tangents and Bitangents found, skipping mesh.\n");
+			return;
+		}
+
+		meshData.m_vertices.resize(mesh.mNumVertices);
+		GeometryClass::Vertex* vertices = meshData.m_vertices.data();
+
+		for (UINT j = 0; j < mesh.mNumVertices; ++j) {
+			const auto& vertex = mesh.mVertices[j];
+			const auto& tangent = mesh.mTangents[j];
+			const auto& normal = mesh.mNormals[j];
+			const auto& texcoord = mesh.mTextureCoords[0][j];
+
+			vertices[j] = GeometryClass::Vertex{
+				{ vertex.x, vertex.y, vertex.z },
+				{ normal.x, normal.y, normal.z },
+				{ tangent.x, tangent.y, tangent.z },
+				{ texcoord.x, invertTexY ? (1.0f - texcoord.y) : texcoord.y } };
+		}
+	}
+
+	void ResolveTexturePaths(const aiMaterial& material, const std::string& workingDirectory, ImportedMaterial& importedMaterial) {
+		const aiTextureType usedTextureTypes[]{
+			aiTextureType_DIFFUSE,
+			aiTextureType_HEIGHT,
+			aiTextureType_SPECULAR
+		};
+
+		static_assert(std::extent_v<decltype(usedTextureTypes)> == MaterialClass::NUM_TEXTURES_PER_MATERIAL,
+			"The amount of to load texture types does not equal the amount of textures per material.");
+
+		for (auto j = 0; j < MaterialClass::NUM_TEXTURES_PER_MATERIAL; ++j) {
+			auto& wTexPath = importedMaterial.texturePaths[j];
+			wTexPath = L"assets\\default_normal.dds";
+
+			if (material.GetTextureCount(usedTextureTypes[j])) {
+				aiString aiTexturePath;
+				material.GetTexture(usedTextureTypes[j], 0, &aiTexturePath);
+
+				std::string texPath(aiTexturePath.C_Str());
+				texPath.insert(0, workingDirectory);
+				wTexPath = { texPath.begin(), texPath.end() };
+			}
+			else {
+				switch (usedTextureTypes[j]) {
+				case aiTextureType_DIFFUSE: {
+					wTexPath = L"assets\\default_diffuse.dds";
+					break;
+				}
+				case aiTextureType_HEIGHT: {
+					wTexPath = L"assets\\default_normal.dds";
+					break;
+				}
+				case aiTextureType_SPECULAR: {
+					wTexPath = L"assets\\default_specular.dds";
+					break;
+				}
+				default: {
+					OutputDebugString(L"No Texture found, loading default.\n");
+					break;
+				}}
+			}
+		}
+	}
+}
+
+ImportedScene SceneImporter::Import(
+	Microsoft::WRL::ComPtr<ID3D12Device> device,
+	ThreadPoolClass& threadPool,
+	const std::string& assetPath,
+	bool invertTexY,
+	const std::unordered_set<std::wstring>& loadedTextures,
+	bool useCache) {
+
+	PROFILE_SCOPE("SceneImporter::Import");
+
+	ImportedScene scene;
+
+	const auto cachePath = SceneCache::GetCachePath(assetPath);
+	const auto cacheKey = useCache ? SceneCache::ComputeKey(assetPath, ImportFlags, invertTexY) : 0;
+	const bool cached = cacheKey && SceneCache::Read(cachePath, cacheKey, scene);
+
+	// Without a usable cache the meshes are converted from the assimp scene, which has to stay alive until then
+	Assimp::Importer assetLoader;
+	const aiScene* pScene = nullptr;
+
+	if (!cached) {
+		// Obtain directory of the file
+		const auto found = assetPath.find_last_of("/\\");
+		const auto workingDirectory = assetPath.substr(0, found).append("\\");
+
+		assetLoader.SetPropertyBool(AI_CONFIG_PP_PTV_NORMALIZE, true);
+		assert(assetLoader.ValidateFlags(ImportFlags)); // Throw this shit if the flags don't work
+
+		pScene = assetLoader.ReadFile(assetPath, ImportFlags);
+		if (pScene == nullptr) {
+			OutputDebugString(L"UNABLE TO LOAD ASSET\n");
+			return scene;
+		}
+
+		scene.meshes.resize(pScene->mNumMeshes);
+		scene.materials.resize(pScene->mNumMaterials);
+
+		// Only the materials in use have their texture paths resolved
+		for (UINT i = 0; i < pScene->mNumMeshes; ++i) {
+			const auto& mesh = *pScene->mMeshes[i];
+			scene.meshes[i].name = mesh.mName.C_Str();
+			scene.meshes[i].material = mesh.mMaterialIndex;
+
+			auto& material = scene.materials[mesh.mMaterialIndex];
+			if (material.used) continue;
+
+			material.used = true;
+			ResolveTexturePaths(*pScene->mMaterials[mesh.mMaterialIndex], workingDirectory, material);
+		}
+	}
+
+	const std::string loadedMessage = assetPath + (cached ? " has been loaded from the scene cache. \n" : " has been loaded. \n");
+	OutputDebugString(std::wstring(loadedMessage.begin(), loadedMessage.end()).c_str());
+
+	// The textures to decode in order of first use
+	std::vector<std::wstring> texturePaths;
+	{
+		std::unordered_set<std::wstring> queuedTextures;
+
+		for (const auto& mesh : scene.meshes) {
+			for (const auto& path : scene.materials[mesh.material].texturePaths) {
+				if (!loadedTextures.count(path) && queuedTextures.insert(path).second) {
+					texturePaths.push_back(path);
+				}
+			}
+		}
+	}
+
+	// Textures take longest, they come first so they are picked up before the meshes
+	const auto nTextures = static_cast<UINT>(texturePaths.size());
+	const auto nMeshes = cached ? 0U : static_cast<UINT>(scene.meshes.size());
+	scene.textures.resize(nTextures);
+	std::vector<MeshProcessing::OptimizeStats> meshStats(nMeshes);
+
+	threadPool.ParallelFor(nTextures + nMeshes, [&](UINT item) {
+		if (item < nTextures) {
+			PROFILE_SCOPE("SceneImporter::DecodeTexture");
+			scene.textures[item] = MaterialClass::Texture::Decode(device, texturePaths[item].c_str());
+		}
+		else {
+			PROFILE_SCOPE("SceneImporter::ConvertMesh");
+			const UINT meshIndex = item - nTextures;
+			GeometryClass::Mesh meshData;
+			ConvertMesh(*pScene->mMeshes[meshIndex], invertTexY, meshData);
+			meshStats[meshIndex] = MeshProcessing::Optimize(meshData);
+			MeshProcessing::BuildMeshlets(meshData);
+			MeshProcessing::BuildLods(meshData);
+
+			auto& mesh = scene.meshes[meshIndex];
+			mesh.data = GeometryClass::Share(std::move(meshData));
+			mesh.data.ComputeBounds(mesh.boundsMin, mesh.boundsMax);
+		}
+	});
+
+	if (nMeshes) {
+		std::wstringstream t_SStream;
+		t_SStream << "Mesh optimization, vertices and ACMR before -> after:" << std::endl;
+
+		double missesBefore = 0.0, missesAfter = 0.0;
+		UINT64 triangleCount = 0, verticesBefore = 0, verticesAfter = 0, meshletCount = 0;
+		std::array<UINT64, MeshProcessing::MaxLods> lodTriangles{};
+		UINT meshes16 = 0;
+		for (UINT i = 0; i < nMeshes; ++i) {
+			const auto& mesh = scene.meshes[i];
+			const UINT triangles = mesh.data.m_lodCount ? mesh.data.m_lods[0].indexCount / 3 : mesh.data.m_indexCount / 3;
+			t_SStream << "  " << std::wstring(mesh.name.begin(), mesh.name.end()) << " (" << triangles << " triangles): "
+				<< meshStats[i].verticesBefore << " -> " << meshStats[i].verticesAfter << ", "
+				<< meshStats[i].acmrBefore << " -> " << meshStats[i].acmrAfter << std::endl;
+
+			missesBefore += static_cast<double>(meshStats[i].acmrBefore) * triangles;
+			missesAfter += static_cast<double>(meshStats[i].acmrAfter) * triangles;
+			triangleCount += triangles;
+			verticesBefore += meshStats[i].verticesBefore;
+			verticesAfter += meshStats[i].verticesAfter;
+			meshletCount += mesh.data.m_meshletCount;
+
+			// Meshes count with their simplest level at the levels they do not have
+			for (UINT lod = 0; lod < MeshProcessing::MaxLods; ++lod) {
+				lodTriangles[lod] += lod < mesh.data.m_lodCount ? mesh.data.m_lods[lod].indexCount / 3
+					: mesh.data.m_lodCount ? mesh.data.m_lods[mesh.data.m_lodCount - 1].indexCount / 3 : triangles;
+			}
+			meshes16 += GeometryArenaClass::SelectIndexFormat(mesh.data.m_vertexCount) == DXGI_FORMAT_R16_UINT;
+		}
+
+		if (triangleCount) {
+			t_SStream << "  Scene: " << verticesBefore << " -> " << verticesAfter << " vertices, ACMR "
+				<< (missesBefore / triangleCount) << " -> " << (missesAfter / triangleCount) << ", "
+				<< meshes16 << " of " << nMeshes << " meshes with 16-bit indices, "
+				<< meshletCount << " meshlets" << std::endl;
+			t_SStream << "  Triangles per level of detail:";
+			for (const auto count : lodTriangles) {
+				t_SStream << " " << count;
+			}
+			t_SStream << std::endl;
+		}
+		OutputDebugString(t_SStream.str().c_str());
+	}
+
+	if (!cached && cacheKey && !SceneCache::Write(cachePath, cacheKey, scene)) {
+		OutputDebugString(L"Unable to write the scene cache.\n");
+	}
+
+	return scene;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <unordered_set>
+
+#include "GeometryClass.h"
+#include "MaterialClass.h"
+
+class ThreadPoolClass;
+
+struct ImportedMesh {
+	std::string name;
+	UINT material{ 0 };	// Index into ImportedScene::materials
+	GeometryClass::MeshView data;	// Owns the converted mesh with its meshlets and levels of detail, or views into the mapped scene cache
+	Math::Vector3 boundsMin{ Math::kZero }, boundsMax{ Math::kZero };
+};
+
+struct ImportedMaterial {
+	bool used{ false };	// Only materials used by a mesh have their texture paths resolved
+	std::array<std::wstring, MaterialClass::NUM_TEXTURES_PER_MATERIAL> texturePaths;
+};
+
+struct ImportedScene {
+	std::vector<ImportedMesh> meshes;
+	std::vector<ImportedMaterial> materials;	// Indexed like the assimp materials
+	std::vector<MaterialClass::Texture::Decoded> textures;	// Every distinct path that was not loaded yet, in order of first use
+};
+
+// CPU side of loading a scene file. After the assimp import the vertex conversion of every mesh and
+// the decoding of every texture run in parallel on the thread pool. Nothing of the renderer is
+// touched, so the result is added to the scene afterwards on the thread that owns it.
+// The converted meshes are cooked into a SceneCache file, later imports of the unchanged scene read
+// that instead of running assimp.
+namespace SceneImporter {
+	// Textures whose path is in loadedTextures are referenced by path but not decoded.
+	// Without useCache the scene is always imported with assimp and the cache file is neither read nor written.
+	ImportedScene Import(
+		Microsoft::WRL::ComPtr<ID3D12Device> device,
+		ThreadPoolClass& threadPool,
+		const std::string& assetPath,
+		bool invertTexY,
+		const std::unordered_set<std::wstring>& loadedTextures,
+		bool useCache = true);
+};
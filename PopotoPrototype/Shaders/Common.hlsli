@@ -24,6 +24,26 @@
 
 #include "DefaultLight.hlsli"
 
+#if PACKED_VERTICES
+// VertexFormat::Packed or PackedHalfPosition, normal and tangent are octahedral encoded
+struct VSInput {
+	float4 position : POSITION;
+	float2 normal : NORMAL;
+	float2 tangent : TANGENT;
+	float2 uv : TEXCOORD;
+};
+
+// Inverse of EncodeOctahedral in VertexPacking.cpp
+float3 DecodeOctahedral(float2 encoded) {
+	float3 direction = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	const float fold = saturate(-direction.z);
+	direction.xy += direction.xy >= 0.0f ? -fold : fold;
+	return normalize(direction);
+}
+
+float3 GetNormal(VSInput input) { return DecodeOctahedral(input.normal); }
+float3 GetTangent(VSInput input) { return DecodeOctahedral(input.tangent); }
+#else
 struct VSInput {
 	float4 position : POSITION;
 	float4 normal : NORMAL;
@@ -31,6 +51,10 @@ struct VSInput {
 	float2 uv : TEXCOORD;
 };
 
+float3 GetNormal(VSInput input) { return input.normal.xyz; }
+float3 GetTangent(VSInput input) { return input.tangent.xyz; }
+#endif
+
 struct PSInput {
 	float4 positionH : SV_POSITION;
 	float4 shadowDirectionalPosH : POSITION0;
@@ -41,9 +65,18 @@ struct PSInput {
 	float2 uv : TEXCOORD;
 };
 
+#ifdef INSTANCED
+struct InstanceData {
+	float4x4 worldMat;
+};
+
+// Indexed with SV_InstanceID, bound per instanced draw
+StructuredBuffer<InstanceData> g_instances : register(t0, space1);
+#else
 cbuffer ObjectConstantBuffer : register(b0) {
 	float4x4 worldMat;
 };
+#endif
 
 cbuffer MaterialConstantBuffer : register(b1) {
 	float4 gdiffuseAlbedo;
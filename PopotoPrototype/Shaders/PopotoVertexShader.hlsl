@@ -5,9 +5,13 @@ float4 calculateHPos(float4x4 vpMat, float4x4 worldMat, float4 posL) {
 	return mul(posL, transpose(wvpMat));
 }
 
-PSInput main(VSInput input){
+PSInput main(VSInput input, uint instanceID : SV_InstanceID){
 	PSInput result;
 
+#ifdef INSTANCED
+	const float4x4 worldMat = g_instances[instanceID].worldMat;
+#endif
+
 	float4 posW = mul(input.position, worldMat);
 	result.positionW = posW.xyz;
 
@@ -15,8 +19,8 @@ PSInput main(VSInput input){
 	float4x4 transposedWVP = transpose(wvpMat);
 
 	result.positionH = mul(input.position, transposedWVP);
-	result.normalW = mul(input.normal, worldMat).xyz;
-	result.tangentW = mul(input.tangent, worldMat).xyz;
+	result.normalW = mul(float4(GetNormal(input), 0.0f), worldMat).xyz;
+	result.tangentW = mul(float4(GetTangent(input), 0.0f), worldMat).xyz;
 	result.uv = input.uv;
 
 	//float4x4 shadowDirectionalWvpMat = mul(directionalLightVpMat, worldMat);
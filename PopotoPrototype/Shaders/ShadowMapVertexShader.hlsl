@@ -10,9 +10,13 @@ struct PSInputTrim {
 	float2 uv : TEXCOORD;
 };
 
-PSInputTrim main( VSInputTrim input ) {
+PSInputTrim main( VSInputTrim input, uint instanceID : SV_InstanceID ) {
 	PSInputTrim result;
 
+#ifdef INSTANCED
+	const float4x4 worldMat = g_instances[instanceID].worldMat;
+#endif
+
 	float4x4 wvpMat = mul(lightPassVP, worldMat);
 
 	float4x4 transposedWVP = transpose(wvpMat);
@@ -6,7 +6,7 @@ UINT ShadowMapClass::TOTALSHADOWMAPCOUNT{ 0 };
 ShadowMapClass::ShadowMapClass(Microsoft::WRL::ComPtr<ID3D12Device> device, UINT width, UINT height, BOOL cubemap) :
 	m_device{ device }, m_width{ width }, m_height{ height }, 
 	m_viewport{ 0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f },
-	m_scissorRect{ 0, 0, static_cast<int>(width), static_cast<int>(height) },
+	m_scissorRect{ 0, 0, static_cast<INT32>(width), static_cast<INT32>(height) },
 	m_cubemap(cubemap) {
 	BuildResource();
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "MaterialClass.h"
+#include "RenderBackend.h"
 
 class ShadowMapClass
 {
@@ -32,8 +33,8 @@ public:
 		UINT CBVDescriptorSize,
 		UINT DSVDescriptorSize);
 
-	const D3D12_VIEWPORT m_viewport{};
-	const D3D12_RECT m_scissorRect{};
+	const Viewport m_viewport{};
+	const ScissorRect m_scissorRect{};
 	const BOOL m_cubemap{};
 
 	const Microsoft::WRL::ComPtr<ID3D12Resource> Resource();
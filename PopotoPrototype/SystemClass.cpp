@@ -6,6 +6,8 @@
 #include "SystemClass.h"
 #include "InputClass.h"
 #include "GraphicsClass.h"
+#include "Benchmarks.h"
+#include "Profiler.h"
 
 // Window procedure globals
 namespace FiltyGlobals {
@@ -67,6 +69,8 @@ int SystemClass::Run() {
 }
 
 void SystemClass::Tick() {
+	PROFILE_SCOPE("SystemClass::Tick");
+
 	auto updateLoop = [&] {
 		Update();
 	};
@@ -88,6 +92,23 @@ void SystemClass::Update() {
 		OutputDebugString(t_SStream.str().c_str());
 	}
 
+	if (m_Input->IsKeyDown(VK_F6)) {
+		m_Input->KeyUp(VK_F6);
+		m_Graphics->m_Direct3D->PrintFrameStats();
+	}
+
+	if (m_Input->IsKeyDown(VK_F8)) {
+		m_Input->KeyUp(VK_F8);
+		const bool written = Profiler::DumpChromeTrace(L"popoto_trace.json");
+		OutputDebugString(written ? L"Trace written to popoto_trace.json\n" : L"Unable to write popoto_trace.json\n");
+	}
+
+	if (m_Input->IsKeyDown(VK_F9)) {
+		// Consume the key so the benchmarks only run once per press
+		m_Input->KeyUp(VK_F9);
+		Benchmarks::RunAll(*m_Graphics->m_Direct3D);
+	}
+
 	auto& camera = m_Graphics->m_Direct3D->m_camera;
 
 	// Update and get camera matrices
@@ -0,0 +1,110 @@
+#include "stdafx.h"
+#include "ThreadPoolClass.h"
+
+#include <algorithm>
+
+ThreadPoolClass::ThreadPoolClass(UINT numThreads) {
+	if (numThreads == 0) {
+		numThreads = std::max(1U, std::thread::hardware_concurrency());
+	}
+
+	m_workers.reserve(numThreads - 1);
+	for (UINT i = 1; i < numThreads; ++i) {
+		m_workers.emplace_back([this] { WorkerLoop(); });
+	}
+}
+
+ThreadPoolClass::~ThreadPoolClass() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_workAvailable.notify_all();
+
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+}
+
+void ThreadPoolClass::ParallelFor(UINT count, const std::function<void(UINT)>& body) {
+	if (count == 0) return;
+
+	if (m_workers.empty() || count == 1) {
+		for (UINT i = 0; i < count; ++i) {
+			body(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_body = &body;
+		m_count = count;
+		m_nextItem = 0;
+		m_busyWorkers = static_cast<UINT>(m_workers.size());
+		m_exception = nullptr;
+		++m_generation;
+	}
+	m_workAvailable.notify_all();
+
+	RunItems();
+
+	std::exception_ptr exception;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_workDone.wait(lock, [this] { return m_busyWorkers == 0; });
+
+		m_body = nullptr;
+		std::swap(exception, m_exception);
+	}
+
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+void ThreadPoolClass::WorkerLoop() {
+	// Decoding non DDS textures goes through WIC, which needs COM on every thread using it
+	const bool comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+
+	UINT64 generation = 0;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workAvailable.wait(lock, [&] { return m_stop || m_generation != generation; });
+
+			if (m_stop) break;
+			generation = m_generation;
+		}
+
+		RunItems();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_busyWorkers == 0) {
+				m_workDone.notify_one();
+			}
+		}
+	}
+
+	if (comInitialized) {
+		CoUninitialize();
+	}
+}
+
+void ThreadPoolClass::RunItems() {
+	// m_body and m_count stay unchanged until every thread has left this loop
+	for (UINT i = m_nextItem++; i < m_count; i = m_nextItem++) {
+		try {
+			(*m_body)(i);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_exception) {
+				m_exception = std::current_exception();
+			}
+			m_nextItem = m_count;
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Fixed set of worker threads for loops over independent items. The calling thread takes part
+// in the work, so a pool of one thread runs everything serially on the caller.
+class ThreadPoolClass
+{
+public:
+	// numThreads includes the calling thread, 0 picks one thread per hardware thread
+	explicit ThreadPoolClass(UINT numThreads = 0);
+	~ThreadPoolClass();
+
+	UINT GetThreadCount() const { return static_cast<UINT>(m_workers.size()) + 1U; }
+
+	// Calls body(i) for every i in [0, count) and returns once all calls have returned.
+	// Items are handed out one at a time, so uneven items balance out. The first exception
+	// thrown by body stops the remaining items and is rethrown here.
+	void ParallelFor(UINT count, const std::function<void(UINT)>& body);
+
+	// Delete functions
+	ThreadPoolClass(ThreadPoolClass const& rhs) = delete;
+	ThreadPoolClass& operator=(ThreadPoolClass const& rhs) = delete;
+
+	ThreadPoolClass(ThreadPoolClass&& rhs) = delete;
+	ThreadPoolClass& operator=(ThreadPoolClass&& rhs) = delete;
+
+private:
+	void WorkerLoop();
+	void RunItems();
+
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_workDone;
+
+	// The loop in progress, guarded by m_mutex apart from m_nextItem
+	const std::function<void(UINT)>* m_body{ nullptr };
+	UINT m_count{ 0 };
+	std::atomic<UINT> m_nextItem{ 0 };
+	UINT m_busyWorkers{ 0 };
+	UINT64 m_generation{ 0 };	// Bumped for every loop, wakes the workers
+	bool m_stop{ false };
+	std::exception_ptr m_exception;
+};
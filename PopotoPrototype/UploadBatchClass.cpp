@@ -0,0 +1,230 @@
+#include "stdafx.h"
+#include "UploadBatchClass.h"
+
+using Microsoft::WRL::ComPtr;
+using namespace Utility;
+
+UploadBatchClass::UploadBatchClass(ComPtr<ID3D12Device> device, UINT64 chunkSize) :
+	m_device{ device },
+	m_chunkSize{ chunkSize } {}
+
+UploadBatchClass::Allocation UploadBatchClass::Allocate(UINT64 size, UINT64 alignment) {
+	if (!m_chunks.empty()) {
+		auto& chunk = m_chunks.back();
+		const UINT64 offset = Math::AlignUp(chunk.offset, alignment);
+
+		if (offset + size <= chunk.size) {
+			chunk.offset = offset + size;
+			return { chunk.resource.Get(), chunk.cpuAddress + offset, offset };
+		}
+	}
+
+	// Chunks of earlier batches are reused before new ones are created
+	if (size <= m_chunkSize && !m_freeChunks.empty()) {
+		m_chunks.push_back(std::move(m_freeChunks.back()));
+		m_freeChunks.pop_back();
+		++m_reusedChunkCount;
+
+		auto& reusedChunk = m_chunks.back();
+		reusedChunk.offset = size;
+		return { reusedChunk.resource.Get(), reusedChunk.cpuAddress, 0 };
+	}
+
+	// Oversized uploads get a chunk of their own
+	Chunk chunk{};
+	chunk.size = std::max(m_chunkSize, Math::AlignUp(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+
+	const auto uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	const auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(chunk.size);
+
+	ThrowIfFailed(
+		m_device->CreateCommittedResource(
+			&uploadHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&chunk.resource)));
+	SetNameIndexed(chunk.resource.Get(), L"UploadBatch Chunk", m_chunkCount);
+
+	const auto readRange = CD3DX12_RANGE{ 0, 0 };
+	ThrowIfFailed(chunk.resource->Map(0, &readRange, reinterpret_cast<void**>(&chunk.cpuAddress)));
+
+	chunk.offset = size;
+	++m_chunkCount;
+
+	m_chunks.push_back(std::move(chunk));
+	auto& newChunk = m_chunks.back();
+	return { newChunk.resource.Get(), newChunk.cpuAddress, 0 };
+}
+
+void UploadBatchClass::UploadBuffer(ID3D12Resource* dst, UINT64 dstOffset, const void* data, UINT64 size) {
+	if (size == 0) return;
+
+	std::memcpy(StageBuffer(dst, dstOffset, size), data, static_cast<size_t>(size));
+}
+
+void* UploadBatchClass::StageBuffer(ID3D12Resource* dst, UINT64 dstOffset, UINT64 size) {
+	if (size == 0) return nullptr;
+
+	const auto allocation = Allocate(size, 16);
+
+	m_bufferCopies.push_back({ dst, dstOffset, allocation.resource, allocation.offset, size });
+	m_stagedBytes += size;
+
+	return allocation.cpuAddress;
+}
+
+void UploadBatchClass::CopyBuffer(ID3D12Resource* dst, UINT64 dstOffset, ID3D12Resource* src, UINT64 srcOffset, UINT64 size) {
+	if (size == 0) return;
+
+	m_bufferCopies.push_back({ dst, dstOffset, src, srcOffset, size });
+}
+
+void UploadBatchClass::UploadTexture(ID3D12Resource* dst, const D3D12_SUBRESOURCE_DATA* subresources, UINT numSubresources) {
+	const auto desc = dst->GetDesc();
+
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(numSubresources);
+	std::vector<UINT> numRows(numSubresources);
+	std::vector<UINT64> rowSizes(numSubresources);
+	UINT64 totalSize = 0;
+
+	m_device->GetCopyableFootprints(&desc, 0, numSubresources, 0, footprints.data(), numRows.data(), rowSizes.data(), &totalSize);
+
+	const auto allocation = Allocate(totalSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+	for (UINT i = 0; i < numSubresources; ++i) {
+		auto& footprint = footprints[i];
+
+		const D3D12_MEMCPY_DEST dest{
+			allocation.cpuAddress + footprint.Offset,
+			footprint.Footprint.RowPitch,
+			static_cast<SIZE_T>(footprint.Footprint.RowPitch) * numRows[i]
+		};
+		MemcpySubresource(&dest, &subresources[i], static_cast<SIZE_T>(rowSizes[i]), numRows[i], footprint.Footprint.Depth);
+
+		// Footprints are relative to the allocation, the copy needs the offset in the chunk
+		footprint.Offset += allocation.offset;
+		m_textureCopies.push_back({ dst, i, allocation.resource, footprint });
+	}
+
+	m_stagedBytes += totalSize;
+}
+
+ComPtr<ID3D12Resource> UploadBatchClass::CreateDefaultBuffer(
+	const void* data,
+	UINT64 size,
+	D3D12_RESOURCE_STATES targetState,
+	const wchar_t* name) {
+
+	ComPtr<ID3D12Resource> defaultBuffer;
+	const auto defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	const auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+	ThrowIfFailed(
+		m_device->CreateCommittedResource(
+			&defaultHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&defaultBuffer)));
+	SetName(defaultBuffer.Get(), name);
+
+	UploadBuffer(defaultBuffer.Get(), 0, data, size);
+	AddPostCopyBarrier(CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, targetState));
+
+	return defaultBuffer;
+}
+
+void UploadBatchClass::FreeChunk(Chunk&& chunk) {
+	if (chunk.size == m_chunkSize && m_freeChunks.size() < MaxFreeChunks) {
+		chunk.offset = 0;
+		m_freeChunks.push_back(std::move(chunk));
+	}
+	else {
+		chunk.resource->Unmap(0, nullptr);
+		chunk.resource.Reset();
+	}
+}
+
+void UploadBatchClass::Flush(ID3D12GraphicsCommandList* cmdList, DeferredReleaseQueue& releaseQueue, bool recordBarriers) {
+	RecordCopies(cmdList, releaseQueue, recordBarriers);
+
+	for (auto& chunk : m_chunks) {
+		chunk.resource->Unmap(0, nullptr);
+		releaseQueue.Enqueue(std::move(chunk.resource));
+	}
+	m_chunks.clear();
+}
+
+void UploadBatchClass::Flush(ID3D12GraphicsCommandList* cmdList, UINT64 fenceValue, DeferredReleaseQueue& releaseQueue, bool recordBarriers) {
+	assert(m_retiredChunks.empty() || m_retiredChunks.back().fenceValue <= fenceValue);
+
+	RecordCopies(cmdList, releaseQueue, recordBarriers);
+
+	// The chunks stay mapped while they wait for the copies reading them
+	for (auto& chunk : m_chunks) {
+		if (chunk.size == m_chunkSize) {
+			m_retiredChunks.push_back({ fenceValue, std::move(chunk) });
+		}
+		else {
+			chunk.resource->Unmap(0, nullptr);
+			releaseQueue.Enqueue(std::move(chunk.resource));
+		}
+	}
+	m_chunks.clear();
+}
+
+void UploadBatchClass::RecycleChunks(UINT64 completedFenceValue) {
+	while (!m_retiredChunks.empty() && m_retiredChunks.front().fenceValue <= completedFenceValue) {
+		FreeChunk(std::move(m_retiredChunks.front().chunk));
+		m_retiredChunks.pop_front();
+	}
+}
+
+void UploadBatchClass::RecordCopies(ID3D12GraphicsCommandList* cmdList, DeferredReleaseQueue& releaseQueue, bool recordBarriers) {
+	if (recordBarriers && !m_preCopyBarriers.empty()) {
+		cmdList->ResourceBarrier(static_cast<UINT>(m_preCopyBarriers.size()), m_preCopyBarriers.data());
+	}
+
+	for (const auto& copy : m_bufferCopies) {
+		cmdList->CopyBufferRegion(copy.dst, copy.dstOffset, copy.src, copy.srcOffset, copy.size);
+	}
+
+	for (const auto& copy : m_textureCopies) {
+		const CD3DX12_TEXTURE_COPY_LOCATION dst{ copy.dst, copy.subresource };
+		const CD3DX12_TEXTURE_COPY_LOCATION src{ copy.src, copy.footprint };
+		cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+	}
+
+	if (recordBarriers && !m_postCopyBarriers.empty()) {
+		cmdList->ResourceBarrier(static_cast<UINT>(m_postCopyBarriers.size()), m_postCopyBarriers.data());
+	}
+
+	m_copyCount += static_cast<UINT>(m_bufferCopies.size() + m_textureCopies.size());
+
+	for (auto& resource : m_keepAlive) {
+		releaseQueue.Enqueue(std::move(resource));
+	}
+
+	m_bufferCopies.clear();
+	m_textureCopies.clear();
+	m_preCopyBarriers.clear();
+	m_postCopyBarriers.clear();
+	m_keepAlive.clear();
+}
+
+void UploadBatchClass::Discard() {
+	// Nothing was recorded from the chunks, so they are free already
+	for (auto& chunk : m_chunks) {
+		FreeChunk(std::move(chunk));
+	}
+
+	m_chunks.clear();
+	m_bufferCopies.clear();
+	m_textureCopies.clear();
+	m_preCopyBarriers.clear();
+	m_postCopyBarriers.clear();
+	m_keepAlive.clear();
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+
+#include "DeferredReleaseQueue.h"
+
+// Packs the staging data of many buffer and texture uploads into a few large upload chunks.
+// The copies are only recorded by Flush, all together, with one barrier group before and one after,
+// so a scene load creates a handful of upload resources and submits one contiguous copy stream.
+// A batch that is flushed again and again can keep its chunks, they form a ring that is reused
+// once the GPU has passed the submissions reading them.
+class UploadBatchClass
+{
+public:
+	UploadBatchClass(Microsoft::WRL::ComPtr<ID3D12Device> device, UINT64 chunkSize = 32ULL * 1024ULL * 1024ULL);
+
+	// Stages size bytes of data for dst, which has to be in the copy destination state when the copies execute
+	void UploadBuffer(ID3D12Resource* dst, UINT64 dstOffset, const void* data, UINT64 size);
+
+	// Same, but returns the staging memory for the caller to fill, for data that is converted on its way.
+	// The memory is write combined, it should be written sequentially and never read.
+	void* StageBuffer(ID3D12Resource* dst, UINT64 dstOffset, UINT64 size);
+
+	// GPU side copy between two buffers, recorded in order with the uploads. Stages nothing,
+	// src has to hold its data by the time the copies execute.
+	void CopyBuffer(ID3D12Resource* dst, UINT64 dstOffset, ID3D12Resource* src, UINT64 srcOffset, UINT64 size);
+
+	// Stages every subresource of dst, laid out as GetCopyableFootprints requires
+	void UploadTexture(ID3D12Resource* dst, const D3D12_SUBRESOURCE_DATA* subresources, UINT numSubresources);
+
+	// Creates a default heap buffer that holds data and is in targetState once the batch has executed
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
+		const void* data,
+		UINT64 size,
+		D3D12_RESOURCE_STATES targetState,
+		const wchar_t* name);
+
+	// Barriers recorded right before and right after the copies
+	void AddPreCopyBarrier(const D3D12_RESOURCE_BARRIER& barrier) { m_preCopyBarriers.push_back(barrier); }
+	void AddPostCopyBarrier(const D3D12_RESOURCE_BARRIER& barrier) { m_postCopyBarriers.push_back(barrier); }
+
+	// Resources the recorded copies still reference, released together with the staging chunks
+	void KeepAlive(Microsoft::WRL::ComPtr<ID3D12Resource> resource) { m_keepAlive.push_back(std::move(resource)); }
+
+	// Records the batched barriers and copies. The staging chunks go to releaseQueue, which frees
+	// them once the submission containing cmdList has completed.
+	// Lists of a copy queue leave the barriers out, see D3D12CopyQueue.
+	void Flush(ID3D12GraphicsCommandList* cmdList, DeferredReleaseQueue& releaseQueue, bool recordBarriers = true);
+
+	// Same, but the batch keeps its staging chunks and hands them out again after RecycleChunks
+	// has seen fenceValue complete, the value signaled after the submission containing cmdList.
+	// Oversized chunks still go to releaseQueue.
+	void Flush(ID3D12GraphicsCommandList* cmdList, UINT64 fenceValue, DeferredReleaseQueue& releaseQueue, bool recordBarriers = true);
+
+	// Moves the chunks of every submission up to completedFenceValue to the free list
+	void RecycleChunks(UINT64 completedFenceValue);
+
+	// Drops everything staged without recording it, its chunks can be reused right away
+	void Discard();
+
+	// Totals since construction. Chunks counts the upload resources created, reused ones are counted apart.
+	UINT GetChunkCount() const { return m_chunkCount; }
+	UINT GetReusedChunkCount() const { return m_reusedChunkCount; }
+	UINT64 GetStagedBytes() const { return m_stagedBytes; }
+	UINT GetCopyCount() const { return m_copyCount; }
+
+	// Delete functions
+	UploadBatchClass(UploadBatchClass const& rhs) = delete;
+	UploadBatchClass& operator=(UploadBatchClass const& rhs) = delete;
+
+	UploadBatchClass(UploadBatchClass&& rhs) = delete;
+	UploadBatchClass& operator=(UploadBatchClass&& rhs) = delete;
+
+private:
+	struct Chunk {
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		UINT8* cpuAddress;
+		UINT64 size;
+		UINT64 offset;	// Start of the free space
+	};
+
+	struct RetiredChunk {
+		UINT64 fenceValue;
+		Chunk chunk;
+	};
+
+	struct Allocation {
+		ID3D12Resource* resource;
+		UINT8* cpuAddress;
+		UINT64 offset;
+	};
+
+	struct BufferCopy {
+		ID3D12Resource* dst;
+		UINT64 dstOffset;
+		ID3D12Resource* src;
+		UINT64 srcOffset;
+		UINT64 size;
+	};
+
+	struct TextureCopy {
+		ID3D12Resource* dst;
+		UINT subresource;
+		ID3D12Resource* src;
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+	};
+
+	// Takes space from the current chunk, or starts a new one of at least size bytes
+	Allocation Allocate(UINT64 size, UINT64 alignment);
+
+	// Records the copies and barriers, then clears everything staged except the chunks
+	void RecordCopies(ID3D12GraphicsCommandList* cmdList, DeferredReleaseQueue& releaseQueue, bool recordBarriers);
+
+	// Puts a chunk nothing reads anymore on the free list, or releases it when the list is full
+	void FreeChunk(Chunk&& chunk);
+
+	// Chunks beyond this are released instead of kept on the free list
+	static constexpr size_t MaxFreeChunks = 4;
+
+	const Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	const UINT64 m_chunkSize;
+
+	std::vector<Chunk> m_chunks;
+	std::deque<RetiredChunk> m_retiredChunks;	// Ascending fence values
+	std::vector<Chunk> m_freeChunks;		// Mapped and unused, all m_chunkSize bytes
+	std::vector<BufferCopy> m_bufferCopies;
+	std::vector<TextureCopy> m_textureCopies;
+	std::vector<D3D12_RESOURCE_BARRIER> m_preCopyBarriers;
+	std::vector<D3D12_RESOURCE_BARRIER> m_postCopyBarriers;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_keepAlive;
+
+	UINT m_chunkCount{ 0 };
+	UINT m_reusedChunkCount{ 0 };
+	UINT64 m_stagedBytes{ 0 };
+	UINT m_copyCount{ 0 };
+};
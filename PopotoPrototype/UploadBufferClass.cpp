@@ -0,0 +1,162 @@
+#include "stdafx.h"
+#include "UploadBufferClass.h"
+
+using Microsoft::WRL::ComPtr;
+using namespace Utility;
+
+UploadBufferClass::UploadBufferClass(ID3D12Device* device, UINT64 size, const wchar_t* name) :
+	m_size{ size } {
+
+	const auto uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	const auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+	ThrowIfFailed(
+		device->CreateCommittedResource(
+			&uploadHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&m_resource)
+		)
+	);
+	SetName(m_resource.Get(), name);
+
+	// The CPU never reads from it
+	const auto readRange = CD3DX12_RANGE{ 0, 0 };
+	ThrowIfFailed(m_resource->Map(0, &readRange, reinterpret_cast<void**>(&m_cpuAddress)));
+}
+
+UploadBufferClass::~UploadBufferClass() {
+	if (m_resource) {
+		m_resource->Unmap(0, nullptr);
+	}
+}
+
+UploadRingBuffer::UploadRingBuffer(ComPtr<ID3D12Device> device, UINT64 initialSize, const wchar_t* name) :
+	m_device{ device },
+	m_name{ name },
+	m_buffer{ std::make_unique<UploadBufferClass>(device.Get(), Math::AlignUp(initialSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT), name) } {}
+
+void UploadRingBuffer::BeginFrame(UINT64 completedFenceValue) {
+	// Roll back a frame that was recorded but never ended
+	if (m_frameBytes) {
+		m_head = m_frameStart;
+		m_usedBytes -= m_frameBytes;
+		m_frameBytes = 0;
+	}
+
+	// Buffers replaced during such a frame only hold data of frames that were submitted before it
+	for (auto& retired : m_retiredBuffers) {
+		if (retired.fenceValue == PendingFence) {
+			retired.fenceValue = m_lastFenceValue;
+		}
+	}
+
+	while (!m_frames.empty() && m_frames.front().fenceValue <= completedFenceValue) {
+		m_tail = m_frames.front().end;
+		m_usedBytes -= m_frames.front().bytes;
+		m_frames.pop_front();
+	}
+
+	m_retiredBuffers.erase(
+		std::remove_if(m_retiredBuffers.begin(), m_retiredBuffers.end(),
+			[&](const RetiredBuffer& retired) { return retired.fenceValue <= completedFenceValue; }),
+		m_retiredBuffers.end());
+
+	if (m_usedBytes == 0) {
+		m_head = m_tail = 0;
+	}
+
+	m_frameStart = m_head;
+}
+
+void UploadRingBuffer::EndFrame(UINT64 fenceValue) {
+	if (m_frameBytes) {
+		m_frames.push_back({ fenceValue, m_head, m_frameBytes });
+	}
+
+	for (auto& retired : m_retiredBuffers) {
+		if (retired.fenceValue == PendingFence) {
+			retired.fenceValue = fenceValue;
+		}
+	}
+
+	m_lastFenceValue = fenceValue;
+	m_frameBytes = 0;
+	m_frameStart = m_head;
+}
+
+UploadRingBuffer::Allocation UploadRingBuffer::Allocate(UINT64 size, UINT64 alignment) {
+	size = Math::AlignUp(size, alignment);
+
+	UINT64 offset;
+	if (!TryAllocate(size, alignment, offset)) {
+		Grow(size);
+		const bool allocated = TryAllocate(size, alignment, offset);
+		assert(allocated);
+	}
+
+	return { m_buffer->GetCPUAddress() + offset, m_buffer->GetGPUAddress() + offset };
+}
+
+bool UploadRingBuffer::TryAllocate(UINT64 size, UINT64 alignment, UINT64& offset) {
+	const UINT64 bufferSize = m_buffer->GetSize();
+	const UINT64 alignedHead = Math::AlignUp(m_head, alignment);
+
+	UINT64 consumed;
+
+	if (m_usedBytes == 0) {
+		if (size > bufferSize) return false;
+		m_head = m_tail = m_frameStart = 0;
+		offset = 0;
+		consumed = size;
+	}
+	else if (m_head > m_tail) {
+		// Free space is [head, end) followed by [0, tail)
+		if (alignedHead + size <= bufferSize) {
+			offset = alignedHead;
+			consumed = alignedHead + size - m_head;
+		}
+		else if (size <= m_tail) {
+			// Wrap around, the end of the buffer is skipped
+			offset = 0;
+			consumed = bufferSize - m_head + size;
+		}
+		else {
+			return false;
+		}
+	}
+	else if (m_head < m_tail) {
+		// Free space is [head, tail)
+		if (alignedHead + size > m_tail) return false;
+		offset = alignedHead;
+		consumed = alignedHead + size - m_head;
+	}
+	else {
+		// Head caught up with the tail, the ring is full
+		return false;
+	}
+
+	m_head = offset + size;
+	m_usedBytes += consumed;
+	m_frameBytes += consumed;
+	return true;
+}
+
+void UploadRingBuffer::Grow(UINT64 minimumSize) {
+	const UINT64 newSize = Math::AlignUp(std::max(m_buffer->GetSize() * 2, minimumSize * 2), D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+	// Everything in the old buffer is owned by frames in flight and the current one
+	m_retiredBuffers.push_back({ PendingFence, std::move(m_buffer) });
+	m_buffer = std::make_unique<UploadBufferClass>(m_device.Get(), newSize, m_name.c_str());
+
+	m_frames.clear();
+	m_head = m_tail = m_frameStart = 0;
+	m_usedBytes = 0;
+	m_frameBytes = 0;
+
+	std::wstringstream t_SStream;
+	t_SStream << m_name << " grown to " << newSize << " bytes" << std::endl;
+	OutputDebugString(t_SStream.str().c_str());
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+
+// Upload heap buffer that stays mapped for its whole lifetime
+class UploadBufferClass
+{
+public:
+	UploadBufferClass(ID3D12Device* device, UINT64 size, const wchar_t* name);
+	~UploadBufferClass();
+
+	UINT8* GetCPUAddress() const { return m_cpuAddress; }
+	D3D12_GPU_VIRTUAL_ADDRESS GetGPUAddress() const { return m_resource->GetGPUVirtualAddress(); }
+	UINT64 GetSize() const { return m_size; }
+	ID3D12Resource* GetResource() const { return m_resource.Get(); }
+
+	// Delete functions
+	UploadBufferClass(UploadBufferClass const& rhs) = delete;
+	UploadBufferClass& operator=(UploadBufferClass const& rhs) = delete;
+
+	UploadBufferClass(UploadBufferClass&& rhs) = delete;
+	UploadBufferClass& operator=(UploadBufferClass&& rhs) = delete;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_resource;
+	UINT8* m_cpuAddress{ nullptr };
+	const UINT64 m_size;
+};
+
+// Hands out short lived sub-allocations of upload memory, used for data that is rewritten every frame.
+// Allocations of a frame stay untouched until the GPU has passed the fence value given to EndFrame.
+// When the ring runs out of space it is replaced by one twice the size, the old buffer is released
+// once the GPU no longer reads from it.
+class UploadRingBuffer
+{
+public:
+	struct Allocation {
+		UINT8* cpuAddress;
+		D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;
+	};
+
+	UploadRingBuffer(Microsoft::WRL::ComPtr<ID3D12Device> device, UINT64 initialSize, const wchar_t* name);
+
+	// Frees the memory of every frame the GPU has completed. Allocations made since the last EndFrame
+	// belong to a frame that was never submitted and are discarded as well.
+	void BeginFrame(UINT64 completedFenceValue);
+
+	// The allocations made since BeginFrame are in use until the GPU passes fenceValue
+	void EndFrame(UINT64 fenceValue);
+
+	Allocation Allocate(UINT64 size, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+	// Copies data into a new constant buffer sized allocation and returns its GPU address
+	template<typename T>
+	D3D12_GPU_VIRTUAL_ADDRESS Push(const T& data) {
+		const auto allocation = Allocate(sizeof(T));
+		std::memcpy(allocation.cpuAddress, &data, sizeof(T));
+		return allocation.gpuAddress;
+	}
+
+	UINT64 GetSize() const { return m_buffer->GetSize(); }
+	UINT64 GetBytesAllocatedThisFrame() const { return m_frameBytes; }
+
+	// Delete functions
+	UploadRingBuffer(UploadRingBuffer const& rhs) = delete;
+	UploadRingBuffer& operator=(UploadRingBuffer const& rhs) = delete;
+
+	UploadRingBuffer(UploadRingBuffer&& rhs) = delete;
+	UploadRingBuffer& operator=(UploadRingBuffer&& rhs) = delete;
+
+private:
+	bool TryAllocate(UINT64 size, UINT64 alignment, UINT64& offset);
+	void Grow(UINT64 minimumSize);
+
+	struct FrameRange {
+		UINT64 fenceValue;
+		UINT64 end;		// Head of the ring when the frame ended
+		UINT64 bytes;	// Bytes consumed by the frame, including alignment and wrap padding
+	};
+
+	struct RetiredBuffer {
+		UINT64 fenceValue;
+		std::unique_ptr<UploadBufferClass> buffer;
+	};
+
+	static constexpr UINT64 PendingFence = UINT64_MAX;
+
+	const Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	const std::wstring m_name;
+	std::unique_ptr<UploadBufferClass> m_buffer;
+
+	UINT64 m_head{ 0 };
+	UINT64 m_tail{ 0 };
+	UINT64 m_usedBytes{ 0 };
+
+	UINT64 m_frameStart{ 0 };
+	UINT64 m_frameBytes{ 0 };
+	UINT64 m_lastFenceValue{ 0 };
+
+	std::deque<FrameRange> m_frames;
+	std::vector<RetiredBuffer> m_retiredBuffers;
+};
+
+// A fixed constant buffer slot per element, with a separate copy for every frame in flight so a
+// slot can be rewritten while the GPU still reads the copy of an earlier frame.
+template<typename T, UINT NumFrames>
+class ConstantBufferArray
+{
+public:
+	static constexpr UINT64 SlotSize = Math::AlignUp(sizeof(T), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+	ConstantBufferArray(Microsoft::WRL::ComPtr<ID3D12Device> device, const wchar_t* name) :
+		m_device{ device }, m_name{ name } {}
+
+	// Grows every copy to at least count slots, existing contents are kept.
+	// The replaced buffers are released once the GPU has passed fenceValue.
+	void Reserve(UINT count, UINT64 fenceValue) {
+		if (count <= m_capacity) return;
+
+		const UINT newCapacity = std::max(count, m_capacity * 2U);
+
+		for (UINT frame = 0; frame < NumFrames; ++frame) {
+			auto buffer = std::make_unique<UploadBufferClass>(m_device.Get(), newCapacity * SlotSize, m_name.c_str());
+
+			if (m_buffers[frame]) {
+				std::memcpy(buffer->GetCPUAddress(), m_buffers[frame]->GetCPUAddress(), m_capacity * SlotSize);
+				m_retiredBuffers.push_back({ fenceValue, std::move(m_buffers[frame]) });
+			}
+
+			m_buffers[frame] = std::move(buffer);
+		}
+
+		m_capacity = newCapacity;
+	}
+
+	void ReleaseRetired(UINT64 completedFenceValue) {
+		m_retiredBuffers.erase(
+			std::remove_if(m_retiredBuffers.begin(), m_retiredBuffers.end(),
+				[&](const RetiredBuffer& retired) { return retired.fenceValue <= completedFenceValue; }),
+			m_retiredBuffers.end());
+	}
+
+	void Write(UINT frame, UINT slot, const T& data) {
+		assert(slot < m_capacity);
+		std::memcpy(m_buffers[frame]->GetCPUAddress() + slot * SlotSize, &data, sizeof(T));
+	}
+
+	D3D12_GPU_VIRTUAL_ADDRESS GetGPUAddress(UINT frame, UINT slot) const {
+		assert(slot < m_capacity);
+		return m_buffers[frame]->GetGPUAddress() + slot * SlotSize;
+	}
+
+	UINT GetCapacity() const { return m_capacity; }
+
+	// Delete functions
+	ConstantBufferArray(ConstantBufferArray const& rhs) = delete;
+	ConstantBufferArray& operator=(ConstantBufferArray const& rhs) = delete;
+
+	ConstantBufferArray(ConstantBufferArray&& rhs) = delete;
+	ConstantBufferArray& operator=(ConstantBufferArray&& rhs) = delete;
+
+private:
+	struct RetiredBuffer {
+		UINT64 fenceValue;
+		std::unique_ptr<UploadBufferClass> buffer;
+	};
+
+	const Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	const std::wstring m_name;
+	UINT m_capacity{ 0 };
+	std::array<std::unique_ptr<UploadBufferClass>, NumFrames> m_buffers;
+	std::vector<RetiredBuffer> m_retiredBuffers;
+};
@@ -11,6 +11,7 @@ namespace Utility {
 			Material,
 			Light,
 			MainPass,
+			Instances,
 			NUM_ROOTPARAMETERS
 		};
 	};
@@ -24,6 +25,14 @@ namespace Utility {
 		};
 	};
 
+	// Register spaces of the shader resources, instanced draws read their per instance data from the second
+	namespace SRVShaderSpace {
+		enum : UINT {
+			Material,
+			Instances
+		};
+	};
+
 	// Access memory blocks as objects with N-byte alignment
 	template<typename T, size_t alignment = 256, size_t Size = Math::AlignUp(sizeof(T), alignment)>
 	struct PaddedBlock {
@@ -55,6 +64,17 @@ namespace Utility {
 		};
 	};
 
+	// Takes the most recently freed id, or the next one after total when none is free. Ids stay dense,
+	// so arrays indexed by them never need more than total entries.
+	inline UINT AcquireId(UINT& total, std::vector<UINT>& freeIds) {
+		if (freeIds.empty()) {
+			return total++;
+		}
+		const UINT id = freeIds.back();
+		freeIds.pop_back();
+		return id;
+	}
+
 	inline void ThrowIfFailed(HRESULT hr)
 	{
 		if (FAILED(hr))
@@ -91,57 +111,4 @@ namespace Utility {
 #define NAME_D3D12_RES(x) SetName(x.Get(), L#x)
 #define NAME_D3D12_RES_INDEXED(x, n) SetNameIndexed(x[n].Get(), L#x, n)
 
-	inline Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
-		ID3D12Device* device,
-		ID3D12GraphicsCommandList* cmdList,
-		const void* initData,
-		UINT64 byteSize,
-		Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer,
-		D3D12_RESOURCE_STATES targetState)
-	{
-		const auto defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-		const auto uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-
-		Microsoft::WRL::ComPtr<ID3D12Resource> defaultBuffer;
-		const auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
-
-		// Construct the defaultbuffer
-		ThrowIfFailed(
-			device->CreateCommittedResource(
-				&defaultHeapProperties,
-				D3D12_HEAP_FLAG_NONE,
-				&bufferDesc,
-				D3D12_RESOURCE_STATE_COPY_DEST,
-				nullptr,
-				IID_PPV_ARGS(&defaultBuffer)));
-		NAME_D3D12_RES(defaultBuffer);
-
-		// Construct the uploadbuffer
-		ThrowIfFailed(
-			device->CreateCommittedResource(
-				&uploadHeapProperties,
-				D3D12_HEAP_FLAG_NONE,
-				&bufferDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&uploadBuffer)));
-		NAME_D3D12_RES(uploadBuffer);
-
-		// Create a description of the to be copied data
-		D3D12_SUBRESOURCE_DATA subResourceData{};
-		subResourceData.pData = initData;
-		subResourceData.RowPitch = byteSize;
-		subResourceData.SlicePitch = subResourceData.RowPitch;
-
-		// Schedule a copy from the upload to the defaultheap
-		const auto transitionBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-			defaultBuffer.Get(),
-			D3D12_RESOURCE_STATE_COPY_DEST,
-			targetState/*D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER*/);
-
-		UpdateSubresources<1>(cmdList, defaultBuffer.Get(), uploadBuffer.Get(), 0, 0, 1, &subResourceData);
-		cmdList->ResourceBarrier(1, &transitionBarrier);
-
-		return defaultBuffer;
-	}
 } // namespace Utility
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "stdafx.h"
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <DirectXPackedVector.h>
+
+using DirectX::PackedVector::XMConvertFloatToHalf;
+using DirectX::PackedVector::XMConvertHalfToFloat;
+
+namespace {
+	const D3D12_INPUT_ELEMENT_DESC FullLayout[]{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 16,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,	  0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+
+	// A position with three components is expanded with w = 1 by the input assembler
+	const D3D12_INPUT_ELEMENT_DESC PackedLayout[]{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(VertexPacking::PackedVertex, position), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(VertexPacking::PackedVertex, normal), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(VertexPacking::PackedVertex, tangent), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, offsetof(VertexPacking::PackedVertex, uv), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+
+	const D3D12_INPUT_ELEMENT_DESC PackedHalfPositionLayout[]{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, offsetof(VertexPacking::PackedVertexHalfPosition, position), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(VertexPacking::PackedVertexHalfPosition, normal), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(VertexPacking::PackedVertexHalfPosition, tangent), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, offsetof(VertexPacking::PackedVertexHalfPosition, uv), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+
+	float SignNotZero(float value) {
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	INT16 ToSnorm16(float value) {
+		return static_cast<INT16>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	float FromSnorm16(INT16 value) {
+		return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+	}
+
+	// Projects the direction onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the upper one
+	void EncodeOctahedral(const Math::Vector3& direction, INT16 (&encoded)[2]) {
+		DirectX::XMFLOAT3 d;
+		DirectX::XMStoreFloat3(&d, direction);
+
+		const float length = std::abs(d.x) + std::abs(d.y) + std::abs(d.z);
+		if (length == 0.0f) {
+			encoded[0] = encoded[1] = 0;
+			return;
+		}
+
+		float x = d.x / length;
+		float y = d.y / length;
+
+		if (d.z < 0.0f) {
+			const float foldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+			const float foldedY = (1.0f - std::abs(x)) * SignNotZero(y);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		encoded[0] = ToSnorm16(x);
+		encoded[1] = ToSnorm16(y);
+	}
+
+	// Same as DecodeOctahedral in Common.hlsli
+	Math::Vector3 DecodeOctahedral(const INT16 (&encoded)[2]) {
+		float x = FromSnorm16(encoded[0]);
+		float y = FromSnorm16(encoded[1]);
+		const float z = 1.0f - std::abs(x) - std::abs(y);
+
+		const float fold = std::max(-z, 0.0f);
+		x += x >= 0.0f ? -fold : fold;
+		y += y >= 0.0f ? -fold : fold;
+
+		return Math::Normalize(Math::Vector3(x, y, z));
+	}
+
+	template<typename PackedT>
+	void PackShared(const GeometryClass::Vertex& vertex, PackedT& packed) {
+		EncodeOctahedral(vertex.m_normal, packed.normal);
+		EncodeOctahedral(vertex.m_tangent, packed.tangent);
+		packed.uv[0] = XMConvertFloatToHalf(vertex.m_uv.x);
+		packed.uv[1] = XMConvertFloatToHalf(vertex.m_uv.y);
+	}
+
+	void PackVertex(const GeometryClass::Vertex& vertex, VertexPacking::PackedVertex& packed) {
+		DirectX::XMStoreFloat3(&packed.position, vertex.m_position);
+		PackShared(vertex, packed);
+	}
+
+	void PackVertex(const GeometryClass::Vertex& vertex, VertexPacking::PackedVertexHalfPosition& packed) {
+		DirectX::XMFLOAT3 position;
+		DirectX::XMStoreFloat3(&position, vertex.m_position);
+
+		packed.position[0] = XMConvertFloatToHalf(position.x);
+		packed.position[1] = XMConvertFloatToHalf(position.y);
+		packed.position[2] = XMConvertFloatToHalf(position.z);
+		packed.position[3] = XMConvertFloatToHalf(1.0f);
+		PackShared(vertex, packed);
+	}
+
+	template<typename PackedT>
+	GeometryClass::Vertex UnpackShared(const PackedT& packed, const Math::Vector3& position) {
+		return GeometryClass::Vertex{
+			position,
+			DecodeOctahedral(packed.normal),
+			DecodeOctahedral(packed.tangent),
+			{ XMConvertHalfToFloat(packed.uv[0]), XMConvertHalfToFloat(packed.uv[1]) } };
+	}
+
+	GeometryClass::Vertex UnpackVertex(const VertexPacking::PackedVertex& packed) {
+		return UnpackShared(packed, Math::Vector3(packed.position));
+	}
+
+	GeometryClass::Vertex UnpackVertex(const VertexPacking::PackedVertexHalfPosition& packed) {
+		const Math::Vector3 position{
+			XMConvertHalfToFloat(packed.position[0]),
+			XMConvertHalfToFloat(packed.position[1]),
+			XMConvertHalfToFloat(packed.position[2]) };
+		return UnpackShared(packed, position);
+	}
+
+	template<typename PackedT>
+	void PackAll(const GeometryClass::Vertex* vertices, UINT count, void* dst) {
+		// Built on the stack, dst is usually write combined upload memory that is slow to touch piecewise
+		auto* packedVertices = static_cast<PackedT*>(dst);
+		for (UINT i = 0; i < count; ++i) {
+			PackedT packed;
+			PackVertex(vertices[i], packed);
+			std::memcpy(packedVertices + i, &packed, sizeof(PackedT));
+		}
+	}
+
+	// Angle between two directions, directions of zero length do not count
+	float AngleDegrees(const Math::Vector3& a, const Math::Vector3& b) {
+		const float lengthA = Math::Length(a);
+		const float lengthB = Math::Length(b);
+		if (lengthA == 0.0f || lengthB == 0.0f) return 0.0f;
+
+		const float cosine = std::clamp(static_cast<float>(Math::Dot(a, b)) / (lengthA * lengthB), -1.0f, 1.0f);
+		return DirectX::XMConvertToDegrees(std::acos(cosine));
+	}
+
+	template<typename PackedT>
+	VertexPacking::PackingError MeasureAll(const GeometryClass::Vertex* vertices, UINT count) {
+		VertexPacking::PackingError error;
+		double positionErrorSum = 0.0;
+
+		for (UINT i = 0; i < count; ++i) {
+			const auto& vertex = vertices[i];
+
+			PackedT packed;
+			PackVertex(vertex, packed);
+			const auto unpacked = UnpackVertex(packed);
+
+			const float positionError = Math::Length(unpacked.m_position - vertex.m_position);
+			positionErrorSum += positionError;
+
+			error.maxPosition = std::max(error.maxPosition, positionError);
+			error.maxNormalDegrees = std::max(error.maxNormalDegrees, AngleDegrees(vertex.m_normal, unpacked.m_normal));
+			error.maxTangentDegrees = std::max(error.maxTangentDegrees, AngleDegrees(vertex.m_tangent, unpacked.m_tangent));
+			error.maxUV = std::max({ error.maxUV,
+				std::abs(unpacked.m_uv.x - vertex.m_uv.x),
+				std::abs(unpacked.m_uv.y - vertex.m_uv.y) });
+		}
+
+		if (count) {
+			error.meanPosition = static_cast<float>(positionErrorSum / count);
+		}
+
+		return error;
+	}
+}
+
+const wchar_t* VertexPacking::GetName(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::Packed: return L"Packed";
+	case VertexFormat::PackedHalfPosition: return L"PackedHalfPosition";
+	default: return L"Full";
+	}
+}
+
+UINT VertexPacking::GetStride(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::Packed: return sizeof(PackedVertex);
+	case VertexFormat::PackedHalfPosition: return sizeof(PackedVertexHalfPosition);
+	default: return sizeof(GeometryClass::Vertex);
+	}
+}
+
+D3D12_INPUT_LAYOUT_DESC VertexPacking::GetInputLayout(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::Packed: return { PackedLayout, std::extent_v<decltype(PackedLayout)> };
+	case VertexFormat::PackedHalfPosition: return { PackedHalfPositionLayout, std::extent_v<decltype(PackedHalfPositionLayout)> };
+	default: return { FullLayout, std::extent_v<decltype(FullLayout)> };
+	}
+}
+
+void VertexPacking::Pack(VertexFormat format, const GeometryClass::Vertex* vertices, UINT count, void* dst) {
+	switch (format) {
+	case VertexFormat::Packed: {
+		PackAll<PackedVertex>(vertices, count, dst);
+		break;
+	}
+	case VertexFormat::PackedHalfPosition: {
+		PackAll<PackedVertexHalfPosition>(vertices, count, dst);
+		break;
+	}
+	default: {
+		std::memcpy(dst, vertices, sizeof(GeometryClass::Vertex) * static_cast<size_t>(count));
+		break;
+	}}
+}
+
+VertexPacking::PackingError VertexPacking::MeasureError(VertexFormat format, const GeometryClass::Vertex* vertices, UINT count) {
+	switch (format) {
+	case VertexFormat::Packed: return MeasureAll<PackedVertex>(vertices, count);
+	case VertexFormat::PackedHalfPosition: return MeasureAll<PackedVertexHalfPosition>(vertices, count);
+	default: return {};
+	}
+}
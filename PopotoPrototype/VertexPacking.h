@@ -0,0 +1,50 @@
+#pragma once
+
+#include "GeometryClass.h"
+
+// Layout of the vertices in the GPU pools. Meshes stay GeometryClass::Vertex on the CPU and are
+// converted while they are staged for upload, so the format only has to match the input layout
+// and the shaders. The packed formats store normal and tangent octahedral encoded in two snorm16
+// each and the uv as two halves.
+enum class VertexFormat : UINT8 {
+	Full,				// GeometryClass::Vertex
+	Packed,				// VertexPacking::PackedVertex
+	PackedHalfPosition	// VertexPacking::PackedVertexHalfPosition
+};
+
+namespace VertexPacking {
+	struct PackedVertex {
+		DirectX::XMFLOAT3 position;
+		INT16 normal[2];
+		INT16 tangent[2];
+		UINT16 uv[2];	// Halves
+	};
+
+	struct PackedVertexHalfPosition {
+		UINT16 position[4];	// Halves, w is always 1
+		INT16 normal[2];
+		INT16 tangent[2];
+		UINT16 uv[2];
+	};
+
+	// Difference between the packed vertices and the full precision ones they were made from
+	struct PackingError {
+		float maxPosition{ 0.0f };	// Object space distance
+		float meanPosition{ 0.0f };
+		float maxNormalDegrees{ 0.0f };
+		float maxTangentDegrees{ 0.0f };
+		float maxUV{ 0.0f };
+	};
+
+	const wchar_t* GetName(VertexFormat format);
+	UINT GetStride(VertexFormat format);
+
+	// Matches VSInput in Common.hlsli, the packed formats need the shaders compiled with PACKED_VERTICES
+	D3D12_INPUT_LAYOUT_DESC GetInputLayout(VertexFormat format);
+
+	// Writes count vertices to dst, which has room for count * GetStride(format) bytes
+	void Pack(VertexFormat format, const GeometryClass::Vertex* vertices, UINT count, void* dst);
+
+	// Packs the vertices, decodes them again the way the vertex shader does and compares the result
+	PackingError MeasureError(VertexFormat format, const GeometryClass::Vertex* vertices, UINT count);
+};